@@ -0,0 +1,458 @@
+/*
+  ==============================================================================
+
+    BatchRenderer.cpp
+    Renders a set of files through SimpleEQ on every core.
+
+  ==============================================================================
+*/
+
+#include "BatchRenderer.h"
+#include <map>
+#include <mutex>
+
+//==============================================================================
+struct BatchRenderer::FileJob
+{
+    juce::File input, output;
+
+    double sampleRate { 0.0 };
+    int numChannels { 0 };
+    int bitsPerSample { 24 };
+    juce::int64 lengthInSamples { 0 };
+    int numChunks { 1 };
+
+    /* Chunks can finish in any order but the writer is sequential, so finished chunks wait here
+        until everything before them has been written. Jobs are handed out in order, so at most
+        about one chunk per worker is ever parked
+     */
+    std::mutex lock;
+    std::unique_ptr<juce::AudioFormatWriter> writer;
+    std::map<int, juce::AudioBuffer<float>> finishedChunks;
+    int nextChunkToWrite { 0 };
+    juce::String error;
+};
+
+struct BatchRenderer::ChunkTask
+{
+    int fileIndex { 0 }, chunkIndex { 0 };
+    juce::int64 start { 0 }, length { 0 };
+};
+
+namespace
+{
+    juce::Result configure(SimpleEQAudioProcessor& processor, double sampleRate, int numChannels, int blockSize)
+    {
+        if (processor.getTotalNumInputChannels() != numChannels)
+        {
+            auto layout = juce::AudioChannelSet::canonicalChannelSet(numChannels);
+
+            if (layout.isDisabled())
+                layout = juce::AudioChannelSet::discreteChannels(numChannels);
+
+            juce::AudioProcessor::BusesLayout buses;
+            buses.inputBuses.add(layout);
+            buses.outputBuses.add(layout);
+
+            // every bus needs an entry, the sidechain stays off
+            for (int bus = 1; bus < processor.getBusCount(true); ++bus)
+                buses.inputBuses.add(juce::AudioChannelSet::disabled());
+
+            if (! processor.setBusesLayout(buses))
+                return juce::Result::fail("Processor rejected a " + juce::String(numChannels) + " channel layout");
+        }
+
+        // prepareToPlay also clears the filter state, which is what every new file or chunk wants
+        processor.setRateAndBufferSizeDetails(sampleRate, blockSize);
+        processor.prepareToPlay(sampleRate, blockSize);
+        return juce::Result::ok();
+    }
+
+    /* Renders [start, start + length) of the reader into output, which must already be sized for it.
+        Anything before start (down to the pre-roll) is processed to rebuild the filter state, then discarded
+     */
+    void renderRange(SimpleEQAudioProcessor& processor, juce::AudioFormatReader& reader,
+                     juce::int64 start, juce::int64 length, int blockSize, juce::AudioBuffer<float>& output)
+    {
+        // an unstable design never settles, in which case the best we can do is pre-roll from the top of the file
+        auto settleSamples = std::ceil(processor.getFilterSettleSeconds() * reader.sampleRate);
+        auto prerollSamples = (juce::int64) juce::jmin((double) start, settleSamples);
+        auto position = start - prerollSamples;
+        auto end = start + length;
+
+        juce::AudioBuffer<float> buffer((int) reader.numChannels, blockSize);
+        juce::MidiBuffer midi;
+
+        while (position < end)
+        {
+            // keep block edges on the chunk start so pre-roll output never mixes with real output
+            auto limit = position < start ? start : end;
+            auto numSamples = (int) juce::jmin((juce::int64) blockSize, limit - position);
+
+            buffer.setSize((int) reader.numChannels, numSamples, false, false, true);
+            reader.read(&buffer, 0, numSamples, position, true, true);
+
+            processor.processBlock(buffer, midi);
+
+            if (position >= start)
+                for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+                    output.copyFrom(channel, (int) (position - start), buffer, channel, 0, numSamples);
+
+            position += numSamples;
+        }
+    }
+}
+
+//==============================================================================
+class BatchRenderer::Worker  : public juce::ThreadPoolJob
+{
+public:
+    Worker(BatchRenderer& o, SimpleEQAudioProcessor& p, std::atomic<size_t>& next, bool write)
+        : juce::ThreadPoolJob("SimpleEQ batch worker"), owner(o), processor(p), nextTask(next), writeOutputs(write)
+    {
+        formats.registerBasicFormats();
+    }
+
+    JobStatus runJob() override
+    {
+        for (;;)
+        {
+            auto index = nextTask.fetch_add(1);
+
+            if (index >= owner.tasks.size() || shouldExit())
+                break;
+
+            render(owner.tasks[index]);
+        }
+
+        return jobHasFinished;
+    }
+
+private:
+    void render(const ChunkTask& task)
+    {
+        auto& file = *owner.files[task.fileIndex];
+
+        std::unique_ptr<juce::AudioFormatReader> reader(formats.createReaderFor(file.input));
+
+        if (reader == nullptr)
+            return fail(file, "Couldn't read " + file.input.getFullPathName());
+
+        auto result = configure(processor, file.sampleRate, file.numChannels, owner.options.render.blockSize);
+
+        if (result.failed())
+            return fail(file, result.getErrorMessage());
+
+        juce::AudioBuffer<float> output(file.numChannels, (int) task.length);
+        renderRange(processor, *reader, task.start, task.length, owner.options.render.blockSize, output);
+
+        if (writeOutputs)
+            write(file, task.chunkIndex, std::move(output));
+    }
+
+    void write(FileJob& file, int chunkIndex, juce::AudioBuffer<float>&& chunk)
+    {
+        std::lock_guard<std::mutex> scopedLock(file.lock);
+
+        if (file.error.isNotEmpty())
+            return;
+
+        file.finishedChunks.emplace(chunkIndex, std::move(chunk));
+
+        for (auto it = file.finishedChunks.find(file.nextChunkToWrite); it != file.finishedChunks.end();
+             it = file.finishedChunks.find(file.nextChunkToWrite))
+        {
+            // the writer is only opened once there's something to write, so thousands of files don't mean thousands of open handles
+            if (file.writer == nullptr && ! openWriter(file))
+                return;
+
+            file.writer->writeFromAudioSampleBuffer(it->second, 0, it->second.getNumSamples());
+            file.finishedChunks.erase(it);
+
+            if (++file.nextChunkToWrite == file.numChunks)
+                file.writer.reset();
+        }
+    }
+
+    bool openWriter(FileJob& file)
+    {
+        auto* format = formats.findFormatForFileExtension(file.output.getFileExtension());
+
+        if (format == nullptr)
+        {
+            file.error = "No audio format for " + file.output.getFileName();
+            return false;
+        }
+
+        file.output.deleteFile();
+        auto stream = std::make_unique<juce::FileOutputStream>(file.output);
+
+        if (! stream->failedToOpen())
+            file.writer.reset(format->createWriterFor(stream.get(), file.sampleRate, (unsigned int) file.numChannels,
+                                                      file.bitsPerSample, {}, 0));
+
+        if (file.writer == nullptr)
+        {
+            file.error = "Couldn't write " + file.output.getFullPathName();
+            return false;
+        }
+
+        stream.release(); // the writer owns it now
+        return true;
+    }
+
+    void fail(FileJob& file, const juce::String& message)
+    {
+        std::lock_guard<std::mutex> scopedLock(file.lock);
+        file.error = message;
+    }
+
+    BatchRenderer& owner;
+    SimpleEQAudioProcessor& processor;
+    std::atomic<size_t>& nextTask;
+    bool writeOutputs;
+    juce::AudioFormatManager formats;
+
+    JUCE_DECLARE_NON_COPYABLE (Worker)
+};
+
+//==============================================================================
+BatchRenderer::BatchRenderer(const BatchOptions& o)
+    : options(o)
+{
+    formatManager.registerBasicFormats();
+}
+
+BatchRenderer::~BatchRenderer() = default;
+
+juce::Result BatchRenderer::planJobs()
+{
+    files.clear();
+    tasks.clear();
+
+    for (auto& input : options.inputFiles)
+    {
+        std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(input));
+
+        if (reader == nullptr)
+            return juce::Result::fail("Couldn't read " + input.getFullPathName());
+
+        auto* file = files.add(new FileJob());
+        file->input = input;
+        file->output = options.outputDirectory.getChildFile(input.getFileName());
+        file->sampleRate = reader->sampleRate;
+        file->numChannels = (int) reader->numChannels;
+        file->bitsPerSample = (int) reader->bitsPerSample;
+        file->lengthInSamples = reader->lengthInSamples;
+
+        // chunks are whole blocks long so a chunked render sees the same block edges as a serial one
+        auto blockSize = (juce::int64) options.render.blockSize;
+        auto chunkLength = options.chunkSeconds > 0.0
+                             ? juce::jmax(blockSize, (juce::int64) (options.chunkSeconds * file->sampleRate) / blockSize * blockSize)
+                             : juce::jmax((juce::int64) 1, file->lengthInSamples);
+
+        file->numChunks = (int) juce::jmax((juce::int64) 1, (file->lengthInSamples + chunkLength - 1) / chunkLength);
+
+        for (int chunk = 0; chunk < file->numChunks; ++chunk)
+        {
+            ChunkTask task;
+            task.fileIndex = files.size() - 1;
+            task.chunkIndex = chunk;
+            task.start = chunk * chunkLength;
+            task.length = juce::jmin(chunkLength, file->lengthInSamples - task.start);
+            tasks.push_back(task);
+        }
+    }
+
+    return files.isEmpty() ? juce::Result::fail("No input files") : juce::Result::ok();
+}
+
+juce::Result BatchRenderer::renderAll(int numThreads, bool writeOutputs, BatchStats& stats)
+{
+    auto result = planJobs();
+
+    if (result.failed())
+        return result;
+
+    // processors (and their APVTS) are built here on the calling thread, the workers only prepare and run them
+    juce::OwnedArray<SimpleEQAudioProcessor> processors;
+
+    for (int i = 0; i < numThreads; ++i)
+    {
+        auto* processor = processors.add(new SimpleEQAudioProcessor());
+        processor->setNonRealtime(true);
+
+        result = HeadlessRenderer::applyPreset(*processor, options.render.preset);
+
+        if (result.wasOk())
+            result = HeadlessRenderer::applyParameters(*processor, options.render.parameters);
+
+        if (result.failed())
+            return result;
+    }
+
+    std::atomic<size_t> nextTask { 0 };
+    juce::OwnedArray<Worker> workers;
+    juce::ThreadPool pool(numThreads);
+
+    auto startTicks = juce::Time::getHighResolutionTicks();
+
+    for (auto* processor : processors)
+        pool.addJob(workers.add(new Worker(*this, *processor, nextTask, writeOutputs)), false);
+
+    for (auto* worker : workers)
+        pool.waitForJobToFinish(worker, -1);
+
+    stats.wallSeconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+
+    stats.numFiles = files.size();
+    stats.numChunks = (int) tasks.size();
+    stats.numThreads = numThreads;
+    stats.audioSeconds = 0.0;
+
+    for (auto* file : files)
+    {
+        if (file->error.isNotEmpty())
+            return juce::Result::fail(file->error);
+
+        stats.audioSeconds += (double) file->lengthInSamples / file->sampleRate;
+    }
+
+    stats.realtimeFactor = stats.wallSeconds > 0.0 ? stats.audioSeconds / stats.wallSeconds : 0.0;
+    return juce::Result::ok();
+}
+
+juce::Result BatchRenderer::run(BatchStats& stats)
+{
+    auto numThreads = options.numThreads > 0 ? options.numThreads : juce::SystemStats::getNumCpus();
+    auto writeOutputs = options.outputDirectory != juce::File();
+
+    if (writeOutputs && ! options.outputDirectory.createDirectory())
+        return juce::Result::fail("Couldn't create " + options.outputDirectory.getFullPathName());
+
+    return renderAll(numThreads, writeOutputs, stats);
+}
+
+juce::Result BatchRenderer::verify(float& maxDifference)
+{
+    auto result = planJobs();
+
+    if (result.failed())
+        return result;
+
+    SimpleEQAudioProcessor processor;
+    processor.setNonRealtime(true);
+
+    result = HeadlessRenderer::applyPreset(processor, options.render.preset);
+
+    if (result.wasOk())
+        result = HeadlessRenderer::applyParameters(processor, options.render.parameters);
+
+    if (result.failed())
+        return result;
+
+    maxDifference = 0.0f;
+    auto blockSize = options.render.blockSize;
+
+    for (int fileIndex = 0; fileIndex < files.size(); ++fileIndex)
+    {
+        auto& file = *files[fileIndex];
+        std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(file.input));
+
+        if (reader == nullptr)
+            return juce::Result::fail("Couldn't read " + file.input.getFullPathName());
+
+        juce::AudioBuffer<float> serial(file.numChannels, (int) file.lengthInSamples);
+        juce::AudioBuffer<float> chunked(file.numChannels, (int) file.lengthInSamples);
+
+        if ((result = configure(processor, file.sampleRate, file.numChannels, blockSize)).failed())
+            return result;
+
+        renderRange(processor, *reader, 0, file.lengthInSamples, blockSize, serial);
+
+        // exactly what the workers do for each chunk, just one after another
+        for (auto& task : tasks)
+        {
+            if (task.fileIndex != fileIndex)
+                continue;
+
+            if ((result = configure(processor, file.sampleRate, file.numChannels, blockSize)).failed())
+                return result;
+
+            juce::AudioBuffer<float> chunk(file.numChannels, (int) task.length);
+            renderRange(processor, *reader, task.start, task.length, blockSize, chunk);
+
+            for (int channel = 0; channel < file.numChannels; ++channel)
+                chunked.copyFrom(channel, (int) task.start, chunk, channel, 0, (int) task.length);
+        }
+
+        for (int channel = 0; channel < file.numChannels; ++channel)
+        {
+            auto* a = serial.getReadPointer(channel);
+            auto* b = chunked.getReadPointer(channel);
+
+            for (int i = 0; i < serial.getNumSamples(); ++i)
+                maxDifference = juce::jmax(maxDifference, std::abs(a[i] - b[i]));
+        }
+    }
+
+    return juce::Result::ok();
+}
+
+juce::Result BatchRenderer::measureScaling(juce::String& report)
+{
+    auto maxThreads = options.numThreads > 0 ? options.numThreads : juce::SystemStats::getNumCpus();
+    double singleThreadedRate = 0.0;
+
+    report.clear();
+    report << "threads   wall (s)   realtime   speedup" << juce::newLine;
+
+    for (int numThreads = 1;; numThreads = juce::jmin(numThreads * 2, maxThreads))
+    {
+        BatchStats stats;
+        auto result = renderAll(numThreads, false, stats);
+
+        if (result.failed())
+            return result;
+
+        if (numThreads == 1)
+            singleThreadedRate = stats.realtimeFactor;
+
+        report << juce::String(numThreads).paddedLeft(' ', 7)
+               << juce::String(stats.wallSeconds, 3).paddedLeft(' ', 11)
+               << (juce::String(stats.realtimeFactor, 1) + "x").paddedLeft(' ', 11)
+               << (juce::String(singleThreadedRate > 0.0 ? stats.realtimeFactor / singleThreadedRate : 0.0, 2) + "x").paddedLeft(' ', 10)
+               << juce::newLine;
+
+        if (numThreads == maxThreads)
+            break;
+    }
+
+    return juce::Result::ok();
+}
+
+//==============================================================================
+juce::var BatchStats::toVar() const
+{
+    auto* object = new juce::DynamicObject();
+
+    object->setProperty("numFiles", numFiles);
+    object->setProperty("numChunks", numChunks);
+    object->setProperty("numThreads", numThreads);
+    object->setProperty("audioSeconds", audioSeconds);
+    object->setProperty("wallSeconds", wallSeconds);
+    object->setProperty("realtimeFactor", realtimeFactor);
+
+    return juce::var(object);
+}
+
+juce::String BatchStats::toString() const
+{
+    juce::String s;
+
+    s << numFiles << " files (" << numChunks << " chunks) on " << numThreads << " threads" << juce::newLine
+      << "  " << juce::String(audioSeconds, 1) << " s of audio in " << juce::String(wallSeconds, 2) << " s"
+      << " = " << juce::String(realtimeFactor, 1) << "x realtime" << juce::newLine;
+
+    return s;
+}
@@ -0,0 +1,77 @@
+/*
+  ==============================================================================
+
+    BatchRenderer.h
+    Renders a set of files through SimpleEQ on every core.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "HeadlessRenderer.h"
+
+struct BatchOptions
+{
+    juce::Array<juce::File> inputFiles;
+    juce::File outputDirectory;     // outputs keep the input's file name, nothing is written if this isn't set
+
+    int numThreads { 0 };           // 0 = one per core
+
+    /* Files longer than this get split into chunks that render in parallel (0 = never split).
+        Each chunk after the first starts early by the filters' settle time and throws that pre-roll away,
+        so the state it carries into the chunk matches what serial processing would have had
+     */
+    double chunkSeconds { 30.0 };
+
+    // preset, parameters and block size come from here, the file and source fields are ignored
+    RenderOptions render;
+};
+
+struct BatchStats
+{
+    int numFiles { 0 }, numChunks { 0 }, numThreads { 0 };
+    double audioSeconds { 0.0 };
+    double wallSeconds { 0.0 };
+    double realtimeFactor { 0.0 };
+
+    juce::var toVar() const;
+    juce::String toString() const;
+};
+
+//==============================================================================
+class BatchRenderer
+{
+public:
+    explicit BatchRenderer(const BatchOptions& options);
+    ~BatchRenderer();
+
+    juce::Result run(BatchStats& stats);
+
+    /* Renders every file twice in memory, once straight through and once in chunks with pre-roll,
+        and reports the largest sample difference between the two
+     */
+    juce::Result verify(float& maxDifference);
+
+    /* Runs the batch at 1, 2, 4 ... numThreads workers and reports throughput for each,
+        the speedup column is what we track for scaling
+     */
+    juce::Result measureScaling(juce::String& report);
+
+private:
+    struct FileJob;
+    struct ChunkTask;
+    class Worker;
+
+    juce::Result planJobs();
+    juce::Result renderAll(int numThreads, bool writeOutputs, BatchStats& stats);
+
+    BatchOptions options;
+    juce::AudioFormatManager formatManager;
+
+    juce::OwnedArray<FileJob> files;
+    std::vector<ChunkTask> tasks;
+
+    JUCE_DECLARE_NON_COPYABLE (BatchRenderer)
+};
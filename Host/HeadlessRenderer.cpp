@@ -0,0 +1,2229 @@
+/*
+  ==============================================================================
+
+    HeadlessRenderer.cpp
+    Runs SimpleEQAudioProcessor outside a DAW and measures it.
+
+  ==============================================================================
+*/
+
+#include "HeadlessRenderer.h"
+#include "../Source/CutFilterTable.h"
+#include "../Source/CoefficientCache.h"
+#include "RealtimeGuard.h"
+
+namespace
+{
+    struct Preset
+    {
+        const char* name;
+        std::vector<std::pair<const char*, float>> values;
+    };
+
+    /* Slope values are choice indices: 0 = 12, 1 = 24, 2 = 36, 3 = 48 db/Oct
+        "default" is createParameterLayout()'s defaults, the rest are roughly what sessions actually use
+     */
+    const Preset presets[]
+    {
+        { "default",   { { "LowCut Freq", 20.f },    { "LowCut Slope", 0.f }, { "Peak Freq", 750.f },  { "Peak Gain", 0.f },
+                         { "Peak Quality", 1.f },    { "HighCut Freq", 750.f }, { "HighCut Slope", 0.f } } },
+        { "vocal",     { { "LowCut Freq", 100.f },   { "LowCut Slope", 1.f }, { "Peak Freq", 3000.f }, { "Peak Gain", 4.f },
+                         { "Peak Quality", 1.2f },   { "HighCut Freq", 18000.f }, { "HighCut Slope", 0.f } } },
+        { "steep",     { { "LowCut Freq", 40.f },    { "LowCut Slope", 3.f }, { "Peak Freq", 250.f },  { "Peak Gain", -6.f },
+                         { "Peak Quality", 2.f },    { "HighCut Freq", 12000.f }, { "HighCut Slope", 3.f } } },
+        { "sweep-low", { { "LowCut Freq", 20.f },    { "LowCut Slope", 3.f }, { "Peak Freq", 60.f },   { "Peak Gain", 9.f },
+                         { "Peak Quality", 0.7f },   { "HighCut Freq", 20000.f }, { "HighCut Slope", 3.f } } }
+    };
+
+    // runs a stretch of buffer through a FilterCascade, for the benchmarks that drive one directly
+    template <typename Cascade, typename SampleType>
+    void processRange(Cascade& cascade, juce::AudioBuffer<SampleType>& buffer, int start, int length)
+    {
+        auto block = juce::dsp::AudioBlock<SampleType>(buffer).getSubBlock((size_t) start, (size_t) length);
+        cascade.process(juce::dsp::ProcessContextReplacing<SampleType>(block));
+    }
+}
+
+//==============================================================================
+HeadlessRenderer::HeadlessRenderer(const RenderOptions& o)
+    : options(o)
+{
+    formatManager.registerBasicFormats();
+}
+
+juce::StringArray HeadlessRenderer::getPresetNames()
+{
+    juce::StringArray names;
+
+    for (auto& preset : presets)
+        names.add(preset.name);
+
+    return names;
+}
+
+juce::Result HeadlessRenderer::setParameter(SimpleEQAudioProcessor& processor, const juce::String& parameterID, float value)
+{
+    auto* parameter = processor.apvts.getParameter(parameterID);
+
+    if (parameter == nullptr)
+        return juce::Result::fail("Unknown parameter: " + parameterID);
+
+    // goes through the normal host path so the APVTS listeners (and the coefficient dirty flags) see it
+    parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+    return juce::Result::ok();
+}
+
+juce::Result HeadlessRenderer::applyPreset(SimpleEQAudioProcessor& processor, const juce::String& presetName)
+{
+    for (auto& preset : presets)
+    {
+        if (presetName != preset.name)
+            continue;
+
+        for (auto& value : preset.values)
+        {
+            auto result = setParameter(processor, value.first, value.second);
+
+            if (result.failed())
+                return result;
+        }
+
+        return juce::Result::ok();
+    }
+
+    return juce::Result::fail("Unknown preset: " + presetName + " (available: " + getPresetNames().joinIntoString(", ") + ")");
+}
+
+juce::Result HeadlessRenderer::applyParameters(SimpleEQAudioProcessor& processor, const juce::StringPairArray& parameters)
+{
+    for (auto& key : parameters.getAllKeys())
+    {
+        auto result = setParameter(processor, key, parameters[key].getFloatValue());
+
+        if (result.failed())
+            return result;
+    }
+
+    return juce::Result::ok();
+}
+
+void HeadlessRenderer::automate(SimpleEQAudioProcessor& processor, double timeInSeconds)
+{
+    auto lfo = [timeInSeconds](double hz) { return 0.5 + 0.5 * std::sin(juce::MathConstants<double>::twoPi * hz * timeInSeconds); };
+
+    // frequencies sweep in octaves, so they spend as long in the lows as in the highs
+    setParameter(processor, "Peak Freq", (float) (100.0 * std::pow(2.0, 7.0 * lfo(0.25))));
+    setParameter(processor, "Peak Gain", (float) (24.0 * lfo(0.4) - 12.0));
+    setParameter(processor, "LowCut Freq", (float) (20.0 * std::pow(2.0, 3.0 * lfo(0.15))));
+    setParameter(processor, "HighCut Freq", (float) (2000.0 * std::pow(2.0, 3.0 * lfo(0.1))));
+}
+
+juce::String HeadlessRenderer::checkCutTableAccuracy(int entriesPerOctave)
+{
+    juce::String report;
+
+    for (auto sampleRate : { 44100.0, 48000.0, 96000.0, 192000.0 })
+    {
+        CutFilterTable table;
+        table.build(sampleRate, entriesPerOctave);
+
+        if (table.isEmpty())
+            return "Table is off (entries per octave must be > 0)";
+
+        auto worstDecibels = 0.0;
+        auto topFrequency = juce::jmin(CutFilterTable::maxFrequency, sampleRate * 0.45);
+
+        auto magnitude = [sampleRate](const CutCoefficients& c, double frequency)
+        {
+            auto m = 1.0;
+
+            for (int i = 0; i < c.numSections; ++i)
+                m *= CoefficientEngine::getMagnitudeForFrequency(c.sections[(size_t) i], frequency, sampleRate);
+
+            return m;
+        };
+
+        for (int order = 2; order <= 8; order += 2)
+        {
+            // a step that doesn't line up with the table, so most probes land between entries
+            for (auto cutoff = CutFilterTable::minFrequency; cutoff < topFrequency; cutoff *= 1.0137)
+            {
+                CutCoefficients fromTable, designed;
+
+                for (auto highPass : { false, true })
+                {
+                    if (highPass)
+                    {
+                        table.lookupHighPass(fromTable, cutoff, order);
+                        CoefficientEngine::designHighPassButterworth(designed, sampleRate, cutoff, order);
+                    }
+                    else
+                    {
+                        table.lookupLowPass(fromTable, cutoff, order);
+                        CoefficientEngine::designLowPassButterworth(designed, sampleRate, cutoff, order);
+                    }
+
+                    for (auto probe = 10.0; probe < sampleRate * 0.45; probe *= 1.1)
+                    {
+                        auto expected = magnitude(designed, probe);
+
+                        // deep in the stop band the absolute error is what matters, not the ratio
+                        if (expected > 1.0e-3)
+                            worstDecibels = juce::jmax(worstDecibels, std::abs(juce::Decibels::gainToDecibels(magnitude(fromTable, probe) / expected, -200.0)));
+                    }
+                }
+            }
+        }
+
+        report << juce::String(sampleRate, 0) << " Hz: " << entriesPerOctave << " entries/octave, "
+               << juce::String((double) table.getMemoryBytes() / 1024.0, 1) << " KB, worst error "
+               << juce::String(worstDecibels, 4) << " dB" << juce::newLine;
+    }
+
+    return report;
+}
+
+juce::String HeadlessRenderer::benchmarkResponseCurve()
+{
+    constexpr int numCurves = 500;
+    constexpr double sampleRate = 48000.0;
+
+    // steepest settings, 9 sections
+    juce::Random random(0x5eed);
+    std::vector<ChainSettings> settings((size_t) numCurves);
+
+    for (auto& s : settings)
+    {
+        s.lowCutFreq = 20.0f + random.nextFloat() * 200.0f;
+        s.highCutFreq = 2000.0f + random.nextFloat() * 15000.0f;
+        s.peakFreq = 100.0f + random.nextFloat() * 5000.0f;
+        s.peakGainInDecibels = random.nextFloat() * 48.0f - 24.0f;
+        s.peakQuality = 0.5f + random.nextFloat() * 4.0f;
+        s.lowCutSlope = Slope_48;
+        s.highCutSlope = Slope_48;
+    }
+
+    auto microsPerCurve = [](juce::int64 startTicks)
+    {
+        return juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks) * 1.0e6 / numCurves;
+    };
+
+    // naive: design, then getMagnitudeForFrequency for every section at every point
+    CoefficientEngine engine;
+    engine.prepare(sampleRate);
+    std::vector<double> decibels((size_t) ResponseCurve::numPoints);
+
+    auto start = juce::Time::getHighResolutionTicks();
+
+    for (auto& s : settings)
+    {
+        engine.design(s, CoefficientEngine::AllStages);
+
+        for (int i = 0; i < ResponseCurve::numPoints; ++i)
+        {
+            auto frequency = ResponseCurve::getFrequency(i);
+            auto magnitude = CoefficientEngine::getMagnitudeForFrequency(engine.getPeak(), frequency, sampleRate);
+
+            for (auto* cut : { &engine.getLowCut(), &engine.getHighCut() })
+                for (int section = 0; section < cut->numSections; ++section)
+                    magnitude *= CoefficientEngine::getMagnitudeForFrequency(cut->sections[(size_t) section], frequency, sampleRate);
+
+            decibels[(size_t) i] = juce::Decibels::gainToDecibels(magnitude, -200.0);
+        }
+    }
+
+    auto naive = microsPerCurve(start);
+
+    ResponseCurve curve;
+    curve.update(settings.back(), sampleRate); // grid setup isn't part of what we're timing
+
+    start = juce::Time::getHighResolutionTicks();
+
+    for (auto& s : settings)
+        curve.update(s, sampleRate);
+
+    auto changed = microsPerCurve(start);
+
+    start = juce::Time::getHighResolutionTicks();
+
+    for (int i = 0; i < numCurves; ++i)
+        curve.update(settings.back(), sampleRate);
+
+    auto unchanged = microsPerCurve(start);
+
+    juce::String report;
+    report << ResponseCurve::numPoints << " points, 9 sections, microseconds per curve" << juce::newLine
+           << "  per point evaluation     " << juce::String(naive, 2) << juce::newLine
+           << "  ResponseCurve, changed   " << juce::String(changed, 2) << juce::newLine
+           << "  ResponseCurve, unchanged " << juce::String(unchanged, 3) << juce::newLine;
+
+    return report;
+}
+
+juce::Result HeadlessRenderer::measureLinearPhaseCost(const RenderOptions& baseOptions, juce::String& report)
+{
+    auto options = baseOptions;
+    options.outputFile = juce::File();
+
+    report << "kernel   latency   realtime   p99 block (us)" << juce::newLine;
+
+    // 0 stands in for the IIR chain as the baseline
+    for (auto kernelSize : { 0, 1024, 2048, 4096, 8192, 16384, 32768, 65536 })
+    {
+        options.kernelSize = kernelSize;
+        options.parameters.set("Linear Phase", kernelSize > 0 ? "1" : "0");
+
+        HeadlessRenderer renderer(options);
+        RenderStats stats;
+        auto result = renderer.run(stats);
+
+        if (result.failed())
+            return result;
+
+        report << (kernelSize > 0 ? juce::String(kernelSize) : juce::String("IIR")).paddedRight(' ', 9)
+               << juce::String(stats.latencySamples).paddedRight(' ', 10)
+               << (juce::String(stats.realtimeFactor, 1) + "x").paddedRight(' ', 11)
+               << juce::String(stats.blockMicrosP99, 2) << juce::newLine;
+    }
+
+    return juce::Result::ok();
+}
+
+juce::Result HeadlessRenderer::measureOversamplingCost(const RenderOptions& baseOptions, juce::String& report)
+{
+    auto options = baseOptions;
+    options.outputFile = juce::File();
+
+    report << (options.oversamplingFIR ? "FIR" : "polyphase IIR") << " half-band stages" << juce::newLine
+           << "factor   latency   realtime   p99 block (us)" << juce::newLine;
+
+    // parameter value is the choice index: Off, 2x, 4x, 8x
+    for (int order = 0; order <= 3; ++order)
+    {
+        options.parameters.set("Oversampling", juce::String(order));
+
+        HeadlessRenderer renderer(options);
+        RenderStats stats;
+        auto result = renderer.run(stats);
+
+        if (result.failed())
+            return result;
+
+        report << (order > 0 ? juce::String(1 << order) + "x" : juce::String("off")).paddedRight(' ', 9)
+               << juce::String(stats.latencySamples).paddedRight(' ', 10)
+               << (juce::String(stats.realtimeFactor, 1) + "x").paddedRight(' ', 11)
+               << juce::String(stats.blockMicrosP99, 2) << juce::newLine;
+    }
+
+    return juce::Result::ok();
+}
+
+juce::Result HeadlessRenderer::measureBandScaling(const RenderOptions& baseOptions, juce::String& report)
+{
+    auto options = baseOptions;
+    options.outputFile = juce::File();
+
+    report << "bands   sections   realtime   cycles/sample   per band" << juce::newLine;
+
+    auto baseline = 0.0;
+
+    for (int numBands = 0; numBands <= ChainSettings::maxBands; numBands += 4)
+    {
+        for (int band = 0; band < ChainSettings::maxBands; ++band)
+        {
+            // types are choice indices: Bell, Low Shelf, High Shelf, Notch, Tilt
+            options.parameters.set(CoefficientEngine::getBandParameterID(band, "On"), band < numBands ? "1" : "0");
+            options.parameters.set(CoefficientEngine::getBandParameterID(band, "Type"), juce::String(band % 5));
+            options.parameters.set(CoefficientEngine::getBandParameterID(band, "Gain"), "3");
+        }
+
+        HeadlessRenderer renderer(options);
+        RenderStats stats;
+        auto result = renderer.run(stats);
+
+        if (result.failed())
+            return result;
+
+        if (numBands == 0)
+            baseline = stats.cyclesPerSample;
+
+        auto perBand = numBands > 0 ? juce::String((stats.cyclesPerSample - baseline) / numBands, 2) : juce::String("-");
+
+        report << juce::String(numBands).paddedRight(' ', 8)
+               << juce::String(stats.activeSections).paddedRight(' ', 11)
+               << (juce::String(stats.realtimeFactor, 1) + "x").paddedRight(' ', 11)
+               << juce::String(stats.cyclesPerSample, 2).paddedRight(' ', 16)
+               << perBand << juce::newLine;
+    }
+
+    return juce::Result::ok();
+}
+
+juce::Result HeadlessRenderer::measureSilenceBypass(const RenderOptions& baseOptions, juce::String& report)
+{
+    auto options = baseOptions;
+    options.outputFile = juce::File();
+    options.inputFile = juce::File(); // the duty cycle only applies to the generated source
+
+    report << "playing   cycles/sample (off)   cycles/sample (on)   saved    blocks skipped" << juce::newLine;
+
+    for (auto duty : { 1.0, 0.5, 0.25, 0.1, 0.0 })
+    {
+        options.sparseDuty = duty;
+        RenderStats stats[2];
+
+        for (int bypass = 0; bypass < 2; ++bypass)
+        {
+            options.silenceBypass = bypass != 0;
+
+            HeadlessRenderer renderer(options);
+            auto result = renderer.run(stats[bypass]);
+
+            if (result.failed())
+                return result;
+        }
+
+        auto saved = stats[0].cyclesPerSample > 0.0 ? 1.0 - stats[1].cyclesPerSample / stats[0].cyclesPerSample : 0.0;
+
+        report << (juce::String(duty * 100.0, 0) + "%").paddedRight(' ', 10)
+               << juce::String(stats[0].cyclesPerSample, 2).paddedRight(' ', 22)
+               << juce::String(stats[1].cyclesPerSample, 2).paddedRight(' ', 21)
+               << (juce::String(saved * 100.0, 1) + "%").paddedRight(' ', 9)
+               << juce::String(stats[1].bypassedBlocks * 100.0, 1) << "%" << juce::newLine;
+    }
+
+    return juce::Result::ok();
+}
+
+juce::Result HeadlessRenderer::measureDynamicEQ(const RenderOptions& baseOptions, juce::String& report)
+{
+    // a gain that moves every update, at a fixed frequency and Q, the way a dynamic stage sees it
+    constexpr int numUpdates = 1000000;
+    constexpr double sampleRate = 48000.0, frequency = 2500.0, quality = 1.4;
+
+    std::vector<double> gains((size_t) numUpdates);
+    juce::Random random(0x5eed);
+
+    for (auto& gain : gains)
+        gain = random.nextDouble() * 30.0 - 24.0;
+
+    // summed so the optimiser can't drop the designs
+    auto time = [&](auto&& design)
+    {
+        auto sum = 0.0;
+        auto start = juce::Time::getHighResolutionTicks();
+
+        for (auto gain : gains)
+            sum += design(gain).b0;
+
+        auto seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+        return std::make_pair(seconds * 1.0e9 / numUpdates, sum);
+    };
+
+    auto full = time([&](double gain) { return CoefficientEngine::makePeakFilter(sampleRate, frequency, quality,
+                                                                                  juce::Decibels::decibelsToGain(gain)); });
+
+    auto gainDesign = CoefficientEngine::makeGainDesign(sampleRate, BandType::Bell, frequency, quality);
+    auto gainOnly = time([&](double gain) { return gainDesign.withGain(gain); });
+
+    auto worstError = 0.0;
+
+    for (int i = 0; i < 1000; ++i)
+    {
+        auto a = CoefficientEngine::makePeakFilter(sampleRate, frequency, quality, juce::Decibels::decibelsToGain(gains[(size_t) i]));
+        auto b = gainDesign.withGain(gains[(size_t) i]);
+
+        for (auto difference : { a.b0 - b.b0, a.b1 - b.b1, a.b2 - b.b2, a.a1 - b.a1, a.a2 - b.a2 })
+            worstError = juce::jmax(worstError, std::abs(difference));
+    }
+
+    report << "gain change -> coefficients   makePeakFilter " << juce::String(full.first, 1) << " ns, gain-only "
+           << juce::String(gainOnly.first, 1) << " ns (" << juce::String(full.first / juce::jmax(1.0e-9, gainOnly.first), 1)
+           << "x), largest difference " << juce::String(worstError, 15) << juce::newLine << juce::newLine;
+
+    auto options = baseOptions;
+    options.outputFile = juce::File();
+
+    // peak plus eight bells spread over the range, each pulled down by whatever crosses -30 dB in its band
+    options.parameters.set("Peak Threshold", "-30");
+    options.parameters.set("Peak Ratio", "4");
+
+    for (int band = 0; band < 8; ++band)
+    {
+        options.parameters.set(CoefficientEngine::getBandParameterID(band * 3, "On"), "1");
+        options.parameters.set(CoefficientEngine::getBandParameterID(band * 3, "Type"), "0");
+        options.parameters.set(CoefficientEngine::getBandParameterID(band * 3, "Gain"), "3");
+        options.parameters.set(DynamicEQ::getSlotParameterID(1 + band * 3, "Threshold"), "-30");
+        options.parameters.set(DynamicEQ::getSlotParameterID(1 + band * 3, "Ratio"), "4");
+    }
+
+    report << "dynamic stages   realtime   cycles/sample" << juce::newLine;
+
+    for (int numDynamic : { 0, 1, 9 })
+    {
+        options.parameters.set("Peak Dynamic", numDynamic > 0 ? "1" : "0");
+
+        for (int band = 0; band < 8; ++band)
+            options.parameters.set(DynamicEQ::getSlotParameterID(1 + band * 3, "Dynamic"), numDynamic > 1 ? "1" : "0");
+
+        HeadlessRenderer renderer(options);
+        RenderStats stats;
+        auto result = renderer.run(stats);
+
+        if (result.failed())
+            return result;
+
+        report << juce::String(numDynamic).paddedRight(' ', 17)
+               << (juce::String(stats.realtimeFactor, 1) + "x").paddedRight(' ', 11)
+               << juce::String(stats.cyclesPerSample, 2) << juce::newLine;
+    }
+
+    return juce::Result::ok();
+}
+
+juce::Result HeadlessRenderer::measureStereoModes(const RenderOptions& baseOptions, juce::String& report)
+{
+    const juce::StringArray modes { "Stereo", "Dual Mono", "Mid/Side" };
+    auto firstPathIDs = CoefficientEngine::getPathParameterIDs(0);
+    auto secondPathIDs = CoefficientEngine::getPathParameterIDs(1);
+
+    auto options = baseOptions;
+    options.outputFile = juce::File();
+    options.numChannels = 2;
+
+    // the second path gets what the first has, then a darker top and a cut where the first boosts
+    if (auto* preset = std::find_if(std::begin(presets), std::end(presets), [&](const Preset& p) { return options.preset == p.name; });
+        preset != std::end(presets))
+    {
+        for (auto& value : preset->values)
+            options.parameters.set(CoefficientEngine::getPathParameterID(1, value.first), juce::String(value.second));
+    }
+
+    options.parameters.set("Path2 HighCut Freq", "8000");
+    options.parameters.set("Path2 HighCut Slope", "1");
+    options.parameters.set("Path2 Peak Gain", "-6");
+
+    report << "mode         realtime   cycles/sample" << juce::newLine;
+
+    for (int mode = 0; mode < modes.size(); ++mode)
+    {
+        options.parameters.set("Stereo Mode", juce::String(mode));
+
+        HeadlessRenderer renderer(options);
+        RenderStats stats;
+        auto result = renderer.run(stats);
+
+        if (result.failed())
+            return result;
+
+        report << modes[mode].paddedRight(' ', 13)
+               << (juce::String(stats.realtimeFactor, 1) + "x").paddedRight(' ', 11)
+               << juce::String(stats.cyclesPerSample, 2) << juce::newLine;
+    }
+
+    //==============================================================================
+    // Same noise through one processor per mode, both paths set to the preset. The split modes have to land on Stereo's output
+    constexpr double sampleRate = 48000.0;
+    constexpr int blockSize = 512, numBlocks = 200;
+
+    std::array<std::unique_ptr<SimpleEQAudioProcessor>, 3> processors;
+
+    for (int mode = 0; mode < (int) processors.size(); ++mode)
+    {
+        auto& processor = processors[(size_t) mode];
+        processor = std::make_unique<SimpleEQAudioProcessor>();
+
+        auto result = applyPreset(*processor, baseOptions.preset);
+
+        if (result.wasOk())
+            result = applyParameters(*processor, baseOptions.parameters);
+
+        if (result.wasOk())
+            result = setParameter(*processor, "Stereo Mode", (float) mode);
+
+        if (result.failed())
+            return result;
+
+        for (int i = 0; i < firstPathIDs.size(); ++i)
+            if (auto* parameter = processor->apvts.getParameter(secondPathIDs[i]))
+                parameter->setValueNotifyingHost(processor->apvts.getParameter(firstPathIDs[i])->getValue());
+
+        processor->setNonRealtime(true);
+        processor->setParameterSmoothing(0.0, blockSize);
+        processor->setRateAndBufferSizeDetails(sampleRate, blockSize);
+        processor->prepareToPlay(sampleRate, blockSize);
+    }
+
+    juce::AudioBuffer<float> reference(2, blockSize), stereo(2, blockSize), buffer(2, blockSize);
+    juce::MidiBuffer midi;
+    juce::Random random(0x5eed);
+    std::array<float, 3> worstDifference {}, peak {};
+
+    for (int block = 0; block < numBlocks; ++block)
+    {
+        // left and right differ, otherwise the side channel would be silent and prove nothing
+        for (int i = 0; i < blockSize; ++i)
+        {
+            auto common = random.nextFloat() - 0.5f;
+            reference.setSample(0, i, common + 0.25f * (random.nextFloat() - 0.5f));
+            reference.setSample(1, i, 0.5f * common - 0.25f * (random.nextFloat() - 0.5f));
+        }
+
+        stereo.makeCopyOf(reference, true);
+        processors[0]->processBlock(stereo, midi);
+
+        for (int mode = 1; mode < (int) processors.size(); ++mode)
+        {
+            buffer.makeCopyOf(reference, true);
+            processors[(size_t) mode]->processBlock(buffer, midi);
+
+            for (int channel = 0; channel < 2; ++channel)
+            {
+                for (int i = 0; i < blockSize; ++i)
+                {
+                    auto expected = stereo.getSample(channel, i);
+                    peak[(size_t) mode] = juce::jmax(peak[(size_t) mode], std::abs(expected));
+                    worstDifference[(size_t) mode] = juce::jmax(worstDifference[(size_t) mode], std::abs(buffer.getSample(channel, i) - expected));
+                }
+            }
+        }
+    }
+
+    report << juce::newLine << "both paths set the same, largest difference from Stereo:" << juce::newLine;
+
+    for (int mode = 1; mode < (int) processors.size(); ++mode)
+    {
+        auto relative = juce::Decibels::gainToDecibels(worstDifference[(size_t) mode] / juce::jmax(1.0e-9f, peak[(size_t) mode]), -200.0f);
+        report << "  " << modes[mode].paddedRight(' ', 11) << juce::String(relative, 1) << " dB below the peak" << juce::newLine;
+
+        // dual mono runs the same arithmetic per lane, mid / side only adds float rounding from the encode
+        auto matches = mode == 1 ? worstDifference[(size_t) mode] == 0.0f : relative < -90.0f;
+
+        if (! matches)
+            return juce::Result::fail(modes[mode] + " with identical paths doesn't match Stereo");
+    }
+
+    //==============================================================================
+    // Dual Mono, both paths the same and the same signal on both channels, a dynamic Peak pulling its boost right down.
+    // Switching Dynamic off half way through has to bring the static boost back on both paths, not just the first
+    SimpleEQAudioProcessor dynamic;
+
+    for (auto& value : { std::pair<const char*, float> { "Stereo Mode", 1.0f }, { "Peak Freq", 1000.0f }, { "Peak Gain", 12.0f },
+                         { "Peak Dynamic", 1.0f }, { "Peak Threshold", -60.0f }, { "Peak Ratio", 10.0f } })
+    {
+        auto result = setParameter(dynamic, value.first, value.second);
+
+        if (result.failed())
+            return result;
+    }
+
+    for (int i = 0; i < firstPathIDs.size(); ++i)
+        if (auto* parameter = dynamic.apvts.getParameter(secondPathIDs[i]))
+            parameter->setValueNotifyingHost(dynamic.apvts.getParameter(firstPathIDs[i])->getValue());
+
+    dynamic.setNonRealtime(true);
+    dynamic.setParameterSmoothing(0.0, blockSize);
+    dynamic.setRateAndBufferSizeDetails(sampleRate, blockSize);
+    dynamic.prepareToPlay(sampleRate, blockSize);
+
+    auto worstPathDifference = 0.0f;
+
+    for (int block = 0; block < numBlocks; ++block)
+    {
+        if (block == numBlocks / 2)
+            setParameter(dynamic, "Peak Dynamic", 0.0f);
+
+        for (int i = 0; i < blockSize; ++i)
+        {
+            auto sample = random.nextFloat() - 0.5f;
+            buffer.setSample(0, i, sample);
+            buffer.setSample(1, i, sample);
+        }
+
+        dynamic.processBlock(buffer, midi);
+
+        for (int i = 0; i < blockSize; ++i)
+            worstPathDifference = juce::jmax(worstPathDifference, std::abs(buffer.getSample(1, i) - buffer.getSample(0, i)));
+    }
+
+    report << juce::newLine << "Dual Mono, dynamic Peak switched off mid-render: largest difference between the paths "
+           << juce::String(worstPathDifference) << juce::newLine;
+
+    // same settings, same input, same arithmetic per lane: anything but zero means one path missed the switch
+    if (worstPathDifference != 0.0f)
+        return juce::Result::fail("Switching Dynamic off in Dual Mono left the paths different");
+
+    return juce::Result::ok();
+}
+
+juce::Result HeadlessRenderer::measureChannelLayouts(const RenderOptions& options, juce::String& report)
+{
+    const std::pair<const char*, juce::AudioChannelSet> layouts[]
+    {
+        { "mono",   juce::AudioChannelSet::mono() },
+        { "stereo", juce::AudioChannelSet::stereo() },
+        { "5.1",    juce::AudioChannelSet::create5point1() },
+        { "7.1.4",  juce::AudioChannelSet::create7point1point4() },
+        { "16",     juce::AudioChannelSet::discreteChannels(16) }
+    };
+
+    constexpr double sampleRate = 48000.0;
+    constexpr int numSamples = 10 * (int) sampleRate;
+    constexpr float guardValue = 12345.0f;
+    auto blockSize = juce::jmax(1, options.blockSize);
+    auto lanes = (int) SIMDLanes<float>::size;
+
+    // one channel's worth of noise, copied to every channel of every layout
+    juce::AudioBuffer<float> noise(1, numSamples);
+    juce::Random random(0x5eed);
+
+    for (int i = 0; i < numSamples; ++i)
+        noise.setSample(0, i, random.nextFloat() * 0.5f - 0.25f);
+
+    juce::MidiBuffer midi;
+
+    /* Renders the noise on every channel of layout into storage, which has one more channel than the layout. The
+        processor never gets a pointer to that one: anything reaching for a channel past the layout's finds a null
+        pointer, anything writing past the last one hits the guard value
+     */
+    auto render = [&](const juce::String& name, const juce::AudioChannelSet& layout, const juce::StringPairArray& extraParameters,
+                      juce::AudioBuffer<float>& storage, juce::uint64& cycles)
+    {
+        SimpleEQAudioProcessor processor;
+
+        juce::AudioProcessor::BusesLayout buses;
+        buses.inputBuses.add(layout);
+        buses.outputBuses.add(layout);
+
+        for (int bus = 1; bus < processor.getBusCount(true); ++bus)
+            buses.inputBuses.add(juce::AudioChannelSet::disabled());
+
+        if (! processor.setBusesLayout(buses))
+            return juce::Result::fail("Processor rejected the " + name + " layout");
+
+        auto result = applyPreset(processor, options.preset);
+
+        if (result.wasOk())
+            result = applyParameters(processor, options.parameters);
+
+        if (result.wasOk())
+            result = applyParameters(processor, extraParameters);
+
+        if (result.failed())
+            return result;
+
+        processor.setParameterSmoothing(options.smoothingMs / 1000.0, options.subBlockSize);
+        processor.setNonRealtime(true);
+        processor.setRateAndBufferSizeDetails(sampleRate, blockSize);
+        processor.prepareToPlay(sampleRate, blockSize);
+
+        auto numChannels = layout.size();
+        storage.setSize(numChannels + 1, numSamples);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            storage.copyFrom(channel, 0, noise, 0, 0, numSamples);
+
+        for (int i = 0; i < numSamples; ++i)
+            storage.setSample(numChannels, i, guardValue);
+
+        cycles = 0;
+
+        for (int start = 0; start < numSamples; start += blockSize)
+        {
+            auto length = juce::jmin(blockSize, numSamples - start);
+            juce::AudioBuffer<float> block(storage.getArrayOfWritePointers(), numChannels, start, length);
+
+            auto startCycles = readCycleCounter();
+            processor.processBlock(block, midi);
+            cycles += readCycleCounter() - startCycles;
+        }
+
+        processor.releaseResources();
+
+        for (int i = 0; i < numSamples; ++i)
+            if (storage.getSample(numChannels, i) != guardValue)
+                return juce::Result::fail(name + ": the processor wrote past its last channel at sample " + juce::String(i));
+
+        return juce::Result::ok();
+    };
+
+    juce::AudioBuffer<float> storage;
+    juce::uint64 cycles = 0;
+
+    report << "layout   channels   lane groups   cycles/sample   per channel   per lane group" << juce::newLine;
+
+    for (auto& entry : layouts)
+    {
+        juce::String name(entry.first);
+        auto numChannels = entry.second.size();
+        auto result = render(name, entry.second, {}, storage, cycles);
+
+        if (result.failed())
+            return result;
+
+        for (int channel = 1; channel < numChannels; ++channel)
+            for (int i = 0; i < numSamples; ++i)
+                if (storage.getSample(channel, i) != storage.getSample(0, i))
+                    return juce::Result::fail(name + ": channel " + juce::String(channel) + " differs from channel 0 at sample " + juce::String(i));
+
+        auto numGroups = (numChannels + lanes - 1) / lanes;
+        auto perSample = (double) cycles / numSamples;
+
+        report << name.paddedRight(' ', 9)
+               << juce::String(numChannels).paddedRight(' ', 11)
+               << juce::String(numGroups).paddedRight(' ', 14)
+               << juce::String(perSample, 2).paddedRight(' ', 16)
+               << juce::String(perSample / numChannels, 2).paddedRight(' ', 14)
+               << juce::String(perSample / numGroups, 2) << juce::newLine;
+    }
+
+    report << juce::newLine << lanes << " channels per lane group, every output channel matches channel 0 bit for bit" << juce::newLine;
+
+    // The split modes and the dynamic detectors are what would go looking for a second channel. Mono has to get
+    // through them on its one channel, and come out the same as mono in Stereo mode
+    juce::AudioBuffer<float> monoStereo;
+    juce::StringPairArray dynamicPeak;
+    dynamicPeak.set("Peak Gain", "12");
+    dynamicPeak.set("Peak Dynamic", "1");
+    dynamicPeak.set("Peak Threshold", "-40");
+
+    auto result = render("mono", juce::AudioChannelSet::mono(), dynamicPeak, monoStereo, cycles);
+
+    if (result.failed())
+        return result;
+
+    for (auto mode : { 1, 2 })
+    {
+        auto parameters = dynamicPeak;
+        parameters.set("Stereo Mode", juce::String(mode));
+
+        auto modeName = juce::String(mode == 1 ? "Dual Mono" : "Mid/Side");
+        result = render("mono in " + modeName, juce::AudioChannelSet::mono(), parameters, storage, cycles);
+
+        if (result.failed())
+            return result;
+
+        auto worstDifference = 0.0f;
+
+        for (int i = 0; i < numSamples; ++i)
+            worstDifference = juce::jmax(worstDifference, std::abs(storage.getSample(0, i) - monoStereo.getSample(0, i)));
+
+        report << "mono in " << modeName << " with a dynamic Peak: largest difference from Stereo " << juce::String(worstDifference) << juce::newLine;
+
+        if (! (worstDifference <= 1.0e-4f))
+            return juce::Result::fail("Mono in " + modeName + " doesn't match mono in Stereo");
+    }
+
+    return juce::Result::ok();
+}
+
+juce::String HeadlessRenderer::benchmarkTopologies()
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr int numChannels = 2, blockSize = 512, modulationBlockSize = 32;
+    constexpr int numSamples = 10 * (int) sampleRate;
+
+    using FloatCascade = FilterCascade<float, 9>;
+    using DoubleCascade = FilterCascade<double, 9>;
+
+    // the fixed chain at its steepest: 4 + 1 + 4 sections
+    CoefficientEngine engine;
+    engine.prepare(sampleRate);
+
+    auto design = [&engine](double lowCutFreq)
+    {
+        ChainSettings settings;
+        settings.lowCutFreq = (float) lowCutFreq;
+        settings.highCutFreq = 12000.0f;
+        settings.lowCutSlope = Slope_48;
+        settings.highCutSlope = Slope_48;
+        settings.peakFreq = 1000.0f;
+        settings.peakGainInDecibels = 6.0f;
+        settings.peakQuality = 2.0f;
+
+        engine.design(settings, CoefficientEngine::AllStages);
+
+        std::array<BiquadCoefficients, 9> sections;
+        int i = 0;
+        engine.forEachSection([&](const BiquadCoefficients& section) { sections[(size_t) i++] = section; });
+
+        return sections;
+    };
+
+    auto load = [](auto& cascade, const std::array<BiquadCoefficients, 9>& sections)
+    {
+        for (int i = 0; i < 9; ++i)
+            cascade.setCoefficients(i, sections[(size_t) i]);
+    };
+
+    auto prepare = [](auto& cascade, FilterTopology topology, int maxBlockSize)
+    {
+        cascade.prepare({ sampleRate, (juce::uint32) maxBlockSize, (juce::uint32) numChannels });
+        cascade.setTopology(topology);
+    };
+
+    juce::Random random(0x5eed);
+    juce::AudioBuffer<float> noise(numChannels, numSamples);
+
+    for (int channel = 0; channel < numChannels; ++channel)
+        for (int i = 0; i < numSamples; ++i)
+            noise.setSample(channel, i, random.nextFloat() * 0.5f - 0.25f);
+
+    juce::String report;
+    report << "topology   cycles/sample   modulation noise   silent tail cycles/sample (denormals / flushed)" << juce::newLine;
+
+    for (auto topology : { FilterTopology::TransposedDirectFormII, FilterTopology::StateVariable })
+    {
+        // throughput: static coefficients, noise in
+        FloatCascade cascade;
+        prepare(cascade, topology, blockSize);
+        load(cascade, design(40.0));
+
+        juce::AudioBuffer<float> buffer(noise);
+        juce::uint64 cycles = 0;
+
+        {
+            juce::ScopedNoDenormals noDenormals;
+
+            for (int start = 0; start < numSamples; start += blockSize)
+            {
+                auto startCycles = readCycleCounter();
+                processRange(cascade, buffer, start, juce::jmin(blockSize, numSamples - start));
+                cycles += readCycleCounter() - startCycles;
+            }
+        }
+
+        auto cyclesPerSample = (double) cycles / numSamples;
+
+        /* modulation noise: the low cut swept 20 Hz - 2 kHz eight times a second, redesigned every 32 samples, on a
+            1 kHz sine. Float against the same topology in double, so what's left is what float state adds
+         */
+        FloatCascade modulated;
+        DoubleCascade reference;
+        prepare(modulated, topology, modulationBlockSize);
+        prepare(reference, topology, modulationBlockSize);
+
+        juce::AudioBuffer<float> sine(numChannels, numSamples);
+        juce::AudioBuffer<double> sineReference(numChannels, numSamples);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            for (int i = 0; i < numSamples; ++i)
+            {
+                auto value = (float) (0.5 * std::sin(juce::MathConstants<double>::twoPi * 1000.0 * i / sampleRate));
+                sine.setSample(channel, i, value);
+                sineReference.setSample(channel, i, value);
+            }
+        }
+
+        for (int start = 0; start < numSamples; start += modulationBlockSize)
+        {
+            auto lfo = 0.5 + 0.5 * std::sin(juce::MathConstants<double>::twoPi * 8.0 * start / sampleRate);
+            auto sections = design(20.0 * std::pow(100.0, lfo));
+
+            load(modulated, sections);
+            load(reference, sections);
+            processRange(modulated, sine, start, modulationBlockSize);
+            processRange(reference, sineReference, start, modulationBlockSize);
+        }
+
+        auto error = 0.0, signal = 0.0;
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            for (int i = 0; i < numSamples; ++i)
+            {
+                auto expected = sineReference.getSample(channel, i);
+                auto difference = expected - (double) sine.getSample(channel, i);
+                error += difference * difference;
+                signal += expected * expected;
+            }
+        }
+
+        auto noiseDecibels = juce::Decibels::gainToDecibels(std::sqrt(error / juce::jmax(1.0e-30, signal)), -300.0);
+
+        // denormals: a burst of noise, then silence while the state decays through the denormal range
+        auto silentTail = [&](bool flushDenormals)
+        {
+            FloatCascade tail;
+            prepare(tail, topology, blockSize);
+            load(tail, design(20.0));
+
+            // the kernels' own protection would hide what the topologies do by themselves, see benchmarkDenormals()
+            tail.setDenormalProtection(false);
+
+            std::unique_ptr<juce::ScopedNoDenormals> noDenormals;
+
+            if (flushDenormals)
+                noDenormals = std::make_unique<juce::ScopedNoDenormals>();
+
+            juce::AudioBuffer<float> block(numChannels, blockSize);
+
+            for (int channel = 0; channel < numChannels; ++channel)
+                block.copyFrom(channel, 0, noise, channel, 0, blockSize);
+
+            processRange(tail, block, 0, blockSize);
+
+            juce::uint64 tailCycles = 0;
+
+            for (int start = blockSize; start < numSamples; start += blockSize)
+            {
+                block.clear();
+                auto startCycles = readCycleCounter();
+                processRange(tail, block, 0, blockSize);
+                tailCycles += readCycleCounter() - startCycles;
+            }
+
+            return (double) tailCycles / (numSamples - blockSize);
+        };
+
+        auto withDenormals = silentTail(false);
+        auto flushed = silentTail(true);
+
+        report << juce::String(topology == FilterTopology::StateVariable ? "svf" : "tdf2").paddedRight(' ', 11)
+               << juce::String(cyclesPerSample, 2).paddedRight(' ', 16)
+               << (juce::String(noiseDecibels, 1) + " dB").paddedRight(' ', 19)
+               << juce::String(withDenormals, 2) << " / " << juce::String(flushed, 2) << juce::newLine;
+    }
+
+    return report;
+}
+
+juce::String HeadlessRenderer::benchmarkDenormals()
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr int numChannels = 2, blockSize = 512;
+    constexpr int numSamples = 10 * (int) sampleRate;
+
+    // the fixed chain at its steepest again, low cut at 20 Hz so the tail takes as long as it can to die away
+    ChainSettings settings;
+    settings.lowCutFreq = 20.0f;
+    settings.highCutFreq = 12000.0f;
+    settings.lowCutSlope = Slope_48;
+    settings.highCutSlope = Slope_48;
+    settings.peakFreq = 1000.0f;
+    settings.peakGainInDecibels = 6.0f;
+    settings.peakQuality = 2.0f;
+
+    CoefficientEngine engine;
+    engine.prepare(sampleRate);
+    engine.design(settings, CoefficientEngine::AllStages);
+
+    /* A decaying tail, the way a reverb or a fade leaves it: noise falling 60 dB every 100 ms, so it passes through the
+        denormal range part way through (about 0.6 s in float, 5 s in double) and the filters' state follows it down
+     */
+    juce::Random random(0x5eed);
+    juce::AudioBuffer<double> tail(numChannels, numSamples);
+
+    for (int channel = 0; channel < numChannels; ++channel)
+        for (int i = 0; i < numSamples; ++i)
+            tail.setSample(channel, i, (random.nextDouble() - 0.5) * 0.5 * std::pow(10.0, -3.0 * i / (0.1 * sampleRate)));
+
+    auto run = [&](auto sampleType, FilterTopology topology, bool protect, bool flushToZero)
+    {
+        using SampleType = decltype(sampleType);
+
+        FilterCascade<SampleType, 9> cascade;
+        cascade.prepare({ sampleRate, (juce::uint32) blockSize, (juce::uint32) numChannels });
+        cascade.setTopology(topology);
+        cascade.setDenormalProtection(protect);
+
+        int i = 0;
+        engine.forEachSection([&](const BiquadCoefficients& section) { cascade.setCoefficients(i++, section); });
+
+        juce::AudioBuffer<SampleType> buffer(numChannels, numSamples);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            for (int n = 0; n < numSamples; ++n)
+                buffer.setSample(channel, n, (SampleType) tail.getSample(channel, n));
+
+        std::unique_ptr<juce::ScopedNoDenormals> noDenormals;
+
+        if (flushToZero)
+            noDenormals = std::make_unique<juce::ScopedNoDenormals>();
+
+        juce::uint64 cycles = 0;
+
+        for (int start = 0; start < numSamples; start += blockSize)
+        {
+            auto startCycles = readCycleCounter();
+            processRange(cascade, buffer, start, juce::jmin(blockSize, numSamples - start));
+            cycles += readCycleCounter() - startCycles;
+        }
+
+        return (double) cycles / numSamples;
+    };
+
+    juce::String report;
+    report << "10 s decaying tail, 9 sections, cycles/sample" << juce::newLine
+           << "                 plain      FTZ only   protected  FTZ + protected" << juce::newLine;
+
+    for (auto topology : { FilterTopology::TransposedDirectFormII, FilterTopology::StateVariable })
+    {
+        auto name = juce::String(topology == FilterTopology::StateVariable ? "svf" : "tdf2");
+
+        report << (name + " float").paddedRight(' ', 17)
+               << juce::String(run(0.0f, topology, false, false), 2).paddedRight(' ', 11)
+               << juce::String(run(0.0f, topology, false, true), 2).paddedRight(' ', 11)
+               << juce::String(run(0.0f, topology, true, false), 2).paddedRight(' ', 11)
+               << juce::String(run(0.0f, topology, true, true), 2) << juce::newLine;
+
+        report << (name + " double").paddedRight(' ', 17)
+               << juce::String(run(0.0, topology, false, false), 2).paddedRight(' ', 11)
+               << juce::String(run(0.0, topology, false, true), 2).paddedRight(' ', 11)
+               << juce::String(run(0.0, topology, true, false), 2).paddedRight(' ', 11)
+               << juce::String(run(0.0, topology, true, true), 2) << juce::newLine;
+    }
+
+    /* Then what a transport restart costs the whole processor: the first prepareToPlay builds everything, preparing
+        again at the same spec only resets, and reset() is what a seek or loop restart gets. Last a switch to twice the
+        sample rate, which should only cost the redesign (linear phase rebuilds its convolvers though). Each with the
+        first processBlock after it, which is where a rebuild that got deferred would show up
+     */
+    report << juce::newLine << "                   first prepare   re-prepare   reset()      new rate   (us, then first block after it)" << juce::newLine;
+
+    juce::AudioBuffer<float> block(numChannels, blockSize);
+    juce::MidiBuffer midi;
+
+    for (auto* preset : { "default", "4x oversampling", "linear phase" })
+    {
+        SimpleEQAudioProcessor processor;
+        processor.setOversamplingUsesFIR(true);
+
+        if (juce::String(preset) == "4x oversampling")
+            setParameter(processor, "Oversampling", 2.0f);
+        else if (juce::String(preset) == "linear phase")
+            setParameter(processor, "Linear Phase", 1.0f);
+
+        auto time = [&](std::function<void()> fn)
+        {
+            auto start = juce::Time::getMillisecondCounterHiRes();
+            fn();
+            auto elapsed = (juce::Time::getMillisecondCounterHiRes() - start) * 1000.0;
+
+            for (int channel = 0; channel < numChannels; ++channel)
+                for (int i = 0; i < blockSize; ++i)
+                    block.setSample(channel, i, random.nextFloat() * 0.5f - 0.25f);
+
+            start = juce::Time::getMillisecondCounterHiRes();
+            processor.processBlock(block, midi);
+            auto firstBlock = (juce::Time::getMillisecondCounterHiRes() - start) * 1000.0;
+
+            return juce::String(elapsed, 1) + " / " + juce::String(firstBlock, 1);
+        };
+
+        processor.setRateAndBufferSizeDetails(sampleRate, blockSize);
+
+        auto first = time([&] { processor.prepareToPlay(sampleRate, blockSize); });
+        auto again = time([&] { processor.releaseResources(); processor.prepareToPlay(sampleRate, blockSize); });
+        auto reset = time([&] { processor.reset(); });
+
+        auto newRate = time([&]
+        {
+            processor.setRateAndBufferSizeDetails(sampleRate * 2.0, blockSize);
+            processor.prepareToPlay(sampleRate * 2.0, blockSize);
+        });
+
+        report << juce::String(preset).paddedRight(' ', 19) << first.paddedRight(' ', 16) << again.paddedRight(' ', 13)
+               << reset.paddedRight(' ', 13) << newRate << juce::newLine;
+    }
+
+    return report;
+}
+
+juce::String HeadlessRenderer::benchmarkSlopeKernels()
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr int numChannels = 2, blockSize = 512;
+    constexpr int numSamples = 10 * (int) sampleRate;
+
+    juce::Random random(0x5eed);
+    juce::AudioBuffer<float> noise(numChannels, numSamples);
+
+    for (int channel = 0; channel < numChannels; ++channel)
+        for (int i = 0; i < numSamples; ++i)
+            noise.setSample(channel, i, random.nextFloat() * 0.5f - 0.25f);
+
+    CoefficientEngine engine;
+    engine.prepare(sampleRate);
+
+    // cycles/sample through the fixed chain laid out like the processor's (LowCut 0-3, Peak 4, HighCut 5-8)
+    auto measure = [&](FilterTopology topology, int maxFusedSections)
+    {
+        FilterCascade<float, 9> cascade;
+        cascade.prepare({ sampleRate, (juce::uint32) blockSize, (juce::uint32) numChannels });
+        cascade.setTopology(topology);
+        cascade.setMaxFusedSections(maxFusedSections);
+
+        auto loadCut = [&cascade](int first, const CutCoefficients& cut, int counter)
+        {
+            for (int i = 0; i < CutCoefficients::maxSections; ++i)
+            {
+                cascade.setBypassed(first + i, i >= cut.numSections);
+                cascade.setSectionCounter(first + i, counter);
+
+                if (i < cut.numSections)
+                    cascade.setCoefficients(first + i, cut.sections[(size_t) i]);
+            }
+        };
+
+        loadCut(0, engine.getLowCut(), PerformanceCounters::LowCut);
+        cascade.setCoefficients(4, engine.getPeak());
+        cascade.setSectionCounter(4, PerformanceCounters::Peak);
+        loadCut(5, engine.getHighCut(), PerformanceCounters::HighCut);
+
+        juce::AudioBuffer<float> buffer(noise);
+        juce::ScopedNoDenormals noDenormals;
+        juce::uint64 cycles = 0;
+
+        for (int start = 0; start < numSamples; start += blockSize)
+        {
+            auto startCycles = readCycleCounter();
+            processRange(cascade, buffer, start, juce::jmin(blockSize, numSamples - start));
+            cycles += readCycleCounter() - startCycles;
+        }
+
+        return (double) cycles / numSamples;
+    };
+
+    juce::String report;
+    report << "both cuts at the same slope, cycles/sample: one pass per section / fused kernels" << juce::newLine
+           << "slope       tdf2                       svf" << juce::newLine;
+
+    for (int slope = Slope_12; slope <= Slope_48; ++slope)
+    {
+        ChainSettings settings;
+        settings.lowCutFreq = 40.0f;
+        settings.highCutFreq = 12000.0f;
+        settings.lowCutSlope = (Slope) slope;
+        settings.highCutSlope = (Slope) slope;
+        settings.peakFreq = 1000.0f;
+        settings.peakGainInDecibels = 6.0f;
+        settings.peakQuality = 2.0f;
+
+        engine.design(settings, CoefficientEngine::AllStages);
+
+        report << (juce::String(12 * (slope + 1)) + " dB/Oct").paddedRight(' ', 12);
+
+        for (auto topology : { FilterTopology::TransposedDirectFormII, FilterTopology::StateVariable })
+        {
+            auto separate = measure(topology, 1);
+            auto fused = measure(topology, FilterCascade<float, 9>::maxRunLength);
+
+            report << (juce::String(separate, 2) + " / " + juce::String(fused, 2)
+                       + " (" + juce::String(separate / juce::jmax(1.0e-9, fused), 2) + "x)").paddedRight(' ', 27);
+        }
+
+        report << juce::newLine;
+    }
+
+    return report;
+}
+
+juce::String HeadlessRenderer::benchmarkCascade()
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr int blockSize = 512;
+    constexpr int numSamples = 10 * (int) sampleRate;
+
+    // the steepest fixed chain, every section in use
+    ChainSettings settings;
+    settings.lowCutFreq = 40.0f;
+    settings.highCutFreq = 12000.0f;
+    settings.lowCutSlope = Slope_48;
+    settings.highCutSlope = Slope_48;
+    settings.peakFreq = 1000.0f;
+    settings.peakGainInDecibels = 6.0f;
+    settings.peakQuality = 2.0f;
+
+    CoefficientEngine engine;
+    engine.prepare(sampleRate);
+    engine.design(settings, CoefficientEngine::AllStages);
+
+    std::vector<BiquadCoefficients> sections;
+    engine.forEachSection([&](const BiquadCoefficients& section) { sections.push_back(section); });
+    jassert(sections.size() == 9);
+
+    // what the processor ran before FilterCascade: a MonoChain per channel
+    using Filter = juce::dsp::IIR::Filter<float>;
+    using CutFilter = juce::dsp::ProcessorChain<Filter, Filter, Filter, Filter>;
+    using MonoChain = juce::dsp::ProcessorChain<CutFilter, Filter, CutFilter>;
+
+    auto makeCoefficients = [](const BiquadCoefficients& c)
+    {
+        return new juce::dsp::IIR::Coefficients<float>((float) c.b0, (float) c.b1, (float) c.b2, 1.0f, (float) c.a1, (float) c.a2);
+    };
+
+    auto loadCut = [&](CutFilter& cut, size_t first)
+    {
+        cut.get<0>().coefficients = makeCoefficients(sections[first]);
+        cut.get<1>().coefficients = makeCoefficients(sections[first + 1]);
+        cut.get<2>().coefficients = makeCoefficients(sections[first + 2]);
+        cut.get<3>().coefficients = makeCoefficients(sections[first + 3]);
+    };
+
+    juce::Random random(0x5eed);
+
+    juce::String report;
+    report << "48 dB/Oct cuts and a peak (9 sections), cycles per sample frame" << juce::newLine
+           << "channels   ProcessorChain   FilterCascade   speedup   largest difference" << juce::newLine;
+
+    for (auto numChannels : { 1, 2, 8 })
+    {
+        juce::AudioBuffer<float> noise(numChannels, numSamples);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            for (int i = 0; i < numSamples; ++i)
+                noise.setSample(channel, i, random.nextFloat() * 0.5f - 0.25f);
+
+        juce::ScopedNoDenormals noDenormals;
+
+        // old path, one chain per channel, each over its own channel of the block
+        std::vector<MonoChain> chains((size_t) numChannels);
+
+        for (auto& chain : chains)
+        {
+            chain.prepare({ sampleRate, (juce::uint32) blockSize, 1 });
+            loadCut(chain.get<0>(), 0);
+            chain.get<1>().coefficients = makeCoefficients(sections[4]);
+            loadCut(chain.get<2>(), 5);
+        }
+
+        juce::AudioBuffer<float> chainOutput(noise);
+        juce::uint64 chainCycles = 0;
+
+        for (int start = 0; start < numSamples; start += blockSize)
+        {
+            auto length = juce::jmin(blockSize, numSamples - start);
+            auto block = juce::dsp::AudioBlock<float>(chainOutput).getSubBlock((size_t) start, (size_t) length);
+            auto startCycles = readCycleCounter();
+
+            for (int channel = 0; channel < numChannels; ++channel)
+            {
+                auto channelBlock = block.getSingleChannelBlock((size_t) channel);
+                chains[(size_t) channel].process(juce::dsp::ProcessContextReplacing<float>(channelBlock));
+            }
+
+            chainCycles += readCycleCounter() - startCycles;
+        }
+
+        // new path, every channel in one cascade
+        FilterCascade<float, 9> cascade;
+        cascade.prepare({ sampleRate, (juce::uint32) blockSize, (juce::uint32) numChannels });
+
+        for (size_t i = 0; i < sections.size(); ++i)
+            cascade.setCoefficients((int) i, sections[i]);
+
+        juce::AudioBuffer<float> cascadeOutput(noise);
+        juce::uint64 cascadeCycles = 0;
+
+        for (int start = 0; start < numSamples; start += blockSize)
+        {
+            auto startCycles = readCycleCounter();
+            processRange(cascade, cascadeOutput, start, juce::jmin(blockSize, numSamples - start));
+            cascadeCycles += readCycleCounter() - startCycles;
+        }
+
+        auto worstDifference = 0.0f, peak = 0.0f;
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            for (int i = 0; i < numSamples; ++i)
+            {
+                peak = juce::jmax(peak, std::abs(chainOutput.getSample(channel, i)));
+                worstDifference = juce::jmax(worstDifference, std::abs(cascadeOutput.getSample(channel, i) - chainOutput.getSample(channel, i)));
+            }
+        }
+
+        auto chainPerSample = (double) chainCycles / numSamples;
+        auto cascadePerSample = (double) cascadeCycles / numSamples;
+
+        report << juce::String(numChannels).paddedRight(' ', 11)
+               << juce::String(chainPerSample, 2).paddedRight(' ', 17)
+               << juce::String(cascadePerSample, 2).paddedRight(' ', 16)
+               << (juce::String(chainPerSample / juce::jmax(1.0e-9, cascadePerSample), 2) + "x").paddedRight(' ', 10)
+               << juce::String(worstDifference) << " ("
+               << juce::String(juce::Decibels::gainToDecibels(worstDifference / juce::jmax(1.0e-9f, peak), -200.0f), 1)
+               << " dB below the peak)" << juce::newLine;
+    }
+
+    return report;
+}
+
+juce::String HeadlessRenderer::benchmarkState(int numInstances)
+{
+    numInstances = juce::jmax(1, numInstances);
+
+    std::vector<std::unique_ptr<SimpleEQAudioProcessor>> processors;
+    juce::Random random(0x5eed);
+
+    // every instance gets its own random settings, a session full of default instances isn't realistic
+    for (int i = 0; i < numInstances; ++i)
+    {
+        processors.push_back(std::make_unique<SimpleEQAudioProcessor>());
+
+        for (auto* parameter : processors.back()->getParameters())
+            parameter->setValueNotifyingHost(random.nextFloat());
+    }
+
+    std::vector<juce::MemoryBlock> binary((size_t) numInstances), xml((size_t) numInstances);
+    auto time = [numInstances](std::function<void(int)> fn)
+    {
+        auto start = juce::Time::getMillisecondCounterHiRes();
+
+        for (int i = 0; i < numInstances; ++i)
+            fn(i);
+
+        return (juce::Time::getMillisecondCounterHiRes() - start) * 1000.0 / numInstances;
+    };
+
+    auto binarySave = time([&](int i) { processors[(size_t) i]->getStateInformation(binary[(size_t) i]); });
+    auto binaryLoad = time([&](int i) { processors[(size_t) i]->setStateInformation(binary[(size_t) i].getData(), (int) binary[(size_t) i].getSize()); });
+
+    // what a typical APVTS plugin does: copyState -> XML -> binary, and back
+    auto xmlSave = time([&](int i)
+    {
+        if (auto element = processors[(size_t) i]->apvts.copyState().createXml())
+            juce::AudioProcessor::copyXmlToBinary(*element, xml[(size_t) i]);
+    });
+
+    auto xmlLoad = time([&](int i)
+    {
+        if (auto element = juce::AudioProcessor::getXmlFromBinary(xml[(size_t) i].getData(), (int) xml[(size_t) i].getSize()))
+            processors[(size_t) i]->apvts.replaceState(juce::ValueTree::fromXml(*element));
+    });
+
+    juce::String report;
+    report << numInstances << " instances, time per instance" << juce::newLine
+           << "         save (us)   load (us)   bytes" << juce::newLine
+           << "binary   " << juce::String(binarySave, 2).paddedRight(' ', 12) << juce::String(binaryLoad, 2).paddedRight(' ', 12)
+           << (int) binary.front().getSize() << juce::newLine
+           << "xml      " << juce::String(xmlSave, 2).paddedRight(' ', 12) << juce::String(xmlLoad, 2).paddedRight(' ', 12)
+           << (int) xml.front().getSize() << juce::newLine;
+
+    return report;
+}
+
+juce::String HeadlessRenderer::benchmarkParameterReads(int numInstances)
+{
+    numInstances = juce::jmax(1, numInstances);
+    constexpr int numBlocks = 100;
+
+    std::vector<std::unique_ptr<SimpleEQAudioProcessor>> processors;
+    juce::Random random(0x5eed);
+
+    for (int i = 0; i < numInstances; ++i)
+    {
+        processors.push_back(std::make_unique<SimpleEQAudioProcessor>());
+
+        for (auto* parameter : processors.back()->getParameters())
+            parameter->setValueNotifyingHost(random.nextFloat());
+    }
+
+    // both ways have to read the same thing, or the comparison means nothing
+    auto identical = std::all_of(processors.begin(), processors.end(), [](const std::unique_ptr<SimpleEQAudioProcessor>& processor)
+    {
+        return getChainSettings(processor->apvts) == getChainSettings(processor->getParameterHandles(0));
+    });
+
+    // every instance reads its settings once a block, like processBlock. sink keeps the reads from being optimised away
+    volatile float sink = 0.0f;
+
+    auto time = [&](auto&& read)
+    {
+        auto start = juce::Time::getHighResolutionTicks();
+        auto sum = 0.0f;
+
+        for (int block = 0; block < numBlocks; ++block)
+            for (auto& processor : processors)
+                sum += read(*processor).peakFreq;
+
+        sink = sum;
+
+        return juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start) * 1.0e6 / numBlocks;
+    };
+
+    auto lookups = time([](SimpleEQAudioProcessor& processor) { return getChainSettings(processor.apvts); });
+    auto handles = time([](SimpleEQAudioProcessor& processor) { return getChainSettings(processor.getParameterHandles(0)); });
+
+    juce::String report;
+    report << numInstances << " instances, getChainSettings() once a block each" << juce::newLine
+           << "              per instance (us)   per block, all instances (us)" << juce::newLine
+           << "lookups       " << juce::String(lookups / numInstances, 3).paddedRight(' ', 20) << juce::String(lookups, 1) << juce::newLine
+           << "handles       " << juce::String(handles / numInstances, 3).paddedRight(' ', 20) << juce::String(handles, 1) << juce::newLine
+           << "speedup       " << juce::String(lookups / juce::jmax(1.0e-9, handles), 1) << "x, "
+           << (identical ? "same settings both ways" : "SETTINGS DIFFER") << juce::newLine;
+
+    // a 512 sample block at 48 kHz, for scale
+    report << "share of a 512 sample block at 48 kHz: " << juce::String(lookups / (512.0 / 48000.0 * 1.0e6) * 100.0, 1)
+           << "% with lookups, " << juce::String(handles / (512.0 / 48000.0 * 1.0e6) * 100.0, 2) << "% with handles" << juce::newLine;
+
+    return report;
+}
+
+juce::String HeadlessRenderer::benchmarkSharedDesigns(int numInstances)
+{
+    numInstances = juce::jmax(1, numInstances);
+
+    // one session's worth of identical instances, on the parameter grid like real ones
+    ChainSettings settings;
+    settings.lowCutFreq = 80.0f;
+    settings.highCutFreq = 12000.0f;
+    settings.lowCutSlope = Slope_48;
+    settings.highCutSlope = Slope_48;
+    settings.peakFreq = 2500.0f;
+    settings.peakGainInDecibels = 3.5f;
+    settings.peakQuality = 1.4f;
+
+    for (int i = 0; i < 8; ++i)
+    {
+        auto& band = settings.bands[(size_t) i];
+        band.enabled = true;
+        band.type = (BandType) (i % 5);
+        band.freq = (float) juce::roundToInt(50.0 * std::pow(2.0, i));
+        band.gainInDecibels = -2.0f;
+        band.quality = 0.7f;
+    }
+
+    std::vector<std::unique_ptr<CoefficientEngine>> engines;
+
+    for (int i = 0; i < numInstances; ++i)
+    {
+        engines.push_back(std::make_unique<CoefficientEngine>());
+        engines.back()->prepare(48000.0);
+    }
+
+    auto time = [&](bool shareDesigns)
+    {
+        auto start = juce::Time::getHighResolutionTicks();
+
+        for (auto& engine : engines)
+            engine->design(settings, CoefficientEngine::AllStages, shareDesigns);
+
+        return juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start) * 1.0e6 / numInstances;
+    };
+
+    auto before = CoefficientCache::getInstance().getStats();
+    auto own = time(false);
+    auto shared = time(true);
+    auto after = CoefficientCache::getInstance().getStats();
+
+    juce::String report;
+    report << numInstances << " instances at the same settings, design time per instance" << juce::newLine
+           << "own designs      " << juce::String(own, 3) << " us" << juce::newLine
+           << "shared designs   " << juce::String(shared, 3) << " us" << juce::newLine
+           << "cache            " << (after.entries - before.entries) << " new entries, " << after.inUse << " in use, "
+           << (after.evictions - before.evictions) << " evicted, "
+           << juce::String((double) after.memoryBytes / 1024.0, 1) << " kB preallocated for the whole process" << juce::newLine;
+
+    // hits and misses are only counted with the instrumentation compiled in
+    if (PerformanceCounters::enabled)
+    {
+        auto hits = after.hits - before.hits;
+        auto lookups = hits + after.misses - before.misses;
+
+        report << "hit rate         " << juce::String(lookups > 0 ? 100.0 * (double) hits / (double) lookups : 0.0, 1)
+               << "% (" << hits << " / " << lookups << ")" << juce::newLine;
+    }
+
+    return report;
+}
+
+juce::Result HeadlessRenderer::fuzzState(int iterations, juce::String& report)
+{
+    SimpleEQAudioProcessor source, destination;
+    juce::Random random(0x5eed);
+
+    auto& sourceParameters = source.getParameters();
+    auto& destinationParameters = destination.getParameters();
+
+    auto checkInRange = [&](const juce::String& what)
+    {
+        for (auto* parameter : destinationParameters)
+        {
+            auto value = parameter->getValue();
+
+            if (! std::isfinite(value) || value < 0.0f || value > 1.0f)
+                return juce::Result::fail(what + " left " + parameter->getName(64) + " at " + juce::String(value));
+        }
+
+        return juce::Result::ok();
+    };
+
+    int corruptStates = 0;
+
+    for (int iteration = 0; iteration < iterations; ++iteration)
+    {
+        for (auto* parameter : sourceParameters)
+            parameter->setValueNotifyingHost(random.nextFloat());
+
+        juce::MemoryBlock state;
+        source.getStateInformation(state);
+        destination.setStateInformation(state.getData(), (int) state.getSize());
+
+        for (int i = 0; i < sourceParameters.size(); ++i)
+        {
+            auto expected = sourceParameters[i]->getValue();
+            auto actual = destinationParameters[i]->getValue();
+
+            if (std::abs(expected - actual) > 1.0e-6f)
+                return juce::Result::fail("Iteration " + juce::String(iteration) + ": " + sourceParameters[i]->getName(64)
+                                          + " came back as " + juce::String(actual) + ", expected " + juce::String(expected));
+        }
+
+        // then something broken: cut short, a few bits flipped, or plain noise
+        juce::MemoryBlock corrupt(state);
+
+        switch (iteration % 3)
+        {
+            case 0:
+                corrupt.setSize((size_t) random.nextInt((int) state.getSize()));
+                break;
+
+            case 1:
+                for (int flips = 1 + random.nextInt(8); --flips >= 0;)
+                    corrupt[(int) random.nextInt((int) corrupt.getSize())] ^= (char) (1 << random.nextInt(8));
+                break;
+
+            default:
+                corrupt.setSize((size_t) random.nextInt(4096));
+                random.fillBitsRandomly(corrupt.getData(), corrupt.getSize());
+                break;
+        }
+
+        destination.setStateInformation(corrupt.getData(), (int) corrupt.getSize());
+        ++corruptStates;
+
+        auto result = checkInRange("Corrupt state (iteration " + juce::String(iteration) + ")");
+
+        if (result.failed())
+            return result;
+    }
+
+    report << iterations << " round trips exact, " << corruptStates << " corrupt states rejected or clamped";
+    return juce::Result::ok();
+}
+
+juce::Result HeadlessRenderer::checkRealtimeSafety(int numTrials, juce::String& report)
+{
+    // Stands in for the host: the processor calling back into it (updateHostDisplay, setLatencySamples) from the audio
+    // thread is a violation too. Parameter changes are how hosts hear about automation, those are fine
+    struct HostCallbacks : public juce::AudioProcessorListener
+    {
+        void audioProcessorParameterChanged(juce::AudioProcessor*, int, float) override {}
+
+        void audioProcessorChanged(juce::AudioProcessor*, const ChangeDetails&) override
+        {
+            RealtimeGuard::check(RealtimeGuard::HostCallback, "audioProcessorChanged");
+        }
+    };
+
+    const double sampleRates[] { 44100.0, 48000.0, 88200.0, 96000.0, 192000.0 };
+    const int maxBlockSizes[] { 32, 64, 128, 256, 480, 512, 1024, 2048, 4096 };
+    const int channelCounts[] { 1, 2, 2, 2, 6 };
+    const char* precisions[] { "float", "double", "mixed" };
+    constexpr int blocksPerTrial = 300;
+
+    juce::Random random(0x5eed);
+    juce::MidiBuffer midi;
+    auto ticksPerMicro = (double) juce::Time::getHighResolutionTicksPerSecond() / 1.0e6;
+
+    for (int kind = 0; kind < RealtimeGuard::numKinds; ++kind)
+        if (! RealtimeGuard::canDetect((RealtimeGuard::Kind) kind))
+            report << "(no hooks for " << RealtimeGuard::getKindName((RealtimeGuard::Kind) kind) << " on this platform)" << juce::newLine;
+
+    report << "trial   rate     max block   channels   precision   topology   worst block (us)   of budget   violations" << juce::newLine;
+
+    std::uint64_t totalViolations = 0;
+    std::uint64_t totals[RealtimeGuard::numKinds] {};
+    juce::String firstFailure;
+    double worstMicros = 0.0, worstBudget = 0.0;
+
+    for (int trial = 0; trial < numTrials; ++trial)
+    {
+        auto sampleRate = sampleRates[random.nextInt(juce::numElementsInArray(sampleRates))];
+        auto maxBlockSize = maxBlockSizes[random.nextInt(juce::numElementsInArray(maxBlockSizes))];
+        auto numChannels = channelCounts[random.nextInt(juce::numElementsInArray(channelCounts))];
+        juce::String precision = precisions[random.nextInt(juce::numElementsInArray(precisions))];
+        auto useSidechain = random.nextBool();
+
+        //==============================================================================
+        // Everything up to the first processBlock is allowed to allocate and lock, none of it is guarded
+        HostCallbacks hostCallbacks;
+        SimpleEQAudioProcessor processor;
+        processor.addListener(&hostCallbacks);
+
+        auto layout = juce::AudioChannelSet::canonicalChannelSet(numChannels);
+
+        juce::AudioProcessor::BusesLayout buses;
+        buses.inputBuses.add(layout);
+        buses.inputBuses.add(useSidechain ? juce::AudioChannelSet::stereo() : juce::AudioChannelSet::disabled());
+        buses.outputBuses.add(layout);
+
+        if (! processor.setBusesLayout(buses))
+            return juce::Result::fail("Processor rejected a " + juce::String(numChannels) + " channel layout");
+
+        auto useDoubleBuffers = precision == "double";
+
+        if (useDoubleBuffers)
+            processor.setProcessingPrecision(juce::AudioProcessor::doublePrecision);
+        else if (precision == "mixed")
+            processor.setMixedPrecision(true);
+
+        const int smoothingMs[] { 0, 5, 20, 50 };
+        processor.setParameterSmoothing(smoothingMs[random.nextInt(juce::numElementsInArray(smoothingMs))] / 1000.0,
+                                        1 << random.nextInt({ 3, 7 }));
+        processor.setOversamplingUsesFIR(random.nextBool());
+        processor.setSilenceBypass(random.nextBool());
+
+        auto topology = random.nextBool() ? FilterTopology::StateVariable : FilterTopology::TransposedDirectFormII;
+        processor.setFilterTopology(topology);
+
+        // a random starting point, so the first block doesn't always see the defaults
+        for (auto* parameter : processor.getParameters())
+            parameter->setValueNotifyingHost(random.nextFloat());
+
+        processor.setRateAndBufferSizeDetails(sampleRate, maxBlockSize);
+        processor.prepareToPlay(sampleRate, maxBlockSize);
+
+        if (random.nextBool())
+            processor.getAnalyzer().setActive(true);
+
+        auto topologyName = topology == FilterTopology::StateVariable ? "svf" : "tdf2";
+        auto numBufferChannels = juce::jmax(processor.getTotalNumInputChannels(), processor.getTotalNumOutputChannels());
+
+        // room for blocks up to twice what the processor was prepared for
+        juce::AudioBuffer<float> buffer(numBufferChannels, maxBlockSize * 2);
+        juce::AudioBuffer<double> doubleBuffer(useDoubleBuffers ? numBufferChannels : 0, maxBlockSize * 2);
+
+        // What a host can automate from the audio thread, and the switches that are only for the UI and sessions
+        auto& parameters = processor.getParameters();
+        juce::Array<juce::AudioProcessorParameter*> automatable, uiOnly;
+
+        for (auto* parameter : parameters)
+            (parameter->isAutomatable() ? automatable : uiOnly).add(parameter);
+
+        constexpr int maxAutomatedPerBlock = 3;
+        juce::AudioProcessorParameter* automated[maxAutomatedPerBlock] {};
+        float automatedValues[maxAutomatedPerBlock] {};
+
+        juce::StringArray changed;
+        double trialWorstMicros = 0.0, trialWorstBudget = 0.0;
+        auto currentRate = sampleRate;
+
+        RealtimeGuard::reset();
+
+        for (int block = 0; block < blocksPerTrial; ++block)
+        {
+            // Mostly full blocks, but hosts hand over anything from 1 sample up to the size they prepared with, and now
+            // and then more than that (processBlock has to chunk those)
+            auto numSamples = maxBlockSize;
+            auto roll = random.nextInt(10);
+
+            if (roll < 2)
+                numSamples = 1 + random.nextInt(maxBlockSize);
+            else if (roll == 2)
+                numSamples = maxBlockSize + 1 + random.nextInt(maxBlockSize);
+
+            buffer.setSize(numBufferChannels, numSamples, false, false, true);
+
+            // noise with the odd stretch of silence, so the silence bypass comes and goes as well
+            auto silent = random.nextInt(5) == 0;
+
+            for (int channel = 0; channel < numBufferChannels; ++channel)
+                for (int i = 0; i < numSamples; ++i)
+                    buffer.setSample(channel, i, silent ? 0.0f : random.nextFloat() * 0.5f - 0.25f);
+
+            if (useDoubleBuffers)
+                doubleBuffer.makeCopyOf(buffer, true);
+
+            /* Automation the way a host delivers it: a few parameters on the audio thread right before the block, under
+                the guard like processBlock itself (stereo mode, dynamics, bands coming and going...). Now and then from
+                the message thread instead: everything at once like a preset or session load, or one of the switches
+                only the UI changes (linear phase, oversampling)
+             */
+            changed.clearQuick();
+            auto numAutomated = 0;
+
+            if (random.nextInt(50) == 0)
+            {
+                for (auto* parameter : parameters)
+                    parameter->setValueNotifyingHost(random.nextFloat());
+
+                changed.add("every parameter");
+            }
+            else if (! uiOnly.isEmpty() && random.nextInt(25) == 0)
+            {
+                auto* parameter = uiOnly[random.nextInt(uiOnly.size())];
+                parameter->setValueNotifyingHost(random.nextFloat());
+                changed.add(parameter->getName(64) + " (message thread)");
+            }
+            else
+            {
+                numAutomated = random.nextInt(maxAutomatedPerBlock + 1);
+
+                for (int i = 0; i < numAutomated; ++i)
+                {
+                    automated[i] = automatable[random.nextInt(automatable.size())];
+                    automatedValues[i] = random.nextFloat();
+                    changed.add(automated[i]->getName(64));
+                }
+            }
+
+            // the topology switch happens inside the next processBlock, so it gets checked as well
+            if (random.nextInt(100) == 0)
+            {
+                topology = topology == FilterTopology::StateVariable ? FilterTopology::TransposedDirectFormII : FilterTopology::StateVariable;
+                processor.setFilterTopology(topology);
+                changed.add("topology");
+            }
+
+            // A host switching sample rate re-prepares (unguarded, like the first time). The cut table for the new rate
+            // may still be building on its own thread when the next block comes in
+            if (random.nextInt(100) == 0)
+            {
+                currentRate = sampleRates[random.nextInt(juce::numElementsInArray(sampleRates))];
+                processor.setRateAndBufferSizeDetails(currentRate, maxBlockSize);
+                processor.prepareToPlay(currentRate, maxBlockSize);
+                changed.add("sample rate");
+            }
+
+            auto violationsBefore = RealtimeGuard::getTotalCount();
+            auto startTicks = juce::Time::getHighResolutionTicks();
+
+            {
+                RealtimeGuard::Scope realtime;
+
+                {
+                    // JUCE's parameter dispatch takes the parameter's own listener lock in every plugin wrapper, that
+                    // one isn't ours to avoid. Allocations, system calls and calls back into the host still count
+                    RealtimeGuard::Tolerate juceListenerLock(RealtimeGuard::Lock);
+
+                    for (int i = 0; i < numAutomated; ++i)
+                        automated[i]->setValueNotifyingHost(automatedValues[i]);
+                }
+
+                if (useDoubleBuffers)
+                    processor.processBlock(doubleBuffer, midi);
+                else
+                    processor.processBlock(buffer, midi);
+            }
+
+            auto micros = (double) (juce::Time::getHighResolutionTicks() - startTicks) / ticksPerMicro;
+            auto budget = micros / (1.0e6 * numSamples / currentRate);
+
+            trialWorstMicros = juce::jmax(trialWorstMicros, micros);
+            trialWorstBudget = juce::jmax(trialWorstBudget, budget);
+
+            if (firstFailure.isEmpty() && RealtimeGuard::getTotalCount() > violationsBefore)
+                firstFailure << RealtimeGuard::getFirstViolation() << " in trial " << trial << ", block " << block
+                             << " (" << numSamples << " samples, after changing " << (changed.isEmpty() ? juce::String("nothing") : changed.joinIntoString(", ")) << ")";
+        }
+
+        std::uint64_t trialViolations = 0;
+
+        for (int kind = 0; kind < RealtimeGuard::numKinds; ++kind)
+        {
+            auto count = RealtimeGuard::getCount((RealtimeGuard::Kind) kind);
+            totals[kind] += count;
+            trialViolations += count;
+        }
+
+        totalViolations += trialViolations;
+        worstMicros = juce::jmax(worstMicros, trialWorstMicros);
+        worstBudget = juce::jmax(worstBudget, trialWorstBudget);
+
+        report << juce::String(trial).paddedRight(' ', 8)
+               << juce::String(sampleRate, 0).paddedRight(' ', 9)
+               << juce::String(maxBlockSize).paddedRight(' ', 12)
+               << (juce::String(numChannels) + (useSidechain ? " + sc" : "")).paddedRight(' ', 11)
+               << precision.paddedRight(' ', 12)
+               << juce::String(topologyName).paddedRight(' ', 11)
+               << juce::String(trialWorstMicros, 1).paddedRight(' ', 19)
+               << (juce::String(trialWorstBudget * 100.0, 1) + "%").paddedRight(' ', 12)
+               << juce::String((juce::int64) trialViolations) << juce::newLine;
+    }
+
+    /* The coefficient update path on its own: every cut / peak parameter moves before every block, with smoothing off
+        (each block redesigns every stage in one go) and on, and with the cut table off (the cuts are designed from
+        scratch) and on (looked up). The random trials above never turn the table on
+     */
+    report << juce::newLine << "coefficient updates, every block   smoothing   cut table   violations" << juce::newLine;
+
+    const char* filterParameterIDs[] { "LowCut Freq", "LowCut Slope", "HighCut Freq", "HighCut Slope", "Peak Freq", "Peak Gain", "Peak Quality" };
+
+    for (int configuration = 0; configuration < 4; ++configuration)
+    {
+        auto smoothing = (configuration & 1) != 0;
+        auto cutTable = (configuration & 2) != 0;
+
+        HostCallbacks hostCallbacks;
+        SimpleEQAudioProcessor processor;
+        processor.addListener(&hostCallbacks);
+        processor.setParameterSmoothing(smoothing ? 0.02 : 0.0, 32);
+        processor.setCutFilterTableResolution(cutTable ? 48 : 0);
+
+        constexpr double sampleRate = 48000.0;
+        constexpr int blockSize = 512;
+
+        // an offline prepare waits for the cut table, so the lookups are what gets checked rather than the fallback
+        processor.setNonRealtime(true);
+        processor.setRateAndBufferSizeDetails(sampleRate, blockSize);
+        processor.prepareToPlay(sampleRate, blockSize);
+
+        juce::Array<juce::AudioProcessorParameter*> filterParameters;
+
+        for (auto* parameterID : filterParameterIDs)
+            filterParameters.add(processor.apvts.getParameter(parameterID));
+
+        juce::AudioBuffer<float> buffer(juce::jmax(processor.getTotalNumInputChannels(), processor.getTotalNumOutputChannels()), blockSize);
+        juce::Array<float> values;
+        values.resize(filterParameters.size());
+
+        RealtimeGuard::reset();
+
+        for (int block = 0; block < blocksPerTrial; ++block)
+        {
+            for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+                for (int i = 0; i < blockSize; ++i)
+                    buffer.setSample(channel, i, random.nextFloat() * 0.5f - 0.25f);
+
+            for (auto& value : values)
+                value = random.nextFloat();
+
+            auto violationsBefore = RealtimeGuard::getTotalCount();
+
+            {
+                RealtimeGuard::Scope realtime;
+
+                {
+                    RealtimeGuard::Tolerate juceListenerLock(RealtimeGuard::Lock);
+
+                    for (int i = 0; i < filterParameters.size(); ++i)
+                        filterParameters[i]->setValueNotifyingHost(values[i]);
+                }
+
+                processor.processBlock(buffer, midi);
+            }
+
+            if (firstFailure.isEmpty() && RealtimeGuard::getTotalCount() > violationsBefore)
+                firstFailure << RealtimeGuard::getFirstViolation() << " in the coefficient update pass (smoothing "
+                             << (smoothing ? "on" : "off") << ", cut table " << (cutTable ? "on" : "off") << "), block " << block;
+        }
+
+        std::uint64_t passViolations = 0;
+
+        for (int kind = 0; kind < RealtimeGuard::numKinds; ++kind)
+        {
+            auto count = RealtimeGuard::getCount((RealtimeGuard::Kind) kind);
+            totals[kind] += count;
+            passViolations += count;
+        }
+
+        totalViolations += passViolations;
+
+        report << juce::String(blocksPerTrial).paddedRight(' ', 35)
+               << juce::String(smoothing ? "20 ms" : "off").paddedRight(' ', 12)
+               << juce::String(cutTable ? "48/oct" : "off").paddedRight(' ', 12)
+               << juce::String((juce::int64) passViolations) << juce::newLine;
+    }
+
+    report << juce::newLine << (numTrials + 4) * blocksPerTrial << " blocks, worst " << juce::String(worstMicros, 1) << " us, worst "
+           << juce::String(worstBudget * 100.0, 1) << "% of a block's realtime budget (random trials)" << juce::newLine;
+
+    for (int kind = 0; kind < RealtimeGuard::numKinds; ++kind)
+        report << "  " << juce::String(RealtimeGuard::getKindName((RealtimeGuard::Kind) kind)).paddedRight(' ', 15)
+               << juce::String((juce::int64) totals[kind]) << juce::newLine;
+
+    if (totalViolations > 0)
+        return juce::Result::fail(juce::String((juce::int64) totalViolations) + " realtime violations in processBlock or the automation before it, first: " + firstFailure);
+
+    return juce::Result::ok();
+}
+
+juce::uint64 HeadlessRenderer::readCycleCounter() noexcept
+{
+    // same clock the processor's own instrumentation uses, so the numbers line up
+    return PerformanceCounters::readCycleCounter();
+}
+
+double HeadlessRenderer::percentile(std::vector<double>& sortedValues, double fraction)
+{
+    if (sortedValues.empty())
+        return 0.0;
+
+    auto index = (size_t) juce::jlimit(0.0, (double) sortedValues.size() - 1.0, std::ceil(fraction * (double) sortedValues.size()) - 1.0);
+    return sortedValues[index];
+}
+
+//==============================================================================
+juce::Result HeadlessRenderer::run(RenderStats& stats)
+{
+    std::unique_ptr<juce::AudioFormatReader> reader;
+
+    if (options.inputFile.existsAsFile())
+    {
+        reader.reset(formatManager.createReaderFor(options.inputFile));
+
+        if (reader == nullptr)
+            return juce::Result::fail("Couldn't read " + options.inputFile.getFullPathName());
+    }
+
+    auto sampleRate = reader != nullptr ? reader->sampleRate : options.sampleRate;
+    auto numChannels = reader != nullptr ? (int) reader->numChannels : options.numChannels;
+    auto lengthInSamples = reader != nullptr ? reader->lengthInSamples : (juce::int64) (options.seconds * sampleRate);
+    auto blockSize = juce::jmax(1, options.blockSize);
+
+    if (numChannels <= 0 || lengthInSamples <= 0)
+        return juce::Result::fail("Nothing to render");
+
+    //==============================================================================
+    SimpleEQAudioProcessor processor;
+
+    auto layout = juce::AudioChannelSet::canonicalChannelSet(numChannels);
+
+    if (layout.isDisabled())
+        layout = juce::AudioChannelSet::discreteChannels(numChannels);
+
+    juce::AudioProcessor::BusesLayout buses;
+    buses.inputBuses.add(layout);
+    buses.outputBuses.add(layout);
+
+    // every bus needs an entry, the sidechain stays off
+    for (int bus = 1; bus < processor.getBusCount(true); ++bus)
+        buses.inputBuses.add(juce::AudioChannelSet::disabled());
+
+    if (! processor.setBusesLayout(buses))
+        return juce::Result::fail("Processor rejected a " + juce::String(numChannels) + " channel layout");
+
+    auto result = applyPreset(processor, options.preset);
+
+    if (result.wasOk())
+        result = applyParameters(processor, options.parameters);
+
+    if (result.failed())
+        return result;
+
+    auto useDoubleBuffers = options.precision == "double";
+
+    if (useDoubleBuffers)
+        processor.setProcessingPrecision(juce::AudioProcessor::doublePrecision);
+    else if (options.precision == "mixed")
+        processor.setMixedPrecision(true);
+    else if (options.precision != "float")
+        return juce::Result::fail("Unknown precision: " + options.precision + " (float, double or mixed)");
+
+    processor.setNonRealtime(true);
+    processor.setParameterSmoothing(options.smoothingMs / 1000.0, options.subBlockSize);
+    processor.setCutFilterTableResolution(options.cutTableEntriesPerOctave);
+    processor.setLinearPhaseKernelSize(options.kernelSize);
+    processor.setOversamplingUsesFIR(options.oversamplingFIR);
+    processor.setSilenceBypass(options.silenceBypass, options.silenceThresholdDecibels);
+
+    if (options.topology == "svf")
+        processor.setFilterTopology(FilterTopology::StateVariable);
+    else if (options.topology != "tdf2")
+        return juce::Result::fail("Unknown topology: " + options.topology + " (tdf2 or svf)");
+    processor.setRateAndBufferSizeDetails(sampleRate, blockSize);
+    processor.prepareToPlay(sampleRate, blockSize);
+
+    if (options.analyzer)
+        processor.getAnalyzer().setActive(true);
+
+    //==============================================================================
+    std::unique_ptr<juce::AudioFormatWriter> writer;
+
+    if (options.outputFile != juce::File())
+    {
+        auto* format = formatManager.findFormatForFileExtension(options.outputFile.getFileExtension());
+
+        if (format == nullptr)
+            return juce::Result::fail("No audio format for " + options.outputFile.getFileName());
+
+        options.outputFile.deleteFile();
+        auto stream = std::make_unique<juce::FileOutputStream>(options.outputFile);
+
+        if (stream->failedToOpen())
+            return juce::Result::fail("Couldn't open " + options.outputFile.getFullPathName());
+
+        writer.reset(format->createWriterFor(stream.get(), sampleRate, (unsigned int) numChannels,
+                                             reader != nullptr ? (int) reader->bitsPerSample : 24, {}, 0));
+
+        if (writer == nullptr)
+            return juce::Result::fail("Couldn't create a writer for " + options.outputFile.getFullPathName());
+
+        stream.release(); // the writer owns it now
+    }
+
+    //==============================================================================
+    juce::AudioBuffer<float> buffer(numChannels, blockSize);
+    juce::AudioBuffer<double> doubleBuffer(useDoubleBuffers ? numChannels : 0, blockSize);
+    juce::MidiBuffer midi;
+    juce::Random random(0x5eed);
+
+    auto blocksPerPass = (size_t) ((lengthInSamples + blockSize - 1) / blockSize);
+    std::vector<double> blockMicros;
+    blockMicros.reserve(blocksPerPass * (size_t) juce::jmax(1, options.repeats));
+
+    auto ticksPerMicro = (double) juce::Time::getHighResolutionTicksPerSecond() / 1.0e6;
+    juce::int64 totalTicks = 0;
+    juce::uint64 totalCycles = 0;
+    juce::int64 numBlocks = 0, numBypassedBlocks = 0;
+
+    for (int pass = 0; pass < juce::jmax(1, options.repeats); ++pass)
+    {
+        random.setSeed(0x5eed);
+
+        for (juce::int64 position = 0; position < lengthInSamples; position += blockSize)
+        {
+            auto numSamples = (int) juce::jmin((juce::int64) blockSize, lengthInSamples - position);
+            buffer.setSize(numChannels, numSamples, false, false, true);
+
+            if (reader != nullptr)
+            {
+                reader->read(&buffer, 0, numSamples, position, true, true);
+            }
+            else
+            {
+                for (int channel = 0; channel < numChannels; ++channel)
+                {
+                    auto* samples = buffer.getWritePointer(channel);
+
+                    for (int i = 0; i < numSamples; ++i)
+                        samples[i] = random.nextFloat() * 0.5f - 0.25f;
+                }
+
+                // sparse material: the noise only plays for the first sparseDuty of each second
+                if (options.sparseDuty < 1.0)
+                    for (int i = 0; i < numSamples; ++i)
+                        if (std::fmod((double) (position + i) / sampleRate, 1.0) >= options.sparseDuty)
+                            for (int channel = 0; channel < numChannels; ++channel)
+                                buffer.setSample(channel, i, 0.0f);
+            }
+
+            if (options.automate)
+                automate(processor, (double) position / sampleRate);
+
+            // sources and files are float, converting is part of the host's job not the plugin's so it stays off the clock
+            if (useDoubleBuffers)
+                doubleBuffer.makeCopyOf(buffer, true);
+
+            // only processBlock is on the clock, reading and writing files isn't what we're measuring
+            auto startCycles = readCycleCounter();
+            auto startTicks = juce::Time::getHighResolutionTicks();
+
+            if (useDoubleBuffers)
+                processor.processBlock(doubleBuffer, midi);
+            else
+                processor.processBlock(buffer, midi);
+
+            auto elapsedTicks = juce::Time::getHighResolutionTicks() - startTicks;
+            totalCycles += readCycleCounter() - startCycles;
+            totalTicks += elapsedTicks;
+            blockMicros.push_back((double) elapsedTicks / ticksPerMicro);
+
+            ++numBlocks;
+
+            if (processor.isBypassingSilence())
+                ++numBypassedBlocks;
+
+            if (useDoubleBuffers)
+                buffer.makeCopyOf(doubleBuffer, true);
+
+            if (writer != nullptr && pass == 0)
+                writer->writeFromAudioSampleBuffer(buffer, 0, numSamples);
+        }
+    }
+
+    stats.analyzerDroppedSamples = processor.getAnalyzer().getDroppedSamples();
+    stats.activeSections = processor.getNumActiveSections();
+    stats.bypassedBlocks = numBlocks > 0 ? (double) numBypassedBlocks / (double) numBlocks : 0.0;
+
+    if constexpr (PerformanceCounters::enabled)
+    {
+        stats.instrumentation = processor.getPerformanceCounters().toVar();
+        stats.instrumentationSummary = processor.getPerformanceCounters().toString();
+    }
+    processor.getAnalyzer().setActive(false);
+
+    processor.releaseResources();
+    writer.reset();
+
+    //==============================================================================
+    std::sort(blockMicros.begin(), blockMicros.end());
+
+    stats.numSamples = lengthInSamples * juce::jmax(1, options.repeats);
+    stats.numChannels = numChannels;
+    stats.blockSize = blockSize;
+    stats.sampleRate = sampleRate;
+    stats.precision = options.precision;
+    stats.topology = options.topology;
+    stats.latencySamples = processor.getLatencySamples();
+    stats.audioSeconds = (double) stats.numSamples / sampleRate;
+    stats.processSeconds = juce::Time::highResolutionTicksToSeconds(totalTicks);
+    stats.realtimeFactor = stats.processSeconds > 0.0 ? stats.audioSeconds / stats.processSeconds : 0.0;
+    stats.blockMicrosP50 = percentile(blockMicros, 0.50);
+    stats.blockMicrosP90 = percentile(blockMicros, 0.90);
+    stats.blockMicrosP99 = percentile(blockMicros, 0.99);
+    stats.blockMicrosMax = blockMicros.empty() ? 0.0 : blockMicros.back();
+    stats.cyclesPerSample = (double) totalCycles / (double) stats.numSamples;
+
+    return juce::Result::ok();
+}
+
+//==============================================================================
+juce::var RenderStats::toVar() const
+{
+    auto* object = new juce::DynamicObject();
+
+    object->setProperty("numSamples", numSamples);
+    object->setProperty("numChannels", numChannels);
+    object->setProperty("blockSize", blockSize);
+    object->setProperty("sampleRate", sampleRate);
+    object->setProperty("precision", precision);
+    object->setProperty("topology", topology);
+    object->setProperty("latencySamples", latencySamples);
+    object->setProperty("activeSections", activeSections);
+    object->setProperty("bypassedBlocks", bypassedBlocks);
+    object->setProperty("audioSeconds", audioSeconds);
+    object->setProperty("processSeconds", processSeconds);
+    object->setProperty("realtimeFactor", realtimeFactor);
+    object->setProperty("blockMicrosP50", blockMicrosP50);
+    object->setProperty("blockMicrosP90", blockMicrosP90);
+    object->setProperty("blockMicrosP99", blockMicrosP99);
+    object->setProperty("blockMicrosMax", blockMicrosMax);
+    object->setProperty("cyclesPerSample", cyclesPerSample);
+    object->setProperty("analyzerDroppedSamples", analyzerDroppedSamples);
+
+    if (! instrumentation.isVoid())
+        object->setProperty("instrumentation", instrumentation);
+
+    return juce::var(object);
+}
+
+juce::String RenderStats::toString() const
+{
+    juce::String s;
+
+    s << numChannels << " ch @ " << sampleRate << " Hz, block " << blockSize << ", " << precision << ", " << topology << ", " << audioSeconds << " s of audio" << juce::newLine
+      << "  latency          " << latencySamples << " samples" << juce::newLine
+      << "  active sections  " << activeSections << juce::newLine
+      << "  silent, bypassed " << juce::String(bypassedBlocks * 100.0, 1) << "% of blocks" << juce::newLine
+      << "  realtime factor  " << juce::String(realtimeFactor, 1) << "x" << juce::newLine
+      << "  block time (us)  p50 " << juce::String(blockMicrosP50, 2) << "  p90 " << juce::String(blockMicrosP90, 2)
+      << "  p99 " << juce::String(blockMicrosP99, 2) << "  max " << juce::String(blockMicrosMax, 2) << juce::newLine
+      << "  cycles / sample  " << juce::String(cyclesPerSample, 2) << juce::newLine;
+
+    if (analyzerDroppedSamples > 0)
+        s << "  analyzer dropped " << analyzerDroppedSamples << " samples" << juce::newLine;
+
+    if (instrumentationSummary.isNotEmpty())
+    {
+        s << "  per block cycles, from inside processBlock:" << juce::newLine;
+
+        for (auto& line : juce::StringArray::fromLines(instrumentationSummary.trimEnd()))
+            s << "    " << line << juce::newLine;
+    }
+
+    return s;
+}
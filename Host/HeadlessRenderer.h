@@ -0,0 +1,233 @@
+/*
+  ==============================================================================
+
+    HeadlessRenderer.h
+    Runs SimpleEQAudioProcessor outside a DAW and measures it.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "../Source/PluginProcessor.h"
+
+// Everything a render needs to know, filled in from the command line by Main.cpp
+struct RenderOptions
+{
+    juce::File inputFile;      // if this doesn't exist we render seeded white noise instead
+    juce::File outputFile;     // optional, format picked from the extension (.wav, .flac, .aiff...)
+
+    int blockSize { 512 };
+    int repeats { 1 };         // how many times to push the source through (output is only written on the first pass)
+
+    // used for the generated source only, a file brings its own
+    double sampleRate { 48000.0 };
+    int numChannels { 2 };
+    double seconds { 10.0 };
+
+    juce::String preset { "default" };
+    juce::StringPairArray parameters;   // "Peak Gain" -> "6", applied after the preset
+
+    // see SimpleEQAudioProcessor::setParameterSmoothing()
+    double smoothingMs { 20.0 };
+    int subBlockSize { 32 };
+
+    // sweep the cut and peak parameters every block, the way heavy host automation would
+    bool automate { false };
+
+    // see SimpleEQAudioProcessor::setCutFilterTableResolution()
+    int cutTableEntriesPerOctave { 0 };
+
+    // "float", "double" (double buffers and state) or "mixed" (float buffers, double state)
+    juce::String precision { "float" };
+
+    // "tdf2" or "svf", see SimpleEQAudioProcessor::setFilterTopology()
+    juce::String topology { "tdf2" };
+
+    // feed the spectrum analyzer the way an open editor would, to see what it costs processBlock
+    bool analyzer { false };
+
+    // see SimpleEQAudioProcessor::setLinearPhaseKernelSize(), only used with "Linear Phase" on
+    int kernelSize { 0 };
+
+    // see SimpleEQAudioProcessor::setOversamplingUsesFIR(), the factor itself is the "Oversampling" parameter
+    bool oversamplingFIR { false };
+
+    // see SimpleEQAudioProcessor::setSilenceBypass()
+    bool silenceBypass { true };
+    float silenceThresholdDecibels { -std::numeric_limits<float>::infinity() };
+
+    // generated source only: the noise plays for this fraction of every second and is digital silence for the rest
+    double sparseDuty { 1.0 };
+};
+
+struct RenderStats
+{
+    juce::int64 numSamples { 0 };       // sample frames processed (all repeats)
+    int numChannels { 0 };
+    int blockSize { 0 };
+    double sampleRate { 0.0 };
+    juce::String precision;
+    juce::String topology;
+    int latencySamples { 0 };          // what the processor reported to the host
+    int activeSections { 0 };          // biquad sections the cascade was running at the end of the render
+    double bypassedBlocks { 0.0 };      // fraction of blocks the silence bypass skipped the filters for
+
+    double audioSeconds { 0.0 };
+    double processSeconds { 0.0 };      // time spent inside processBlock only
+    double realtimeFactor { 0.0 };
+
+    // per-block processBlock time in microseconds
+    double blockMicrosP50 { 0.0 }, blockMicrosP90 { 0.0 }, blockMicrosP99 { 0.0 }, blockMicrosMax { 0.0 };
+
+    double cyclesPerSample { 0.0 };     // per sample frame, all channels
+
+    // Offline renders outrun the analyzer thread, samples it had no room for were skipped rather than copied
+    juce::int64 analyzerDroppedSamples { 0 };
+
+    // PerformanceCounters::toVar() / toString() from inside the processor, empty unless built with SIMPLEEQ_INSTRUMENTATION=1
+    juce::var instrumentation;
+    juce::String instrumentationSummary;
+
+    juce::var toVar() const;
+    juce::String toString() const;
+};
+
+//==============================================================================
+class HeadlessRenderer
+{
+public:
+    explicit HeadlessRenderer(const RenderOptions& options);
+
+    juce::Result run(RenderStats& stats);
+
+    //==============================================================================
+    // "default", "vocal", "steep", "sweep-low"... see the .cpp for the list
+    static juce::StringArray getPresetNames();
+    static juce::Result applyPreset(SimpleEQAudioProcessor& processor, const juce::String& presetName);
+    static juce::Result applyParameters(SimpleEQAudioProcessor& processor, const juce::StringPairArray& parameters);
+    static juce::Result setParameter(SimpleEQAudioProcessor& processor, const juce::String& parameterID, float value);
+
+    // Slow LFO sweeps over the frequency, gain and cut parameters for a point in time
+    static void automate(SimpleEQAudioProcessor& processor, double timeInSeconds);
+
+    /* Sweeps the cut frequency across the whole range for every slope at a few sample rates and compares the
+        table's magnitude response against direct design. Returns one line per sample rate with the worst dB error
+     */
+    static juce::String checkCutTableAccuracy(int entriesPerOctave);
+
+    /* Times drawing-sized response curves three ways: every section evaluated per point (what a naive editor
+        would do each repaint), ResponseCurve recomputing after a settings change, and ResponseCurve when nothing changed
+     */
+    static juce::String benchmarkResponseCurve();
+
+    /* Renders with the IIR chain, then in linear phase mode at kernel sizes from 1024 to 65536 samples,
+        and reports latency and speed for each
+     */
+    static juce::Result measureLinearPhaseCost(const RenderOptions& options, juce::String& report);
+
+    // Same idea for oversampling: off, 2x, 4x, 8x with the half-band filters options asks for
+    static juce::Result measureOversamplingCost(const RenderOptions& options, juce::String& report);
+
+    /* Renders with 0, 4, 8 ... 24 of the extra bands switched on (alternating bell / shelf / notch / tilt) and reports
+        cycles per sample for each, plus what each band added over the bands-off run. Should grow linearly
+     */
+    static juce::Result measureBandScaling(const RenderOptions& options, juce::String& report);
+
+    /* Renders generated noise that plays 100%, 50%, 25%, 10% and 0% of the time, once with the silence bypass off and
+        once with it on, and reports cycles per sample for both, the saving and how many blocks were skipped
+     */
+    static juce::Result measureSilenceBypass(const RenderOptions& options, juce::String& report);
+
+    /* What the dynamic mode costs. First a gain change turned into coefficients both ways: a full makePeakFilter
+        against the GainDesign update the dynamic stages use. Then renders with the Peak and eight bells static,
+        then the Peak dynamic, then all nine dynamic, reporting cycles per sample for each
+     */
+    static juce::Result measureDynamicEQ(const RenderOptions& options, juce::String& report);
+
+    /* Renders in each stereo mode with the second path set apart from the first (lower high cut, peak cut instead of
+        boost) and reports cycles per sample, then checks that Dual Mono and Mid/Side with both paths set the same
+        come out the same as Stereo. Fails if they drift by more than float rounding. Then switches a dynamic Peak off
+        half way through a Dual Mono render with both paths the same, and fails unless the two channels still match
+     */
+    static juce::Result measureStereoModes(const RenderOptions& options, juce::String& report);
+
+    /* Renders the same noise on every channel of mono, stereo, 5.1, 7.1.4 and 16 channel layouts and fails unless
+        every output channel matches channel 0 bit for bit. The buffer the processor gets has exactly the layout's
+        channels, with a guard channel behind it in memory that has to come back untouched. Reports cycles per sample
+        frame, per channel and per SIMD lane group, to show how the cost scales with the channel count. Then runs mono
+        through Dual Mono and Mid/Side with a dynamic Peak, which have to leave the missing second channel alone
+     */
+    static juce::Result measureChannelLayouts(const RenderOptions& options, juce::String& report);
+
+    /* Runs the same chain in each FilterTopology and compares them three ways: throughput on noise, float noise
+        against a double reference while a 48 db/Oct low cut is swept hard, and the cost of the silent tail after a
+        burst with denormals allowed (no ScopedNoDenormals) against flushed
+     */
+    static juce::String benchmarkTopologies();
+
+    /* Runs a decaying noise tail through the steepest fixed chain in each topology and precision, with and without
+        flush-to-zero and the cascade's own denormal protection, and reports cycles per sample for all four. Then times
+        a full prepareToPlay, a re-prepare at the same spec, reset() and a re-prepare at a new sample rate on the whole
+        processor, each with the first block after it
+     */
+    static juce::String benchmarkDenormals();
+
+    /* For each slope, runs the fixed chain once with every section making its own pass over the block and once with
+        the fused, compile-time unrolled kernels FilterCascade picks per run of sections, in both topologies
+     */
+    static juce::String benchmarkSlopeKernels();
+
+    /* The cascade against what it replaced: one juce::dsp::ProcessorChain of IIR::Filter<float> per channel (the old
+        MonoChain, LowCut / Peak / HighCut) and FilterCascade, both running the same 48 dB/Oct chain's coefficients over
+        the same noise at 1, 2 and 8 channels. Reports cycles per sample frame for each, the speedup and the largest
+        difference between their outputs
+     */
+    static juce::String benchmarkCascade();
+
+    /* Saves and restores numInstances processors through get/setStateInformation, then the same through the
+        APVTS's XML for comparison, and reports the time per instance and the state size for both
+     */
+    static juce::String benchmarkState(int numInstances);
+
+    /* What reading the parameters costs every block: getChainSettings() through the APVTS's string keyed lookups (what
+        processBlock did before ParameterHandles) against the handles the processor resolved once, for numInstances
+        instances with random settings. Reports the time per instance and per block across all of them, and flags it
+        if the two ever read different settings
+     */
+    static juce::String benchmarkParameterReads(int numInstances);
+
+    /* Round trips random parameter values through get/setStateInformation and checks they all come back, then feeds
+        setStateInformation truncated, bit flipped and random data and checks every parameter is still in range.
+        Fails on the first mismatch
+     */
+    static juce::Result fuzzState(int iterations, juce::String& report);
+
+    /* Runs processBlock under RealtimeGuard for numTrials freshly prepared processors, each at a random sample rate,
+        block size, channel layout, precision and topology. Automation of random parameters goes in under the guard right
+        before each block, the UI-only switches and whole presets from the message thread. Also varies the block length
+        (past the prepared size too) and now and then re-prepares at another rate. Reports the worst block time per
+        trial, fails on any allocation, lock, system call or call back into the host made on the audio thread.
+        Then a fixed pass over the coefficient update path: every cut / peak parameter changes before every block, with
+        smoothing off and on and the cut table off and on
+     */
+    static juce::Result checkRealtimeSafety(int numTrials, juce::String& report);
+
+    /* Designs every stage (and eight bands) at the same settings for numInstances coefficient engines, once each
+        designing on its own and once through the shared CoefficientCache, and reports the time per instance and
+        the cache's hit rate
+     */
+    static juce::String benchmarkSharedDesigns(int numInstances);
+
+    // Serial cycle counter where the CPU has one, otherwise derived from the high resolution clock
+    static juce::uint64 readCycleCounter() noexcept;
+
+private:
+    RenderOptions options;
+    juce::AudioFormatManager formatManager;
+
+    static double percentile(std::vector<double>& sortedValues, double fraction);
+
+    JUCE_DECLARE_NON_COPYABLE (HeadlessRenderer)
+};
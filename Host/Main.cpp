@@ -0,0 +1,399 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    SimpleEQHost - renders audio through SimpleEQAudioProcessor without a DAW
+    and reports how long processBlock took. This is the regression benchmark
+    for anything that touches processBlock or the filter chain.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "HeadlessRenderer.h"
+#include "BatchRenderer.h"
+
+namespace
+{
+    void printUsage()
+    {
+        std::cout << "SimpleEQHost - offline render and processBlock benchmark" << std::endl << std::endl
+                  << "  --input <file>         WAV/FLAC/AIFF to render (seeded white noise if omitted)" << std::endl
+                  << "  --output <file>        write the processed audio (format from the extension)" << std::endl
+                  << "  --block-size <n>       samples per processBlock call (default 512)" << std::endl
+                  << "  --repeats <n>          push the source through n times (default 1)" << std::endl
+                  << "  --sample-rate <hz>     generated source only (default 48000)" << std::endl
+                  << "  --channels <n>         generated source only (default 2)" << std::endl
+                  << "  --seconds <s>          generated source only (default 10)" << std::endl
+                  << "  --preset <name>        " << HeadlessRenderer::getPresetNames().joinIntoString(", ").toStdString() << std::endl
+                  << "  --set \"<id>=<value>\"   override a parameter after the preset, e.g. --set \"Peak Gain=6\"" << std::endl
+                  << "  --smoothing-ms <ms>    parameter ramp time, 0 = coefficients jump once per block (default 20)" << std::endl
+                  << "  --sub-block <n>        samples between coefficient updates while ramping (default 32)" << std::endl
+                  << "  --automate             sweep the frequency/gain parameters every block" << std::endl
+                  << "  --cut-table <n>        look cut filter designs up in a table with n entries/octave (default 0 = off)" << std::endl
+                  << "  --check-cut-table <n>  compare an n entries/octave table against direct design and exit" << std::endl
+                  << "  --response-curve       time the editor's response curve computation and exit" << std::endl
+                  << "  --state-benchmark <n>  time get/setStateInformation for n instances against XML and exit (default 1000)" << std::endl
+                  << "  --parameter-reads <n>  time reading the parameters per block by string lookup against cached handles for n instances, then exit (default 1000)" << std::endl
+                  << "  --state-fuzz <n>       n random state round trips plus corrupt states, then exit (default 1000)" << std::endl
+                  << "  --realtime-check <n>   n randomized runs of processBlock, failing on any allocation, lock or syscall in it (default 20)" << std::endl
+                  << "  --shared-designs <n>   time coefficient design for n identical instances with and without sharing, then exit (default 100)" << std::endl
+                  << "  --precision <mode>     float, double (double buffers) or mixed (float buffers, double filters) (default float)" << std::endl
+                  << "  --topology <name>      tdf2 (transposed direct form II) or svf (state variable) biquad sections (default tdf2)" << std::endl
+                  << "  --topology-benchmark   compare the topologies' speed, modulation noise and denormal cost, then exit" << std::endl
+                  << "  --denormal-benchmark   decaying tail with and without denormal protection, plus restart and reset cost, then exit" << std::endl
+                  << "  --cascade-benchmark    compare FilterCascade against a ProcessorChain of IIR::Filter per channel at 1, 2 and 8 channels, then exit" << std::endl
+                  << "  --slope-kernels        compare per-section passes against the fused cut kernels for every slope, then exit" << std::endl
+                  << "  --linear-phase         run the chain as a linear phase FIR (same as --set \"Linear Phase=1\")" << std::endl
+                  << "  --kernel-size <n>      linear phase kernel length in samples (default: ~170 ms worth)" << std::endl
+                  << "  --fir-scaling          compare the IIR chain against linear phase at kernel sizes 1024 to 65536" << std::endl
+                  << "  --oversampling <n>     run the IIR chain at 1, 2, 4 or 8 times the sample rate" << std::endl
+                  << "  --oversampling-fir     FIR half-band stages instead of polyphase IIR" << std::endl
+                  << "  --oversampling-scaling compare off, 2x, 4x and 8x" << std::endl
+                  << "  --band-scaling         compare 0, 4, 8 ... 24 extra bands switched on" << std::endl
+                  << "  --sparse <fraction>    generated noise plays for this fraction of every second, silence the rest (default 1)" << std::endl
+                  << "  --silence-threshold <dB> input at or below this counts as silence for the bypass (default: digital zero)" << std::endl
+                  << "  --no-silence-bypass    keep the filters running through silence" << std::endl
+                  << "  --silence-scaling      compare the silence bypass off and on for 100% down to 0% playing" << std::endl
+                  << "  --dynamic-scaling      cost of a dynamic gain update, then renders with 0, 1 and 9 dynamic stages" << std::endl
+                  << "  --stereo-modes         compare Stereo, Dual Mono and Mid/Side, and check the split modes match Stereo with both paths the same" << std::endl
+                  << "                         (and that switching Dynamic off reaches both paths)" << std::endl
+                  << "  --channel-scaling      render mono, stereo, 5.1, 7.1.4 and 16 channels, check every channel comes out the same and report cost per channel" << std::endl
+                  << "  --analyzer             feed the editor's spectrum analyzer while rendering" << std::endl
+                  << "  --json                 print the results as JSON" << std::endl << std::endl
+                  << "Batch mode:" << std::endl
+                  << "  --batch <dir>          render every audio file in dir (uses --preset, --set and --block-size)" << std::endl
+                  << "  --output-dir <dir>     where the rendered files go (nothing is written if omitted)" << std::endl
+                  << "  --threads <n>          workers, one processor each (default: one per core)" << std::endl
+                  << "  --chunk-seconds <s>    split longer files into parallel chunks, 0 = never (default 30)" << std::endl
+                  << "  --scaling              report throughput at 1, 2, 4 ... threads" << std::endl
+                  << "  --verify               compare chunked against straight-through rendering" << std::endl;
+    }
+
+    int runBatch(const juce::ArgumentList& args, const RenderOptions& renderOptions)
+    {
+        BatchOptions options;
+        options.render = renderOptions;
+
+        auto directory = args.getFileForOption("--batch");
+        auto found = directory.findChildFiles(juce::File::findFiles, false, "*.wav;*.flac;*.aif;*.aiff");
+        found.sort();
+        options.inputFiles.addArray(found);
+
+        if (args.containsOption("--output-dir"))
+            options.outputDirectory = args.getFileForOption("--output-dir");
+
+        if (args.containsOption("--threads"))
+            options.numThreads = args.getValueForOption("--threads").getIntValue();
+
+        if (args.containsOption("--chunk-seconds"))
+            options.chunkSeconds = args.getValueForOption("--chunk-seconds").getDoubleValue();
+
+        BatchRenderer renderer(options);
+        juce::Result result = juce::Result::ok();
+
+        if (args.containsOption("--verify"))
+        {
+            float maxDifference = 0.0f;
+
+            if ((result = renderer.verify(maxDifference)).wasOk())
+                std::cout << "chunked vs straight-through: max difference " << maxDifference
+                          << " (" << juce::Decibels::gainToDecibels(maxDifference) << " dBFS)" << std::endl;
+        }
+        else if (args.containsOption("--scaling"))
+        {
+            juce::String report;
+
+            if ((result = renderer.measureScaling(report)).wasOk())
+                std::cout << report << std::endl;
+        }
+        else
+        {
+            BatchStats stats;
+
+            if ((result = renderer.run(stats)).wasOk())
+            {
+                if (args.containsOption("--json"))
+                    std::cout << juce::JSON::toString(stats.toVar()) << std::endl;
+                else
+                    std::cout << stats.toString() << std::endl;
+            }
+        }
+
+        if (result.failed())
+        {
+            std::cerr << result.getErrorMessage() << std::endl;
+            return 1;
+        }
+
+        return 0;
+    }
+
+    juce::Result parseOptions(const juce::ArgumentList& args, RenderOptions& options)
+    {
+        if (args.containsOption("--input"))
+        {
+            options.inputFile = args.getFileForOption("--input");
+
+            if (! options.inputFile.existsAsFile())
+                return juce::Result::fail("Input file doesn't exist");
+        }
+
+        if (args.containsOption("--output"))
+            options.outputFile = args.getFileForOption("--output");
+
+        if (args.containsOption("--block-size"))
+            options.blockSize = args.getValueForOption("--block-size").getIntValue();
+
+        if (args.containsOption("--repeats"))
+            options.repeats = args.getValueForOption("--repeats").getIntValue();
+
+        if (args.containsOption("--sample-rate"))
+            options.sampleRate = args.getValueForOption("--sample-rate").getDoubleValue();
+
+        if (args.containsOption("--channels"))
+            options.numChannels = args.getValueForOption("--channels").getIntValue();
+
+        if (args.containsOption("--seconds"))
+            options.seconds = args.getValueForOption("--seconds").getDoubleValue();
+
+        if (args.containsOption("--preset"))
+            options.preset = args.getValueForOption("--preset");
+
+        if (args.containsOption("--smoothing-ms"))
+            options.smoothingMs = args.getValueForOption("--smoothing-ms").getDoubleValue();
+
+        if (args.containsOption("--sub-block"))
+            options.subBlockSize = args.getValueForOption("--sub-block").getIntValue();
+
+        options.automate = args.containsOption("--automate");
+
+        if (args.containsOption("--cut-table"))
+            options.cutTableEntriesPerOctave = args.getValueForOption("--cut-table").getIntValue();
+
+        if (args.containsOption("--precision"))
+            options.precision = args.getValueForOption("--precision").toLowerCase();
+
+        if (args.containsOption("--topology"))
+            options.topology = args.getValueForOption("--topology").toLowerCase();
+
+        options.analyzer = args.containsOption("--analyzer");
+
+        if (args.containsOption("--kernel-size"))
+            options.kernelSize = args.getValueForOption("--kernel-size").getIntValue();
+
+        if (args.containsOption("--linear-phase"))
+            options.parameters.set("Linear Phase", "1");
+
+        if (args.containsOption("--oversampling"))
+        {
+            auto factor = args.getValueForOption("--oversampling").getIntValue();
+
+            if (factor != 1 && factor != 2 && factor != 4 && factor != 8)
+                return juce::Result::fail("--oversampling expects 1, 2, 4 or 8");
+
+            // choice index: Off, 2x, 4x, 8x
+            options.parameters.set("Oversampling", juce::String(juce::roundToInt(std::log2(factor))));
+        }
+
+        options.oversamplingFIR = args.containsOption("--oversampling-fir");
+        options.silenceBypass = ! args.containsOption("--no-silence-bypass");
+
+        if (args.containsOption("--silence-threshold"))
+            options.silenceThresholdDecibels = args.getValueForOption("--silence-threshold").getFloatValue();
+
+        if (args.containsOption("--sparse"))
+            options.sparseDuty = juce::jlimit(0.0, 1.0, args.getValueForOption("--sparse").getDoubleValue());
+
+        // --set can be given more than once
+        for (int i = 0; i < args.size(); ++i)
+        {
+            if (args[i] != "--set")
+                continue;
+
+            auto assignment = i + 1 < args.size() ? args[i + 1].text : juce::String();
+
+            if (! assignment.containsChar('='))
+                return juce::Result::fail("--set expects \"<parameter id>=<value>\"");
+
+            options.parameters.set(assignment.upToFirstOccurrenceOf("=", false, false).trim(),
+                                   assignment.fromFirstOccurrenceOf("=", false, false).trim());
+        }
+
+        if (options.smoothingMs < 0.0 || options.subBlockSize <= 0)
+            return juce::Result::fail("Smoothing time can't be negative and the sub-block size must be positive");
+
+        if (options.blockSize <= 0 || options.repeats <= 0 || options.sampleRate <= 0.0
+            || options.numChannels <= 0 || options.seconds <= 0.0)
+            return juce::Result::fail("Block size, repeats, sample rate, channels and seconds must all be positive");
+
+        return juce::Result::ok();
+    }
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    // the APVTS needs a message manager to exist even though we never run its loop
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::ArgumentList args(argc, argv);
+
+    if (args.containsOption("--help|-h"))
+    {
+        printUsage();
+        return 0;
+    }
+
+    if (args.containsOption("--check-cut-table"))
+    {
+        std::cout << HeadlessRenderer::checkCutTableAccuracy(args.getValueForOption("--check-cut-table").getIntValue()) << std::endl;
+        return 0;
+    }
+
+    if (args.containsOption("--response-curve"))
+    {
+        std::cout << HeadlessRenderer::benchmarkResponseCurve() << std::endl;
+        return 0;
+    }
+
+    if (args.containsOption("--parameter-reads"))
+    {
+        auto numInstances = args.getValueForOption("--parameter-reads").getIntValue();
+        std::cout << HeadlessRenderer::benchmarkParameterReads(numInstances > 0 ? numInstances : 1000) << std::endl;
+        return 0;
+    }
+
+    if (args.containsOption("--state-benchmark"))
+    {
+        auto numInstances = args.getValueForOption("--state-benchmark").getIntValue();
+        std::cout << HeadlessRenderer::benchmarkState(numInstances > 0 ? numInstances : 1000) << std::endl;
+        return 0;
+    }
+
+    if (args.containsOption("--cascade-benchmark"))
+    {
+        std::cout << HeadlessRenderer::benchmarkCascade() << std::endl;
+        return 0;
+    }
+
+    if (args.containsOption("--slope-kernels"))
+    {
+        std::cout << HeadlessRenderer::benchmarkSlopeKernels() << std::endl;
+        return 0;
+    }
+
+    if (args.containsOption("--topology-benchmark"))
+    {
+        std::cout << HeadlessRenderer::benchmarkTopologies() << std::endl;
+        return 0;
+    }
+
+    if (args.containsOption("--denormal-benchmark"))
+    {
+        std::cout << HeadlessRenderer::benchmarkDenormals() << std::endl;
+        return 0;
+    }
+
+    if (args.containsOption("--shared-designs"))
+    {
+        auto numInstances = args.getValueForOption("--shared-designs").getIntValue();
+        std::cout << HeadlessRenderer::benchmarkSharedDesigns(numInstances > 0 ? numInstances : 100) << std::endl;
+        return 0;
+    }
+
+    if (args.containsOption("--state-fuzz"))
+    {
+        auto iterations = args.getValueForOption("--state-fuzz").getIntValue();
+        juce::String report;
+        auto result = HeadlessRenderer::fuzzState(iterations > 0 ? iterations : 1000, report);
+
+        if (result.failed())
+        {
+            std::cerr << result.getErrorMessage() << std::endl;
+            return 1;
+        }
+
+        std::cout << report << std::endl;
+        return 0;
+    }
+
+    if (args.containsOption("--realtime-check"))
+    {
+        auto trials = args.getValueForOption("--realtime-check").getIntValue();
+        juce::String report;
+        auto result = HeadlessRenderer::checkRealtimeSafety(trials > 0 ? trials : 20, report);
+
+        // the table is worth seeing either way, it says which run the violation was in
+        std::cout << report << std::endl;
+
+        if (result.failed())
+        {
+            std::cerr << result.getErrorMessage() << std::endl;
+            return 1;
+        }
+
+        return 0;
+    }
+
+    RenderOptions options;
+    auto result = parseOptions(args, options);
+
+    if (result.failed())
+    {
+        std::cerr << result.getErrorMessage() << std::endl << std::endl;
+        printUsage();
+        return 1;
+    }
+
+    if (args.containsOption("--batch"))
+        return runBatch(args, options);
+
+    if (args.containsOption("--fir-scaling") || args.containsOption("--oversampling-scaling") || args.containsOption("--band-scaling")
+        || args.containsOption("--silence-scaling") || args.containsOption("--dynamic-scaling") || args.containsOption("--stereo-modes")
+        || args.containsOption("--channel-scaling"))
+    {
+        juce::String report;
+
+        if (args.containsOption("--fir-scaling"))
+            result = HeadlessRenderer::measureLinearPhaseCost(options, report);
+        else if (args.containsOption("--oversampling-scaling"))
+            result = HeadlessRenderer::measureOversamplingCost(options, report);
+        else if (args.containsOption("--silence-scaling"))
+            result = HeadlessRenderer::measureSilenceBypass(options, report);
+        else if (args.containsOption("--dynamic-scaling"))
+            result = HeadlessRenderer::measureDynamicEQ(options, report);
+        else if (args.containsOption("--stereo-modes"))
+            result = HeadlessRenderer::measureStereoModes(options, report);
+        else if (args.containsOption("--channel-scaling"))
+            result = HeadlessRenderer::measureChannelLayouts(options, report);
+        else
+            result = HeadlessRenderer::measureBandScaling(options, report);
+
+        if (result.failed())
+        {
+            std::cerr << result.getErrorMessage() << std::endl;
+            return 1;
+        }
+
+        std::cout << report << std::endl;
+        return 0;
+    }
+
+    HeadlessRenderer renderer(options);
+    RenderStats stats;
+    result = renderer.run(stats);
+
+    if (result.failed())
+    {
+        std::cerr << result.getErrorMessage() << std::endl;
+        return 1;
+    }
+
+    if (args.containsOption("--json"))
+        std::cout << juce::JSON::toString(stats.toVar()) << std::endl;
+    else
+        std::cout << stats.toString() << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,358 @@
+/*
+  ==============================================================================
+
+    RealtimeGuard.cpp
+    Catches heap, lock and system calls made where the audio thread would be.
+
+    No JuceHeader here on purpose: this defines read, write, malloc... under their own names, which mustn't meet
+    the inline (fortified) versions of them that the system headers juce pulls in can carry.
+
+  ==============================================================================
+*/
+
+#include "RealtimeGuard.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#if defined (__linux__) && defined (__GLIBC__)
+ #define SIMPLEEQ_INTERPOSE_LIBC 1
+ #include <cerrno>
+ #include <dlfcn.h>
+ #include <pthread.h>
+ #include <sched.h>
+ #include <time.h>
+#else
+ #define SIMPLEEQ_INTERPOSE_LIBC 0
+#endif
+
+namespace
+{
+    // constant initialised, so the hooks can use all of these before (and after) any constructor has run
+    thread_local int guardDepth = 0;
+    thread_local int toleratedKinds = 0;
+
+    std::atomic<std::uint64_t> counts[RealtimeGuard::numKinds] {};
+    std::atomic<const char*> firstViolation { nullptr };
+}
+
+//==============================================================================
+RealtimeGuard::Scope::Scope() noexcept    { ++guardDepth; }
+RealtimeGuard::Scope::~Scope() noexcept   { --guardDepth; }
+
+RealtimeGuard::Tolerate::Tolerate(Kind kind) noexcept   : previousMask(toleratedKinds) { toleratedKinds |= 1 << kind; }
+RealtimeGuard::Tolerate::~Tolerate() noexcept           { toleratedKinds = previousMask; }
+
+bool RealtimeGuard::isGuarded() noexcept
+{
+    return guardDepth > 0;
+}
+
+bool RealtimeGuard::canDetect(Kind kind) noexcept
+{
+    return SIMPLEEQ_INTERPOSE_LIBC || kind == Allocation || kind == Deallocation || kind == HostCallback;
+}
+
+std::uint64_t RealtimeGuard::getCount(Kind kind) noexcept
+{
+    return counts[kind].load();
+}
+
+std::uint64_t RealtimeGuard::getTotalCount() noexcept
+{
+    std::uint64_t total = 0;
+
+    for (auto& count : counts)
+        total += count.load();
+
+    return total;
+}
+
+const char* RealtimeGuard::getFirstViolation() noexcept
+{
+    return firstViolation.load();
+}
+
+const char* RealtimeGuard::getKindName(Kind kind) noexcept
+{
+    switch (kind)
+    {
+        case Allocation:    return "allocations";
+        case Deallocation:  return "deallocations";
+        case Lock:          return "locks / waits";
+        case SystemCall:    return "system calls";
+        case HostCallback:  return "host callbacks";
+        case numKinds:      break;
+    }
+
+    return "";
+}
+
+void RealtimeGuard::reset() noexcept
+{
+    for (auto& count : counts)
+        count = 0;
+
+    firstViolation = nullptr;
+}
+
+void RealtimeGuard::check(Kind kind, const char* function) noexcept
+{
+    if (guardDepth <= 0 || (toleratedKinds & (1 << kind)) != 0)
+        return;
+
+    counts[kind].fetch_add(1, std::memory_order_relaxed);
+
+    const char* none = nullptr;
+    firstViolation.compare_exchange_strong(none, function);
+}
+
+//==============================================================================
+#if SIMPLEEQ_INTERPOSE_LIBC
+
+/* glibc's own entry points behind malloc & co. Going straight to them (rather than dlsym) means the allocator hooks
+    work from the very first allocation, before the dynamic linker could even answer
+ */
+extern "C"
+{
+    void* __libc_malloc(size_t);
+    void* __libc_calloc(size_t, size_t);
+    void* __libc_realloc(void*, size_t);
+    void* __libc_memalign(size_t, size_t);
+    void __libc_free(void*);
+}
+
+namespace
+{
+    void* rawAllocate(std::size_t size) noexcept    { return __libc_malloc(size); }
+    void rawFree(void* pointer) noexcept            { __libc_free(pointer); }
+
+    // The next definition of a symbol after ours, looked up on first use. No function statics: their guard could lock
+    template <typename Function>
+    struct NextSymbol
+    {
+        const char* name;
+        std::atomic<Function> function { nullptr };
+
+        Function get() noexcept
+        {
+            auto next = function.load(std::memory_order_relaxed);
+
+            if (next == nullptr)
+            {
+                next = reinterpret_cast<Function>(dlsym(RTLD_NEXT, name));
+                function.store(next, std::memory_order_relaxed);
+            }
+
+            return next;
+        }
+    };
+
+    NextSymbol<int (*)(pthread_mutex_t*)> nextMutexLock { "pthread_mutex_lock" };
+    NextSymbol<int (*)(pthread_rwlock_t*)> nextReadLock { "pthread_rwlock_rdlock" };
+    NextSymbol<int (*)(pthread_rwlock_t*)> nextWriteLock { "pthread_rwlock_wrlock" };
+    NextSymbol<int (*)(pthread_cond_t*, pthread_mutex_t*)> nextConditionWait { "pthread_cond_wait" };
+    NextSymbol<int (*)(pthread_cond_t*, pthread_mutex_t*, const timespec*)> nextConditionTimedWait { "pthread_cond_timedwait" };
+    NextSymbol<ssize_t (*)(int, void*, size_t)> nextRead { "read" };
+    NextSymbol<ssize_t (*)(int, const void*, size_t)> nextWrite { "write" };
+    NextSymbol<int (*)(const timespec*, timespec*)> nextNanosleep { "nanosleep" };
+    NextSymbol<int (*)(useconds_t)> nextUsleep { "usleep" };
+    NextSymbol<int (*)()> nextYield { "sched_yield" };
+}
+
+extern "C"
+{
+    // unistd.h stays out of this file (see the top), these are the only bits of it needed
+    ssize_t read(int, void*, size_t);
+    ssize_t write(int, const void*, size_t);
+    int usleep(useconds_t);
+
+    //==============================================================================
+    void* malloc(size_t size) noexcept
+    {
+        RealtimeGuard::check(RealtimeGuard::Allocation, "malloc");
+        return __libc_malloc(size);
+    }
+
+    void* calloc(size_t count, size_t size) noexcept
+    {
+        RealtimeGuard::check(RealtimeGuard::Allocation, "calloc");
+        return __libc_calloc(count, size);
+    }
+
+    void* realloc(void* pointer, size_t size) noexcept
+    {
+        RealtimeGuard::check(RealtimeGuard::Allocation, "realloc");
+        return __libc_realloc(pointer, size);
+    }
+
+    void* memalign(size_t alignment, size_t size) noexcept
+    {
+        RealtimeGuard::check(RealtimeGuard::Allocation, "memalign");
+        return __libc_memalign(alignment, size);
+    }
+
+    // what the aligned operator new ends up in
+    void* aligned_alloc(size_t alignment, size_t size) noexcept
+    {
+        RealtimeGuard::check(RealtimeGuard::Allocation, "aligned_alloc");
+        return __libc_memalign(alignment, size);
+    }
+
+    int posix_memalign(void** result, size_t alignment, size_t size) noexcept
+    {
+        RealtimeGuard::check(RealtimeGuard::Allocation, "posix_memalign");
+
+        if (alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0)
+            return EINVAL;
+
+        auto* pointer = __libc_memalign(alignment, size);
+
+        if (pointer == nullptr)
+            return ENOMEM;
+
+        *result = pointer;
+        return 0;
+    }
+
+    // freeing nothing is fine anywhere, a unique_ptr reset to null shouldn't count
+    void free(void* pointer) noexcept
+    {
+        if (pointer != nullptr)
+            RealtimeGuard::check(RealtimeGuard::Deallocation, "free");
+
+        __libc_free(pointer);
+    }
+
+    //==============================================================================
+    // try-locks never block, so they're left alone
+    int pthread_mutex_lock(pthread_mutex_t* mutex) noexcept
+    {
+        RealtimeGuard::check(RealtimeGuard::Lock, "pthread_mutex_lock");
+        return nextMutexLock.get()(mutex);
+    }
+
+    int pthread_rwlock_rdlock(pthread_rwlock_t* lock) noexcept
+    {
+        RealtimeGuard::check(RealtimeGuard::Lock, "pthread_rwlock_rdlock");
+        return nextReadLock.get()(lock);
+    }
+
+    int pthread_rwlock_wrlock(pthread_rwlock_t* lock) noexcept
+    {
+        RealtimeGuard::check(RealtimeGuard::Lock, "pthread_rwlock_wrlock");
+        return nextWriteLock.get()(lock);
+    }
+
+    int pthread_cond_wait(pthread_cond_t* condition, pthread_mutex_t* mutex)
+    {
+        RealtimeGuard::check(RealtimeGuard::Lock, "pthread_cond_wait");
+        return nextConditionWait.get()(condition, mutex);
+    }
+
+    int pthread_cond_timedwait(pthread_cond_t* condition, pthread_mutex_t* mutex, const timespec* time)
+    {
+        RealtimeGuard::check(RealtimeGuard::Lock, "pthread_cond_timedwait");
+        return nextConditionTimedWait.get()(condition, mutex, time);
+    }
+
+    //==============================================================================
+    ssize_t read(int file, void* buffer, size_t size)
+    {
+        RealtimeGuard::check(RealtimeGuard::SystemCall, "read");
+        return nextRead.get()(file, buffer, size);
+    }
+
+    ssize_t write(int file, const void* buffer, size_t size)
+    {
+        RealtimeGuard::check(RealtimeGuard::SystemCall, "write");
+        return nextWrite.get()(file, buffer, size);
+    }
+
+    int nanosleep(const timespec* duration, timespec* remaining)
+    {
+        RealtimeGuard::check(RealtimeGuard::SystemCall, "nanosleep");
+        return nextNanosleep.get()(duration, remaining);
+    }
+
+    int usleep(useconds_t microseconds)
+    {
+        RealtimeGuard::check(RealtimeGuard::SystemCall, "usleep");
+        return nextUsleep.get()(microseconds);
+    }
+
+    int sched_yield() noexcept
+    {
+        RealtimeGuard::check(RealtimeGuard::SystemCall, "sched_yield");
+        return nextYield.get()();
+    }
+}
+
+#else
+
+namespace
+{
+    void* rawAllocate(std::size_t size) noexcept    { return std::malloc(size); }
+    void rawFree(void* pointer) noexcept            { std::free(pointer); }
+}
+
+#endif
+
+//==============================================================================
+/* Every plain and nothrow form of the global operator new / delete. The aligned ones are left to the library, on
+    glibc they land in aligned_alloc above. These go to the allocator underneath directly, so with the libc hooks
+    in place one new is still only counted once
+ */
+void* operator new(std::size_t size)
+{
+    RealtimeGuard::check(RealtimeGuard::Allocation, "operator new");
+
+    if (auto* pointer = rawAllocate(size > 0 ? size : 1))
+        return pointer;
+
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    RealtimeGuard::check(RealtimeGuard::Allocation, "operator new[]");
+
+    if (auto* pointer = rawAllocate(size > 0 ? size : 1))
+        return pointer;
+
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    RealtimeGuard::check(RealtimeGuard::Allocation, "operator new");
+    return rawAllocate(size > 0 ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    RealtimeGuard::check(RealtimeGuard::Allocation, "operator new[]");
+    return rawAllocate(size > 0 ? size : 1);
+}
+
+void operator delete(void* pointer) noexcept
+{
+    if (pointer != nullptr)
+        RealtimeGuard::check(RealtimeGuard::Deallocation, "operator delete");
+
+    rawFree(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+    if (pointer != nullptr)
+        RealtimeGuard::check(RealtimeGuard::Deallocation, "operator delete[]");
+
+    rawFree(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept                   { operator delete(pointer); }
+void operator delete[](void* pointer, std::size_t) noexcept                 { operator delete[](pointer); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept         { operator delete(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept       { operator delete[](pointer); }
@@ -0,0 +1,75 @@
+/*
+  ==============================================================================
+
+    RealtimeGuard.h
+    Catches heap, lock and system calls made where the audio thread would be.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <cstdint>
+
+/* The host replaces the global operator new / delete, and on Linux with glibc it also interposes malloc, free, the
+    pthread lock and wait calls and the syscalls an audio thread is most likely to stumble into (read, write, sleeps,
+    sched_yield). Outside a Scope every hook just forwards to the real thing. Inside one, the call still goes through
+    but gets counted, so a whole run can be checked afterwards instead of dying on the first violation.
+
+    Only what the hooks see is caught: everywhere other than Linux / glibc that's operator new and delete, which
+    still covers every container and juce class, but not a raw malloc or a lock.
+ */
+class RealtimeGuard
+{
+public:
+    enum Kind
+    {
+        Allocation,
+        Deallocation,
+        Lock,
+        SystemCall,
+        HostCallback,   // the plugin calling back into the host (updateHostDisplay, setLatencySamples), see the check
+        numKinds
+    };
+
+    // Marks this thread as realtime until it goes out of scope. Nests
+    struct Scope
+    {
+        Scope() noexcept;
+        ~Scope() noexcept;
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+    // Inside a Scope: stops counting one kind on this thread until it goes out of scope. For what isn't ours to avoid
+    struct Tolerate
+    {
+        explicit Tolerate(Kind kind) noexcept;
+        ~Tolerate() noexcept;
+
+        Tolerate(const Tolerate&) = delete;
+        Tolerate& operator=(const Tolerate&) = delete;
+
+    private:
+        int previousMask;
+    };
+
+    static bool isGuarded() noexcept;
+
+    // false where this build has no hooks for that kind, its count then always reads 0
+    static bool canDetect(Kind kind) noexcept;
+
+    static std::uint64_t getCount(Kind kind) noexcept;
+    static std::uint64_t getTotalCount() noexcept;
+
+    // Name of the first hooked call made inside a Scope since reset() ("malloc", "pthread_mutex_lock"...), nullptr if none
+    static const char* getFirstViolation() noexcept;
+
+    static const char* getKindName(Kind kind) noexcept;
+
+    static void reset() noexcept;
+
+    // Called by the hooks. Must not allocate, lock or make a syscall itself
+    static void check(Kind kind, const char* function) noexcept;
+};
@@ -0,0 +1,69 @@
+/*
+  ==============================================================================
+
+    ChainSettings.h
+    Plain snapshot of every filter parameter.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <array>
+
+//enum for slope to give us specific settings to switch from in a switch statement in PluginProcessor.h updateCutFilter()
+enum Slope
+{
+    Slope_12,
+    Slope_24,
+    Slope_36,
+    Slope_48
+};
+
+// What one of the extra parametric bands does. Same order as the "Band<n> Type" choices
+enum class BandType
+{
+    Bell,
+    LowShelf,
+    HighShelf,
+    Notch,
+    Tilt
+};
+
+// One band of the multi-band section. Gain is ignored by Notch, for Tilt it's the top end relative to the bottom end
+struct BandSettings
+{
+    bool enabled { false };
+    BandType type { BandType::Bell };
+    float freq { 1000.f }, gainInDecibels { 0 }, quality { 1.f };
+};
+
+inline bool operator== (const BandSettings& a, const BandSettings& b) noexcept
+{
+    return a.enabled == b.enabled && a.type == b.type
+        && a.freq == b.freq && a.gainInDecibels == b.gainInDecibels && a.quality == b.quality;
+}
+
+inline bool operator!= (const BandSettings& a, const BandSettings& b) noexcept { return ! (a == b); }
+
+// Extracting params from apvts, use a data structure to represent all of the param values for readability
+struct ChainSettings
+{
+    float peakFreq { 0 }, peakGainInDecibels { 0 }, peakQuality {1.f};
+    float lowCutFreq { 0 }, highCutFreq { 0 };
+    Slope lowCutSlope { Slope::Slope_12 }, highCutSlope { Slope::Slope_12 };
+
+    // Extra parametric bands on top of the LowCut -> Peak -> HighCut chain, all off by default
+    static constexpr int maxBands = 24;
+    std::array<BandSettings, maxBands> bands;
+};
+
+inline bool operator== (const ChainSettings& a, const ChainSettings& b) noexcept
+{
+    return a.peakFreq == b.peakFreq && a.peakGainInDecibels == b.peakGainInDecibels && a.peakQuality == b.peakQuality
+        && a.lowCutFreq == b.lowCutFreq && a.highCutFreq == b.highCutFreq
+        && a.lowCutSlope == b.lowCutSlope && a.highCutSlope == b.highCutSlope
+        && a.bands == b.bands;
+}
+
+inline bool operator!= (const ChainSettings& a, const ChainSettings& b) noexcept { return ! (a == b); }
@@ -0,0 +1,177 @@
+/*
+  ==============================================================================
+
+    ChainSmoother.h
+    Ramps ChainSettings towards the parameter values so coefficients glide
+    instead of jumping once per block.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ChainSettings.h"
+#include "CoefficientEngine.h"
+
+/* Frequencies and Q ramp multiplicatively (equal steps per octave sound even), gain ramps in dB.
+    Slopes are choices, there's nothing in between 12 and 24 db/Oct so they switch straight away.
+
+    The processor reads getSmoothingStages() each sub-block and only redesigns the stages that are still moving,
+    so when nothing is being automated this costs nothing
+ */
+class ChainSmoother
+{
+public:
+    // rampSeconds == 0 turns smoothing off, every change is applied at the next block like before
+    void prepare(double sampleRate, double rampSeconds) noexcept
+    {
+        lowCutFreq.reset(sampleRate, rampSeconds);
+        highCutFreq.reset(sampleRate, rampSeconds);
+        peakFreq.reset(sampleRate, rampSeconds);
+        peakQuality.reset(sampleRate, rampSeconds);
+        peakGain.reset(sampleRate, rampSeconds);
+
+        for (auto& band : bands)
+        {
+            band.freq.reset(sampleRate, rampSeconds);
+            band.quality.reset(sampleRate, rampSeconds);
+            band.gain.reset(sampleRate, rampSeconds);
+        }
+    }
+
+    // Jumps straight to the settings, used when (re)starting playback
+    void setCurrentAndTargetValues(const ChainSettings& settings) noexcept
+    {
+        lowCutFreq.setCurrentAndTargetValue(settings.lowCutFreq);
+        highCutFreq.setCurrentAndTargetValue(settings.highCutFreq);
+        peakFreq.setCurrentAndTargetValue(settings.peakFreq);
+        peakQuality.setCurrentAndTargetValue(settings.peakQuality);
+        peakGain.setCurrentAndTargetValue(settings.peakGainInDecibels);
+        lowCutSlope = settings.lowCutSlope;
+        highCutSlope = settings.highCutSlope;
+
+        for (size_t i = 0; i < bands.size(); ++i)
+            bands[i].jumpTo(settings.bands[i]);
+    }
+
+    void setTargetValues(const ChainSettings& settings) noexcept
+    {
+        lowCutFreq.setTargetValue(settings.lowCutFreq);
+        highCutFreq.setTargetValue(settings.highCutFreq);
+        peakFreq.setTargetValue(settings.peakFreq);
+        peakQuality.setTargetValue(settings.peakQuality);
+        peakGain.setTargetValue(settings.peakGainInDecibels);
+        lowCutSlope = settings.lowCutSlope;
+        highCutSlope = settings.highCutSlope;
+
+        // A band that's off (or just came on) has nothing audible to glide from, it jumps straight there
+        for (size_t i = 0; i < bands.size(); ++i)
+        {
+            auto& band = bands[i];
+            auto& target = settings.bands[i];
+
+            if (! (band.enabled && target.enabled))
+            {
+                band.jumpTo(target);
+                continue;
+            }
+
+            band.type = target.type;
+            band.freq.setTargetValue(target.freq);
+            band.quality.setTargetValue(target.quality);
+            band.gain.setTargetValue(target.gainInDecibels);
+        }
+    }
+
+    // CoefficientEngine::Stage bits for every stage with a parameter still ramping
+    int getSmoothingStages() const noexcept
+    {
+        int stages = 0;
+
+        if (lowCutFreq.isSmoothing())
+            stages |= CoefficientEngine::LowCutStage;
+
+        if (peakFreq.isSmoothing() || peakQuality.isSmoothing() || peakGain.isSmoothing())
+            stages |= CoefficientEngine::PeakStage;
+
+        if (highCutFreq.isSmoothing())
+            stages |= CoefficientEngine::HighCutStage;
+
+        for (int i = 0; i < ChainSettings::maxBands; ++i)
+            if (bands[(size_t) i].isSmoothing())
+                stages |= CoefficientEngine::bandStage(i);
+
+        return stages;
+    }
+
+    bool isSmoothing() const noexcept { return getSmoothingStages() != 0; }
+
+    ChainSettings getCurrentSettings() const noexcept
+    {
+        ChainSettings settings;
+
+        settings.lowCutFreq = lowCutFreq.getCurrentValue();
+        settings.highCutFreq = highCutFreq.getCurrentValue();
+        settings.peakFreq = peakFreq.getCurrentValue();
+        settings.peakQuality = peakQuality.getCurrentValue();
+        settings.peakGainInDecibels = peakGain.getCurrentValue();
+        settings.lowCutSlope = lowCutSlope;
+        settings.highCutSlope = highCutSlope;
+
+        for (size_t i = 0; i < bands.size(); ++i)
+        {
+            auto& band = bands[i];
+            settings.bands[i] = { band.enabled, band.type, band.freq.getCurrentValue(), band.gain.getCurrentValue(), band.quality.getCurrentValue() };
+        }
+
+        return settings;
+    }
+
+    // Moves every ramp on by numSamples and returns where they ended up
+    ChainSettings advance(int numSamples) noexcept
+    {
+        lowCutFreq.skip(numSamples);
+        highCutFreq.skip(numSamples);
+        peakFreq.skip(numSamples);
+        peakQuality.skip(numSamples);
+        peakGain.skip(numSamples);
+
+        for (auto& band : bands)
+        {
+            band.freq.skip(numSamples);
+            band.quality.skip(numSamples);
+            band.gain.skip(numSamples);
+        }
+
+        return getCurrentSettings();
+    }
+
+private:
+    using MultiplicativeValue = juce::SmoothedValue<float, juce::ValueSmoothingTypes::Multiplicative>;
+
+    MultiplicativeValue lowCutFreq { 20.f }, highCutFreq { 20000.f }, peakFreq { 750.f }, peakQuality { 1.f };
+    juce::SmoothedValue<float> peakGain { 0.f };
+    Slope lowCutSlope { Slope::Slope_12 }, highCutSlope { Slope::Slope_12 };
+
+    struct BandRamps
+    {
+        bool isSmoothing() const noexcept { return freq.isSmoothing() || quality.isSmoothing() || gain.isSmoothing(); }
+
+        void jumpTo(const BandSettings& settings) noexcept
+        {
+            enabled = settings.enabled;
+            type = settings.type;
+            freq.setCurrentAndTargetValue(settings.freq);
+            quality.setCurrentAndTargetValue(settings.quality);
+            gain.setCurrentAndTargetValue(settings.gainInDecibels);
+        }
+
+        bool enabled { false };
+        BandType type { BandType::Bell };
+        MultiplicativeValue freq { 1000.f }, quality { 1.f };
+        juce::SmoothedValue<float> gain { 0.f };
+    };
+
+    std::array<BandRamps, ChainSettings::maxBands> bands;
+};
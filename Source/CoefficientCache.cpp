@@ -0,0 +1,235 @@
+/*
+  ==============================================================================
+
+    CoefficientCache.cpp
+    Process-wide, lock-free store of finished filter designs, shared by every
+    SimpleEQ instance in the process.
+
+  ==============================================================================
+*/
+
+#include "CoefficientCache.h"
+#include "CoefficientEngine.h"
+#include "PerformanceCounters.h"
+
+// An entry's references: empty, being written by share(), or how many SharedDesigns point at it
+namespace
+{
+    constexpr int empty = -2, writing = -1;
+}
+
+struct CoefficientCache::Entry
+{
+    Key key;
+    CutCoefficients coefficients;
+
+    std::atomic<int> references { empty };
+    std::atomic<juce::uint64> keyHash { 0 };        // lets a lookup skip entries without touching their count
+    std::atomic<juce::uint32> lastReleased { 0 };   // for picking which unreferenced entry to take over
+};
+
+std::atomic<juce::uint32> CoefficientCache::releaseClock { 0 };
+
+CoefficientCache::SharedDesign& CoefficientCache::SharedDesign::operator=(SharedDesign&& other) noexcept
+{
+    if (this != &other)
+    {
+        reset();
+        entry = std::exchange(other.entry, nullptr);
+    }
+
+    return *this;
+}
+
+void CoefficientCache::SharedDesign::reset() noexcept
+{
+    if (entry != nullptr)
+        release(*std::exchange(entry, nullptr));
+}
+
+const CutCoefficients& CoefficientCache::SharedDesign::get() const noexcept
+{
+    jassert(entry != nullptr);
+    return entry->coefficients;
+}
+
+CoefficientCache& CoefficientCache::getInstance()
+{
+    static CoefficientCache instance;
+    return instance;
+}
+
+CoefficientCache::CoefficientCache()
+    : pool(new Entry[(size_t) capacity])
+{
+}
+
+CoefficientCache::~CoefficientCache() = default;
+
+bool CoefficientCache::matches(const Key& a, const Key& b) noexcept
+{
+    return a.sampleRate == b.sampleRate && a.kind == b.kind && a.variant == b.variant
+        && a.freq == b.freq && a.gain == b.gain && a.quality == b.quality;
+}
+
+juce::uint64 CoefficientCache::hash(const Key& key) noexcept
+{
+    // FNV-1a over the fields, one at a time so struct padding never gets into it
+    juce::uint64 h = 14695981039346656037ull;
+
+    auto mix = [&h](const void* data, size_t size)
+    {
+        for (size_t i = 0; i < size; ++i)
+            h = (h ^ static_cast<const juce::uint8*>(data)[i]) * 1099511628211ull;
+    };
+
+    mix(&key.sampleRate, sizeof(key.sampleRate));
+    mix(&key.kind, sizeof(key.kind));
+    mix(&key.variant, sizeof(key.variant));
+    mix(&key.freq, sizeof(key.freq));
+    mix(&key.gain, sizeof(key.gain));
+    mix(&key.quality, sizeof(key.quality));
+
+    return h;
+}
+
+CoefficientCache::Entry* CoefficientCache::getSet(juce::uint64 keyHash) noexcept
+{
+    return pool.get() + (size_t) (keyHash % (juce::uint64) numSets) * waysPerSet;
+}
+
+bool CoefficientCache::tryAcquire(Entry& entry, const Key& key, juce::uint64 keyHash) noexcept
+{
+    if (entry.keyHash.load(std::memory_order_relaxed) != keyHash)
+        return false;
+
+    // only a published entry can gain references, and one with references never gets rewritten
+    auto references = entry.references.load(std::memory_order_relaxed);
+
+    while (references >= 0)
+        if (entry.references.compare_exchange_weak(references, references + 1, std::memory_order_acquire, std::memory_order_relaxed))
+            break;
+
+    if (references < 0)
+        return false;
+
+    // the hash only said it might be ours. It can't change under us now, so check properly
+    if (matches(entry.key, key))
+        return true;
+
+    release(entry);
+    return false;
+}
+
+void CoefficientCache::release(Entry& entry) noexcept
+{
+    entry.lastReleased.store(releaseClock.fetch_add(1, std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    // release, so whoever takes the entry over next sees we're done reading it
+    entry.references.fetch_sub(1, std::memory_order_release);
+}
+
+CoefficientCache::SharedDesign CoefficientCache::find(const Key& key) noexcept
+{
+    auto keyHash = hash(key);
+    auto* set = getSet(keyHash);
+
+    for (int way = 0; way < waysPerSet; ++way)
+    {
+        if (tryAcquire(set[way], key, keyHash))
+        {
+            if constexpr (PerformanceCounters::enabled)
+                hits.fetch_add(1, std::memory_order_relaxed);
+
+            return SharedDesign(&set[way]);
+        }
+    }
+
+    if constexpr (PerformanceCounters::enabled)
+        misses.fetch_add(1, std::memory_order_relaxed);
+
+    return {};
+}
+
+CoefficientCache::SharedDesign CoefficientCache::share(const Key& key, const CutCoefficients& design) noexcept
+{
+    auto keyHash = hash(key);
+    auto* set = getSet(keyHash);
+
+    // an instance designing the same thing may have got here first, its design is as good as ours
+    for (int way = 0; way < waysPerSet; ++way)
+        if (tryAcquire(set[way], key, keyHash))
+            return SharedDesign(&set[way]);
+
+    // Take over an empty entry, or else the unreferenced one released longest ago. Another thread can claim
+    // or pick up our choice between the scan and the CAS, so scan again when that happens - a few times at most
+    for (int attempt = 0; attempt < waysPerSet; ++attempt)
+    {
+        Entry* victim = nullptr;
+        auto victimReferences = 0;
+        juce::uint32 victimAge = 0;
+        auto now = releaseClock.load(std::memory_order_relaxed);
+
+        for (int way = 0; way < waysPerSet; ++way)
+        {
+            auto references = set[way].references.load(std::memory_order_relaxed);
+
+            if (references == empty)
+            {
+                victim = &set[way];
+                victimReferences = empty;
+                break;
+            }
+
+            auto age = now - set[way].lastReleased.load(std::memory_order_relaxed);
+
+            if (references == 0 && (victim == nullptr || age > victimAge))
+            {
+                victim = &set[way];
+                victimAge = age;
+            }
+        }
+
+        if (victim == nullptr)
+            break;
+
+        // acquire, so everything the last holder read happens before we overwrite it
+        if (! victim->references.compare_exchange_strong(victimReferences, writing, std::memory_order_acquire, std::memory_order_relaxed))
+            continue;
+
+        if (victimReferences == 0)
+            evictions.fetch_add(1, std::memory_order_relaxed);
+
+        victim->key = key;
+        victim->coefficients = design;
+        victim->keyHash.store(keyHash, std::memory_order_relaxed);
+
+        // published with a single reference, ours
+        victim->references.store(1, std::memory_order_release);
+        return SharedDesign(victim);
+    }
+
+    unshared.fetch_add(1, std::memory_order_relaxed);
+    return {};
+}
+
+CoefficientCache::Stats CoefficientCache::getStats() const noexcept
+{
+    Stats stats;
+    stats.hits = hits.load(std::memory_order_relaxed);
+    stats.misses = misses.load(std::memory_order_relaxed);
+    stats.evictions = evictions.load(std::memory_order_relaxed);
+    stats.unshared = unshared.load(std::memory_order_relaxed);
+
+    for (int i = 0; i < capacity; ++i)
+    {
+        auto references = pool[(size_t) i].references.load(std::memory_order_relaxed);
+
+        stats.entries += references >= 0 ? 1 : 0;
+        stats.inUse += references > 0 ? 1 : 0;
+    }
+
+    stats.memoryBytes = sizeof(Entry) * (size_t) capacity;
+
+    return stats;
+}
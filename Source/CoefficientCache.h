@@ -0,0 +1,136 @@
+/*
+  ==============================================================================
+
+    CoefficientCache.h
+    Process-wide, lock-free store of finished filter designs, shared by every
+    SimpleEQ instance in the process.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <memory>
+#include <utility>
+
+struct CutCoefficients;
+
+/* Sessions built from templates open dozens of instances at the same settings, and each used to design the same
+    LowCut / Peak / HighCut from scratch. With the cache the first one designs and publishes, the rest hold a
+    reference to that design instead of a copy of their own.
+
+    Keys are the stage's parameter values exactly as the APVTS holds them. Those are already quantised by the
+    parameters' intervals (1 Hz, 0.5 dB, 0.05 Q, a choice index), so two instances at "the same settings" produce
+    bit-identical keys and a hit returns exactly what the instance would have designed itself. Ramps pass through
+    values between the steps, so smoothed designs never go through here - they'd only fill the cache up. Neither do
+    automation's steps: a stage is only shared once its values have settled (see CoefficientEngine::share).
+
+    Everything is preallocated when the cache is first used: numSets sets of waysPerSet entries, a key only ever
+    lives in the set its hash picks. Each entry carries a reference count. While anyone holds a SharedDesign for it,
+    the entry can't change. Once nobody does it stays findable, but a design that needs the room can take it over:
+    an empty entry first, otherwise the one whose last reference went longest ago. No locks and no allocation on
+    any thread after construction. When every entry in a set is in use, a new design for that set simply isn't
+    shared (see Stats::unshared)
+ */
+class CoefficientCache
+{
+    struct Entry;
+
+public:
+    enum Kind
+    {
+        LowCutKind,
+        HighCutKind,
+        PeakKind,
+        BandKind
+    };
+
+    struct Key
+    {
+        double sampleRate { 0.0 };
+        int kind { 0 };
+        int variant { 0 };                  // slope or band type
+        float freq { 0 }, gain { 0 }, quality { 0 };
+    };
+
+    static constexpr int numSets = 64, waysPerSet = 8;
+    static constexpr int capacity = numSets * waysPerSet;
+
+    /* A reference to one immutable design in the cache, released when this goes away or is reset.
+        Moving it around is free, it never allocates and can be dropped on the audio thread
+     */
+    class SharedDesign
+    {
+    public:
+        SharedDesign() = default;
+        ~SharedDesign() { reset(); }
+
+        SharedDesign(SharedDesign&& other) noexcept : entry(std::exchange(other.entry, nullptr)) {}
+        SharedDesign& operator=(SharedDesign&& other) noexcept;
+
+        void reset() noexcept;
+
+        explicit operator bool() const noexcept { return entry != nullptr; }
+        const CutCoefficients& get() const noexcept;
+
+    private:
+        friend class CoefficientCache;
+        explicit SharedDesign(Entry* e) noexcept : entry(e) {}
+
+        Entry* entry { nullptr };
+
+        JUCE_DECLARE_NON_COPYABLE (SharedDesign)
+    };
+
+    // The process-wide instance, built on first use. CoefficientEngine touches it in its constructor so that's never the audio thread
+    static CoefficientCache& getInstance();
+
+    // Lock-free, no allocation. A reference to the design shared under key, empty if nobody has shared one
+    SharedDesign find(const Key& key) noexcept;
+
+    /* Lock-free, no allocation. Shares a copy of design under key and hands back a reference to it (or to the one
+        already there, if someone got in first). Empty if every entry key's set could go into is in use
+     */
+    SharedDesign share(const Key& key, const CutCoefficients& design) noexcept;
+
+    /* Hits and misses are only counted in instrumentation builds (PerformanceCounters::enabled),
+        they're shared atomics every instance would otherwise be writing to. Evictions and designs that found no
+        room are rare enough to always be counted
+     */
+    struct Stats
+    {
+        juce::int64 hits { 0 }, misses { 0 };
+        juce::int64 evictions { 0 }, unshared { 0 };
+        int entries { 0 };      // designs in the cache
+        int inUse { 0 };        // of those, how many someone holds a reference to
+        size_t memoryBytes { 0 };
+
+        double getHitRate() const noexcept { return hits + misses > 0 ? (double) hits / (double) (hits + misses) : 0.0; }
+    };
+
+    Stats getStats() const noexcept;
+
+private:
+    CoefficientCache();
+
+    ~CoefficientCache();
+
+    static bool matches(const Key& a, const Key& b) noexcept;
+    static juce::uint64 hash(const Key& key) noexcept;
+
+    Entry* getSet(juce::uint64 keyHash) noexcept;
+
+    // takes a reference to entry if it's published under key
+    static bool tryAcquire(Entry& entry, const Key& key, juce::uint64 keyHash) noexcept;
+    static void release(Entry& entry) noexcept;
+
+    std::unique_ptr<Entry[]> pool;
+
+    static std::atomic<juce::uint32> releaseClock;
+
+    std::atomic<juce::int64> hits { 0 }, misses { 0 }, evictions { 0 }, unshared { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE (CoefficientCache)
+};
@@ -0,0 +1,639 @@
+/*
+  ==============================================================================
+
+    CoefficientEngine.cpp
+    Change-driven, allocation-free filter coefficient designer.
+
+  ==============================================================================
+*/
+
+#include "CoefficientEngine.h"
+#include "ChainSettings.h"
+#include "CutFilterTable.h"
+#include "CoefficientCache.h"
+
+const std::array<const char*, 7> CoefficientEngine::parameterIDs
+{
+    "LowCut Freq", "HighCut Freq", "Peak Freq", "Peak Gain", "Peak Quality", "LowCut Slope", "HighCut Slope"
+};
+
+const std::array<const char*, 5> CoefficientEngine::bandParameterFields
+{
+    "On", "Type", "Freq", "Gain", "Quality"
+};
+
+juce::String CoefficientEngine::getBandParameterID(int band, const juce::String& field)
+{
+    return "Band" + juce::String(band + 1) + " " + field;
+}
+
+juce::StringArray CoefficientEngine::getBandParameterIDs()
+{
+    juce::StringArray ids;
+
+    for (int band = 0; band < ChainSettings::maxBands; ++band)
+        for (auto* field : bandParameterFields)
+            ids.add(getBandParameterID(band, field));
+
+    return ids;
+}
+
+juce::String CoefficientEngine::getPathParameterID(int path, const juce::String& parameterID)
+{
+    return path == 0 ? parameterID : "Path" + juce::String(path + 1) + " " + parameterID;
+}
+
+juce::StringArray CoefficientEngine::getPathParameterIDs(int path)
+{
+    juce::StringArray ids;
+
+    for (auto* id : parameterIDs)
+        ids.add(getPathParameterID(path, id));
+
+    for (auto& id : getBandParameterIDs())
+        ids.add(getPathParameterID(path, id));
+
+    return ids;
+}
+
+int CoefficientEngine::stageForParameter(const juce::String& id)
+{
+    // Runs on whatever thread automation comes in on, so only pointer walking here: no substrings, nothing allocates
+    auto text = id.getCharPointer();
+
+    auto startsWith = [&text](const char* prefix)
+    {
+        return text.compareUpTo(juce::CharPointer_ASCII(prefix), (int) std::strlen(prefix)) == 0;
+    };
+
+    // a second path's id is the first path's with "Path2 " in front, each engine only hears its own path's
+    if (startsWith("Path"))
+    {
+        auto space = text.indexOf((juce::juce_wchar) ' ');
+
+        if (space < 0)
+            return 0;
+
+        text += space + 1;
+    }
+
+    // ids are "<Stage> <Thing>" so the prefix is enough to route them
+    if (startsWith("LowCut"))
+        return LowCutStage;
+
+    if (startsWith("Peak"))
+        return PeakStage;
+
+    if (startsWith("HighCut"))
+        return HighCutStage;
+
+    if (startsWith("Band"))
+    {
+        auto band = juce::CharacterFunctions::getIntValue<int>(text + 4) - 1;
+
+        if (juce::isPositiveAndBelow(band, ChainSettings::maxBands))
+            return bandStage(band);
+    }
+
+    return 0;
+}
+
+CoefficientEngine::CoefficientEngine()
+    : sharedDesigns(CoefficientCache::getInstance())
+{
+}
+
+CoefficientEngine::~CoefficientEngine() = default;
+
+void CoefficientEngine::prepare(double newSampleRate)
+{
+    sampleRate = newSampleRate;
+    markDirty();
+
+    // the spare table may still be being written by the last rate change
+    waitForCutTable();
+
+    auto entriesPerOctave = cutTableEntriesPerOctave.load();
+    auto published = publishedCutTable.load();
+
+    if (entriesPerOctave <= 0)
+    {
+        publishedCutTable = -1;
+        return;
+    }
+
+    // A restart at the same rate keeps the table it already has, and going back to the rate before the last change
+    // finds it still in the spare slot - nothing's building now, so that one can just be published again
+    for (int index = 0; index < (int) cutTables.size(); ++index)
+    {
+        auto& slot = cutTables[(size_t) index];
+
+        if (slot.table != nullptr && slot.sampleRate == sampleRate && slot.entriesPerOctave == entriesPerOctave)
+        {
+            if (index != published)
+                publishedCutTable.store(index, std::memory_order_release);
+
+            return;
+        }
+    }
+
+    auto spare = published == 0 ? 1 : 0;
+
+    cutTableBuild = std::async(std::launch::async, [this, spare, rate = sampleRate, entriesPerOctave]
+    {
+        auto& slot = cutTables[(size_t) spare];
+
+        // another instance (or the other path) at this rate most likely has it already.
+        // Whatever the slot held before is let go of here, off the audio thread
+        slot.table = CutFilterTable::getShared(rate, entriesPerOctave);
+        slot.sampleRate = rate;
+        slot.entriesPerOctave = entriesPerOctave;
+
+        publishedCutTable.store(spare, std::memory_order_release);
+    });
+}
+
+void CoefficientEngine::waitForCutTable()
+{
+    if (cutTableBuild.valid())
+        cutTableBuild.wait();
+}
+
+const CutFilterTable* CoefficientEngine::getCutTable(double rate) const noexcept
+{
+    auto published = publishedCutTable.load(std::memory_order_acquire);
+
+    if (published < 0)
+        return nullptr;
+
+    auto& slot = cutTables[(size_t) published];
+    return slot.table != nullptr && slot.sampleRate == rate && ! slot.table->isEmpty() ? slot.table.get() : nullptr;
+}
+
+size_t CoefficientEngine::getCutTableMemoryBytes() const noexcept
+{
+    auto published = publishedCutTable.load();
+    return published >= 0 && cutTables[(size_t) published].table != nullptr ? cutTables[(size_t) published].table->getMemoryBytes() : 0;
+}
+
+void CoefficientEngine::parameterChanged(const juce::String& parameterID, float)
+{
+    markDirty(stageForParameter(parameterID));
+}
+
+template <typename DesignFn>
+void CoefficientEngine::designShared(SharedStage& stage, CutCoefficients& result, int kind, int variant,
+                                     float freq, float gain, float quality, bool shareDesigns, DesignFn&& designFn) noexcept
+{
+    auto& key = stage.key;
+    key.sampleRate = sampleRate;
+    key.kind = kind;
+    key.variant = variant;
+    key.freq = freq;
+    key.gain = gain;
+    key.quality = quality;
+    stage.exact = true;
+
+    if (! shareDesigns)
+    {
+        stage.design.reset();
+        designFn();
+        return;
+    }
+
+    stage.design = sharedDesigns.find(key);
+
+    if (stage.design)
+        return;
+
+    designFn();
+
+    // empty if the cache had no room, result is what gets used then
+    stage.design = sharedDesigns.share(key, result);
+}
+
+void CoefficientEngine::share(int stages) noexcept
+{
+    CutCoefficients single;
+    single.numSections = 1;
+
+    for (size_t index = 0; index < numStages; ++index)
+    {
+        auto& stage = sharedStages[index];
+
+        if ((stages & (1 << index)) == 0 || ! stage.exact || stage.design)
+            continue;
+
+        // a band that's off isn't in the chain, no point keeping its design alive in the cache
+        if (index >= firstBandIndex && ! bandEnabled[index - firstBandIndex])
+            continue;
+
+        stage.design = sharedDesigns.find(stage.key);
+
+        if (stage.design)
+            continue;
+
+        if (index == peakIndex)
+            single.sections[0] = peak;
+        else if (index >= firstBandIndex)
+            single.sections[0] = bands[index - firstBandIndex];
+
+        stage.design = sharedDesigns.share(stage.key, index == lowCutIndex  ? lowCut
+                                                    : index == highCutIndex ? highCut
+                                                                            : single);
+    }
+}
+
+void CoefficientEngine::design(const ChainSettings& chainSettings, int stages, bool shareDesigns) noexcept
+{
+    /* Slope choice 0: 12 db/oct -> order: 2
+       Slope choice 1: 24 db/oct -> order: 4
+       Slope choice 2: 36 db/oct -> order: 6
+       Slope choice 3: 48 db/oct -> order: 8
+     */
+    auto* cutTable = getCutTable(sampleRate);
+    auto useTable = cutTable != nullptr;
+    
+    // table lookups are interpolated, nobody designing exactly should be handed one of those
+    auto shareCuts = shareDesigns && ! useTable;
+    
+    if (stages & LowCutStage)
+    {
+        auto order = 2 * (chainSettings.lowCutSlope + 1);
+        
+        if (useTable)
+        {
+            sharedStages[lowCutIndex].exact = false;
+            sharedStages[lowCutIndex].design.reset();
+            cutTable->lookupHighPass(lowCut, chainSettings.lowCutFreq, order);
+        }
+        else
+            designShared(sharedStages[lowCutIndex], lowCut, CoefficientCache::LowCutKind, order, chainSettings.lowCutFreq, 0.0f, 0.0f, shareCuts,
+                         [&] { designHighPassButterworth(lowCut, sampleRate, chainSettings.lowCutFreq, order); });
+    }
+
+    // single sections share through a one section CutCoefficients
+    CutCoefficients single;
+    single.numSections = 1;
+    
+    if (stages & PeakStage)
+    {
+        designShared(sharedStages[peakIndex], single, CoefficientCache::PeakKind, 0,
+                     chainSettings.peakFreq, chainSettings.peakGainInDecibels, chainSettings.peakQuality, shareDesigns,
+                     [&] { peak = single.sections[0] = makePeakFilter(sampleRate,
+                                                                      chainSettings.peakFreq,
+                                                                      chainSettings.peakQuality,
+                                                                      juce::Decibels::decibelsToGain(chainSettings.peakGainInDecibels)); });
+    }
+
+    if (stages & HighCutStage)
+    {
+        auto order = 2 * (chainSettings.highCutSlope + 1);
+        
+        if (useTable)
+        {
+            sharedStages[highCutIndex].exact = false;
+            sharedStages[highCutIndex].design.reset();
+            cutTable->lookupLowPass(highCut, chainSettings.highCutFreq, order);
+        }
+        else
+            designShared(sharedStages[highCutIndex], highCut, CoefficientCache::HighCutKind, order, chainSettings.highCutFreq, 0.0f, 0.0f, shareCuts,
+                         [&] { designLowPassButterworth(highCut, sampleRate, chainSettings.highCutFreq, order); });
+    }
+
+    if (stages & AllBandStages)
+    {
+        for (int i = 0; i < ChainSettings::maxBands; ++i)
+        {
+            if ((stages & bandStage(i)) == 0)
+                continue;
+
+            auto& band = chainSettings.bands[(size_t) i];
+            bandEnabled[(size_t) i] = band.enabled;
+
+            // a band that's off keeps its old design, it isn't in the chain anyway
+            if (band.enabled)
+            {
+                designShared(sharedStages[firstBandIndex + (size_t) i], single, CoefficientCache::BandKind, (int) band.type,
+                             band.freq, band.gainInDecibels, band.quality, shareDesigns,
+                             [&] { bands[(size_t) i] = single.sections[0] = makeBand(sampleRate, band); });
+            }
+        }
+    }
+}
+
+//==============================================================================
+BiquadCoefficients CoefficientEngine::makePeakFilter(double sampleRate, double frequency, double Q, double gainFactor) noexcept
+{
+    jassert(sampleRate > 0.0);
+    jassert(frequency > 0.0 && frequency <= sampleRate * 0.5);
+    jassert(Q > 0.0);
+
+    auto A = std::sqrt(juce::jmax(0.0, gainFactor));
+    auto omega = (juce::MathConstants<double>::twoPi * frequency) / sampleRate;
+    auto alpha = std::sin(omega) / (Q * 2.0);
+    auto c2 = -2.0 * std::cos(omega);
+    auto alphaTimesA = alpha * A;
+    auto alphaOverA = alpha / A;
+    auto a0Inv = 1.0 / (1.0 + alphaOverA);
+
+    return { (1.0 + alphaTimesA) * a0Inv, c2 * a0Inv, (1.0 - alphaTimesA) * a0Inv, c2 * a0Inv, (1.0 - alphaOverA) * a0Inv };
+}
+
+BiquadCoefficients CoefficientEngine::makeLowPass(double sampleRate, double frequency, double Q) noexcept
+{
+    jassert(sampleRate > 0.0);
+    jassert(frequency > 0.0 && frequency <= sampleRate * 0.5);
+    jassert(Q > 0.0);
+
+    auto n = 1.0 / std::tan(juce::MathConstants<double>::pi * frequency / sampleRate);
+    auto nSquared = n * n;
+    auto invQ = 1.0 / Q;
+    auto c1 = 1.0 / (1.0 + invQ * n + nSquared);
+
+    return { c1, c1 * 2.0, c1, c1 * 2.0 * (1.0 - nSquared), c1 * (1.0 - invQ * n + nSquared) };
+}
+
+BiquadCoefficients CoefficientEngine::makeHighPass(double sampleRate, double frequency, double Q) noexcept
+{
+    jassert(sampleRate > 0.0);
+    jassert(frequency > 0.0 && frequency <= sampleRate * 0.5);
+    jassert(Q > 0.0);
+
+    auto n = std::tan(juce::MathConstants<double>::pi * frequency / sampleRate);
+    auto nSquared = n * n;
+    auto invQ = 1.0 / Q;
+    auto c1 = 1.0 / (1.0 + invQ * n + nSquared);
+
+    return { c1, c1 * -2.0, c1, c1 * 2.0 * (nSquared - 1.0), c1 * (1.0 - invQ * n + nSquared) };
+}
+
+BiquadCoefficients CoefficientEngine::makeLowShelf(double sampleRate, double frequency, double Q, double gainFactor) noexcept
+{
+    jassert(sampleRate > 0.0);
+    jassert(frequency > 0.0 && frequency <= sampleRate * 0.5);
+    jassert(Q > 0.0);
+
+    auto A = std::sqrt(juce::jmax(0.0, gainFactor));
+    auto aminus1 = A - 1.0;
+    auto aplus1 = A + 1.0;
+    auto omega = (juce::MathConstants<double>::twoPi * frequency) / sampleRate;
+    auto coso = std::cos(omega);
+    auto beta = std::sin(omega) * std::sqrt(A) / Q;
+    auto aminus1TimesCoso = aminus1 * coso;
+    auto a0Inv = 1.0 / (aplus1 + aminus1TimesCoso + beta);
+
+    return { A * (aplus1 - aminus1TimesCoso + beta) * a0Inv,
+             A * 2.0 * (aminus1 - aplus1 * coso) * a0Inv,
+             A * (aplus1 - aminus1TimesCoso - beta) * a0Inv,
+             -2.0 * (aminus1 + aplus1 * coso) * a0Inv,
+             (aplus1 + aminus1TimesCoso - beta) * a0Inv };
+}
+
+BiquadCoefficients CoefficientEngine::makeHighShelf(double sampleRate, double frequency, double Q, double gainFactor) noexcept
+{
+    jassert(sampleRate > 0.0);
+    jassert(frequency > 0.0 && frequency <= sampleRate * 0.5);
+    jassert(Q > 0.0);
+
+    auto A = std::sqrt(juce::jmax(0.0, gainFactor));
+    auto aminus1 = A - 1.0;
+    auto aplus1 = A + 1.0;
+    auto omega = (juce::MathConstants<double>::twoPi * frequency) / sampleRate;
+    auto coso = std::cos(omega);
+    auto beta = std::sin(omega) * std::sqrt(A) / Q;
+    auto aminus1TimesCoso = aminus1 * coso;
+    auto a0Inv = 1.0 / (aplus1 - aminus1TimesCoso + beta);
+
+    return { A * (aplus1 + aminus1TimesCoso + beta) * a0Inv,
+             A * -2.0 * (aminus1 + aplus1 * coso) * a0Inv,
+             A * (aplus1 + aminus1TimesCoso - beta) * a0Inv,
+             2.0 * (aminus1 - aplus1 * coso) * a0Inv,
+             (aplus1 - aminus1TimesCoso - beta) * a0Inv };
+}
+
+BiquadCoefficients CoefficientEngine::makeNotch(double sampleRate, double frequency, double Q) noexcept
+{
+    jassert(sampleRate > 0.0);
+    jassert(frequency > 0.0 && frequency <= sampleRate * 0.5);
+    jassert(Q > 0.0);
+
+    auto n = 1.0 / std::tan(juce::MathConstants<double>::pi * frequency / sampleRate);
+    auto nSquared = n * n;
+    auto invQ = 1.0 / Q;
+    auto c1 = 1.0 / (1.0 + n * invQ + nSquared);
+    auto b0 = c1 * (1.0 + nSquared);
+    auto b1 = 2.0 * c1 * (1.0 - nSquared);
+
+    return { b0, b1, b0, b1, c1 * (1.0 - n * invQ + nSquared) };
+}
+
+BiquadCoefficients CoefficientEngine::makeBandPass(double sampleRate, double frequency, double Q) noexcept
+{
+    jassert(sampleRate > 0.0);
+    jassert(frequency > 0.0 && frequency <= sampleRate * 0.5);
+    jassert(Q > 0.0);
+
+    auto omega = (juce::MathConstants<double>::twoPi * frequency) / sampleRate;
+    auto alpha = std::sin(omega) / (Q * 2.0);
+    auto a0Inv = 1.0 / (1.0 + alpha);
+
+    return { alpha * a0Inv, 0.0, -alpha * a0Inv, -2.0 * std::cos(omega) * a0Inv, (1.0 - alpha) * a0Inv };
+}
+
+BiquadCoefficients CoefficientEngine::makeTilt(double sampleRate, double frequency, double Q, double gainInDecibels) noexcept
+{
+    auto c = makeHighShelf(sampleRate, frequency, Q, juce::Decibels::decibelsToGain(gainInDecibels, -300.0));
+    auto trim = juce::Decibels::decibelsToGain(-0.5 * gainInDecibels, -300.0);
+
+    c.b0 *= trim;
+    c.b1 *= trim;
+    c.b2 *= trim;
+
+    return c;
+}
+
+BiquadCoefficients CoefficientEngine::makeBand(double sampleRate, const BandSettings& band) noexcept
+{
+    auto gainFactor = juce::Decibels::decibelsToGain((double) band.gainInDecibels);
+
+    switch (band.type)
+    {
+        case BandType::LowShelf:  return makeLowShelf(sampleRate, band.freq, band.quality, gainFactor);
+        case BandType::HighShelf: return makeHighShelf(sampleRate, band.freq, band.quality, gainFactor);
+        case BandType::Notch:     return makeNotch(sampleRate, band.freq, band.quality);
+        case BandType::Tilt:      return makeTilt(sampleRate, band.freq, band.quality, band.gainInDecibels);
+        case BandType::Bell:      break;
+    }
+
+    return makePeakFilter(sampleRate, band.freq, band.quality, gainFactor);
+}
+
+CoefficientEngine::GainDesign CoefficientEngine::makeGainDesign(double sampleRate, BandType type, double frequency, double Q) noexcept
+{
+    jassert(sampleRate > 0.0);
+    jassert(frequency > 0.0 && frequency <= sampleRate * 0.5);
+    jassert(Q > 0.0);
+
+    auto omega = (juce::MathConstants<double>::twoPi * frequency) / sampleRate;
+
+    GainDesign design;
+    design.type = type;
+    design.cosOmega = std::cos(omega);
+    design.sinOmega = std::sin(omega);
+    design.invQ = 1.0 / Q;
+
+    if (type == BandType::Notch)
+        design.notch = makeNotch(sampleRate, frequency, Q);
+
+    return design;
+}
+
+BiquadCoefficients CoefficientEngine::GainDesign::withGain(double gainInDecibels) const noexcept
+{
+    // A = sqrt(10^(dB / 20)) = e^(dB ln(10) / 40), the only transcendental a bell needs per update
+    constexpr auto decibelsToLogA = 0.05756462732485114; // ln(10) / 40
+    auto A = std::exp(gainInDecibels * decibelsToLogA);
+
+    if (type == BandType::Bell)
+    {
+        auto alpha = sinOmega * invQ * 0.5;
+        auto c2 = -2.0 * cosOmega;
+        auto alphaTimesA = alpha * A;
+        auto alphaOverA = alpha / A;
+        auto a0Inv = 1.0 / (1.0 + alphaOverA);
+
+        return { (1.0 + alphaTimesA) * a0Inv, c2 * a0Inv, (1.0 - alphaTimesA) * a0Inv, c2 * a0Inv, (1.0 - alphaOverA) * a0Inv };
+    }
+
+    if (type == BandType::Notch)
+        return notch;
+
+    // shelves: beta = sin(w) sqrt(A) / Q, and sqrt(A) is the same exp at half the exponent
+    auto aminus1 = A - 1.0;
+    auto aplus1 = A + 1.0;
+    auto beta = sinOmega * std::exp(gainInDecibels * decibelsToLogA * 0.5) * invQ;
+    auto aminus1TimesCoso = aminus1 * cosOmega;
+
+    if (type == BandType::LowShelf)
+    {
+        auto a0Inv = 1.0 / (aplus1 + aminus1TimesCoso + beta);
+
+        return { A * (aplus1 - aminus1TimesCoso + beta) * a0Inv,
+                 A * 2.0 * (aminus1 - aplus1 * cosOmega) * a0Inv,
+                 A * (aplus1 - aminus1TimesCoso - beta) * a0Inv,
+                 -2.0 * (aminus1 + aplus1 * cosOmega) * a0Inv,
+                 (aplus1 + aminus1TimesCoso - beta) * a0Inv };
+    }
+
+    auto a0Inv = 1.0 / (aplus1 - aminus1TimesCoso + beta);
+
+    // the tilt's trim of -gain / 2 is 1 / A, which folds into the numerator's A
+    auto numeratorGain = type == BandType::Tilt ? 1.0 : A;
+
+    return { numeratorGain * (aplus1 + aminus1TimesCoso + beta) * a0Inv,
+             numeratorGain * -2.0 * (aminus1 + aplus1 * cosOmega) * a0Inv,
+             numeratorGain * (aplus1 + aminus1TimesCoso - beta) * a0Inv,
+             2.0 * (aminus1 - aplus1 * cosOmega) * a0Inv,
+             (aplus1 - aminus1TimesCoso - beta) * a0Inv };
+}
+
+/* Same pole placement as FilterDesign::design...HighOrderButterworthMethod for even orders:
+    order / 2 biquads, each with Q = 1 / (2 cos((2i + 1) pi / 2N))
+ */
+void CoefficientEngine::designLowPassButterworth(CutCoefficients& result, double sampleRate, double frequency, int order) noexcept
+{
+    jassert(order > 0 && order % 2 == 0 && order / 2 <= CutCoefficients::maxSections);
+
+    result.numSections = order / 2;
+
+    for (int i = 0; i < result.numSections; ++i)
+    {
+        auto Q = 1.0 / (2.0 * std::cos((2.0 * i + 1.0) * juce::MathConstants<double>::pi / (order * 2.0)));
+        result.sections[(size_t) i] = makeLowPass(sampleRate, frequency, Q);
+    }
+}
+
+void CoefficientEngine::designHighPassButterworth(CutCoefficients& result, double sampleRate, double frequency, int order) noexcept
+{
+    jassert(order > 0 && order % 2 == 0 && order / 2 <= CutCoefficients::maxSections);
+
+    result.numSections = order / 2;
+
+    for (int i = 0; i < result.numSections; ++i)
+    {
+        auto Q = 1.0 / (2.0 * std::cos((2.0 * i + 1.0) * juce::MathConstants<double>::pi / (order * 2.0)));
+        result.sections[(size_t) i] = makeHighPass(sampleRate, frequency, Q);
+    }
+}
+
+//==============================================================================
+double CoefficientEngine::getMagnitudeForFrequency(const BiquadCoefficients& c, double frequency, double sampleRate) noexcept
+{
+    // evaluate (b0 + b1 z^-1 + b2 z^-2) / (1 + a1 z^-1 + a2 z^-2) on the unit circle
+    auto w = juce::MathConstants<double>::twoPi * frequency / sampleRate;
+    auto cos1 = std::cos(w), sin1 = std::sin(w);
+    auto cos2 = std::cos(2.0 * w), sin2 = std::sin(2.0 * w);
+
+    auto numeratorRe = c.b0 + c.b1 * cos1 + c.b2 * cos2;
+    auto numeratorIm = -(c.b1 * sin1 + c.b2 * sin2);
+    auto denominatorRe = 1.0 + c.a1 * cos1 + c.a2 * cos2;
+    auto denominatorIm = -(c.a1 * sin1 + c.a2 * sin2);
+
+    return std::sqrt((numeratorRe * numeratorRe + numeratorIm * numeratorIm)
+                     / (denominatorRe * denominatorRe + denominatorIm * denominatorIm));
+}
+
+void CoefficientEngine::multiplyPowerResponse(const BiquadCoefficients& c, const double* cos1, const double* cos2,
+                                              double* power, int numPoints) noexcept
+{
+    // |b0 + b1 z^-1 + b2 z^-2|^2 = b0^2 + b1^2 + b2^2 + 2 (b0 b1 + b1 b2) cos(w) + 2 b0 b2 cos(2w)
+    // and the same for the denominator with (1, a1, a2)
+    auto n0 = c.b0 * c.b0 + c.b1 * c.b1 + c.b2 * c.b2;
+    auto n1 = 2.0 * (c.b0 * c.b1 + c.b1 * c.b2);
+    auto n2 = 2.0 * c.b0 * c.b2;
+
+    auto d0 = 1.0 + c.a1 * c.a1 + c.a2 * c.a2;
+    auto d1 = 2.0 * (c.a1 + c.a1 * c.a2);
+    auto d2 = 2.0 * c.a2;
+
+    for (int i = 0; i < numPoints; ++i)
+        power[i] *= (n0 + n1 * cos1[i] + n2 * cos2[i]) / (d0 + d1 * cos1[i] + d2 * cos2[i]);
+}
+
+double CoefficientEngine::getPoleRadius(const BiquadCoefficients& c) noexcept
+{
+    // poles are the roots of z^2 + a1 z + a2
+    auto discriminant = c.a1 * c.a1 - 4.0 * c.a2;
+
+    if (discriminant < 0.0)
+        return std::sqrt(c.a2); // complex pair, |p|^2 = a2
+
+    auto root = std::sqrt(discriminant);
+    return juce::jmax(std::abs((-c.a1 + root) * 0.5), std::abs((-c.a1 - root) * 0.5));
+}
+
+double CoefficientEngine::getDecaySamples(const BiquadCoefficients& c, double threshold) noexcept
+{
+    jassert(threshold > 0.0 && threshold < 1.0);
+
+    auto radius = getPoleRadius(c);
+
+    if (radius <= 0.0)
+        return 2.0; // FIR section, it's done once the two state values have gone through
+
+    if (radius >= 1.0)
+        return std::numeric_limits<double>::infinity();
+
+    // r^n < threshold
+    return 2.0 + std::ceil(std::log(threshold) / std::log(radius));
+}
+
+double CoefficientEngine::getDecaySamples(double threshold) const noexcept
+{
+    auto samples = 0.0;
+
+    forEachSection([&](const BiquadCoefficients& section) { samples += getDecaySamples(section, threshold); });
+
+    return samples;
+}
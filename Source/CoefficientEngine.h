@@ -0,0 +1,294 @@
+/*
+  ==============================================================================
+
+    CoefficientEngine.h
+    Change-driven, allocation-free filter coefficient designer.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ChainSettings.h"
+#include "CoefficientCache.h"
+#include <array>
+#include <atomic>
+#include <future>
+#include <memory>
+
+class CutFilterTable;
+
+/* One normalised biquad section (a0 already divided out).
+    Same layout JUCE uses inside IIR::Coefficients for a 2nd order filter: b0, b1, b2, a1, a2
+    Designed in double so we don't lose anything before it gets handed to the filters
+ */
+struct BiquadCoefficients
+{
+    double b0 { 1.0 }, b1 { 0.0 }, b2 { 0.0 }, a1 { 0.0 }, a2 { 0.0 };
+};
+
+// Up to 4 sections for the 48 db/Oct Butterworth cascade, only the first numSections are valid
+struct CutCoefficients
+{
+    static constexpr int maxSections = 4;
+
+    std::array<BiquadCoefficients, maxSections> sections;
+    int numSections { 1 };
+};
+
+//==============================================================================
+/*
+ Replaces the per-block makePeakFilter / designIIR...ButterworthMethod calls.
+ Those helpers return heap allocated, reference counted Coefficients which is a no-go on the audio thread.
+
+ Here the designs are written straight into fixed size storage owned by the engine, and only for the stages whose
+ parameters actually moved. The APVTS calls parameterChanged() on whatever thread the change came from, we just raise
+ a dirty bit there and the audio thread picks it up at the start of the next block.
+ */
+class CoefficientEngine  : public juce::AudioProcessorValueTreeState::Listener
+{
+public:
+    // Each of the extra bands gets its own bit above the fixed stages, so moving one band only redesigns that band
+    enum Stage
+    {
+        LowCutStage    = 1 << 0,
+        PeakStage      = 1 << 1,
+        HighCutStage   = 1 << 2,
+        FirstBandStage = 1 << 3,
+        AllBandStages  = ((1 << ChainSettings::maxBands) - 1) * FirstBandStage,
+        AllStages      = LowCutStage | PeakStage | HighCutStage | AllBandStages
+    };
+
+    static constexpr int bandStage(int band) noexcept { return FirstBandStage << band; }
+
+    // every parameter id from createParameterLayout() that feeds a filter stage
+    static const std::array<const char*, 7> parameterIDs;
+
+    // "Band<n> <Field>" for every band, n counts from 1
+    static const std::array<const char*, 5> bandParameterFields;
+    static juce::String getBandParameterID(int band, const juce::String& field);
+    static juce::StringArray getBandParameterIDs();
+
+    /* Dual mono and mid / side give the second channel a filter path of its own (see StereoMode): the same ids
+        with "Path2 " in front. Path 0 keeps the plain ids, so sessions from before the split load unchanged
+     */
+    static constexpr int numPaths = 2;
+    static juce::String getPathParameterID(int path, const juce::String& parameterID);
+
+    // parameterIDs and getBandParameterIDs() for path
+    static juce::StringArray getPathParameterIDs(int path);
+
+    // Which stage a parameter belongs to (0 if it doesn't drive a filter), either path
+    static int stageForParameter(const juce::String& parameterID);
+
+    CoefficientEngine();
+    ~CoefficientEngine() override;
+
+    /* Not real-time safe, but quick: a cut filter table for a new rate (if one is enabled) is built in the background
+        and swapped in once it's ready, the cut stages are designed directly until then
+     */
+    void prepare(double sampleRate);
+
+    /* Real-time safe: designs at a different rate from now on (oversampling switches).
+        The cut table only holds designs for the rate it was built at, away from that rate we design directly
+     */
+    void setSampleRate(double newSampleRate) noexcept { sampleRate = newSampleRate; markDirty(); }
+    double getSampleRate() const noexcept { return sampleRate; }
+
+    /* Optional lookup table for the LowCut / HighCut designs, built after prepare() for the current sample rate.
+        entriesPerOctave trades memory for accuracy (0 = off, design every time). Takes effect on the next prepare()
+     */
+    void setCutTableResolution(int entriesPerOctave) noexcept { cutTableEntriesPerOctave = juce::jmax(0, entriesPerOctave); }
+    size_t getCutTableMemoryBytes() const noexcept;
+
+    // Blocks until a table build started by prepare() has landed. For offline renders, whose output shouldn't depend on timing
+    void waitForCutTable();
+
+    // Forces a full redesign on the next update (sample rate change, state restore etc)
+    void markDirty(int stages = AllStages) noexcept { dirtyStages.fetch_or(stages); }
+
+    /* Audio thread: takes and clears the pending dirty bits.
+        Call this BEFORE reading ChainSettings so a change that lands mid-design is seen next block
+     */
+    int takeDirtyStages() noexcept { return dirtyStages.exchange(0); }
+
+    /* Audio thread: redesigns the requested stages in place, no allocation.
+        shareDesigns goes through the process-wide CoefficientCache: only for settings straight from the parameters,
+        never for the in-between values of a ramp. A shared stage holds a reference to the cache's design rather than
+        a copy of it, until it's designed again
+     */
+    void design(const ChainSettings& chainSettings, int stages, bool shareDesigns = false) noexcept;
+
+    /* Audio thread: shares the stages' current designs after all, for ones designed without shareDesigns whose values
+        have since settled. No redesign: the cache either already has the same key (and so bit-identical coefficients)
+        or gets a copy of ours, either way nothing the filters run changes. Table lookups and stages that are already
+        shared are skipped
+     */
+    void share(int stages) noexcept;
+
+    const CutCoefficients& getLowCut() const noexcept
+    {
+        auto& shared = sharedStages[lowCutIndex].design;
+        return shared ? shared.get() : lowCut;
+    }
+
+    const BiquadCoefficients& getPeak() const noexcept
+    {
+        auto& shared = sharedStages[peakIndex].design;
+        return shared ? shared.get().sections[0] : peak;
+    }
+
+    const CutCoefficients& getHighCut() const noexcept
+    {
+        auto& shared = sharedStages[highCutIndex].design;
+        return shared ? shared.get() : highCut;
+    }
+
+    const BiquadCoefficients& getBand(int band) const noexcept
+    {
+        auto& shared = sharedStages[(size_t) (firstBandIndex + band)].design;
+        return shared ? shared.get().sections[0] : bands[(size_t) band];
+    }
+
+    // Whether the last design of this band had it switched on. Bands that are off aren't part of the chain
+    bool isBandEnabled(int band) const noexcept { return bandEnabled[(size_t) band]; }
+
+    // Calls fn(const BiquadCoefficients&) for every section of the current design that's in the chain
+    template <typename Callback>
+    void forEachSection(Callback&& fn) const
+    {
+        auto& low = getLowCut();
+        auto& high = getHighCut();
+
+        for (int i = 0; i < low.numSections; ++i)
+            fn(low.sections[(size_t) i]);
+
+        fn(getPeak());
+
+        for (int i = 0; i < high.numSections; ++i)
+            fn(high.sections[(size_t) i]);
+
+        for (int i = 0; i < ChainSettings::maxBands; ++i)
+            if (bandEnabled[(size_t) i])
+                fn(getBand(i));
+    }
+
+    /* How many samples until the impulse response of the current design (every section in the chain) has decayed
+        below threshold (relative to the input), worked out from each section's pole radius.
+        Summed over the sections since they're in series - errs on the long side
+     */
+    double getDecaySamples(double threshold) const noexcept;
+
+    //==============================================================================
+    // Plain RBJ / Butterworth designs, same maths as juce::dsp::IIR::Coefficients and FilterDesign
+    static BiquadCoefficients makePeakFilter(double sampleRate, double frequency, double Q, double gainFactor) noexcept;
+    static BiquadCoefficients makeLowPass(double sampleRate, double frequency, double Q) noexcept;
+    static BiquadCoefficients makeHighPass(double sampleRate, double frequency, double Q) noexcept;
+    static BiquadCoefficients makeLowShelf(double sampleRate, double frequency, double Q, double gainFactor) noexcept;
+    static BiquadCoefficients makeHighShelf(double sampleRate, double frequency, double Q, double gainFactor) noexcept;
+    static BiquadCoefficients makeNotch(double sampleRate, double frequency, double Q) noexcept;
+
+    // RBJ band pass with 0 dB at the centre, for the dynamic bands' detectors
+    static BiquadCoefficients makeBandPass(double sampleRate, double frequency, double Q) noexcept;
+
+    /* One biquad tilt: a high shelf with half its gain taken back off, so the response pivots around frequency
+        (-gain/2 at the bottom, +gain/2 at the top)
+     */
+    static BiquadCoefficients makeTilt(double sampleRate, double frequency, double Q, double gainInDecibels) noexcept;
+
+    static BiquadCoefficients makeBand(double sampleRate, const BandSettings& band) noexcept;
+
+    /* Everything a bell, shelf or tilt design needs apart from its gain, worked out once for a frequency and Q.
+        withGain() then gives the same coefficients as makePeakFilter / makeLowShelf / makeHighShelf / makeTilt for any
+        gain with one exp for a bell, two for a shelf or tilt (A and its square root), and a divide or two - no trig,
+        no square roots. What the dynamic bands use, their gain moves every sub-block while frequency and Q sit still.
+        Notch has no gain, withGain() just hands back the notch
+     */
+    struct GainDesign
+    {
+        BiquadCoefficients withGain(double gainInDecibels) const noexcept;
+
+        BandType type { BandType::Bell };
+        double cosOmega { 1.0 }, sinOmega { 0.0 }, invQ { 1.0 };
+        BiquadCoefficients notch;
+    };
+
+    static GainDesign makeGainDesign(double sampleRate, BandType type, double frequency, double Q) noexcept;
+
+    // order must be even (2, 4, 6, 8) which is all the Slope choices give us
+    static void designLowPassButterworth(CutCoefficients& result, double sampleRate, double frequency, int order) noexcept;
+    static void designHighPassButterworth(CutCoefficients& result, double sampleRate, double frequency, int order) noexcept;
+
+    // |H(e^jw)| of one section at frequency
+    static double getMagnitudeForFrequency(const BiquadCoefficients& coefficients, double frequency, double sampleRate) noexcept;
+
+    /* power[i] *= |H|^2 of one section at the frequency whose cos(w) / cos(2w) are cos1[i] / cos2[i].
+        For curves over a whole frequency grid: no trig per point, vectorises
+     */
+    static void multiplyPowerResponse(const BiquadCoefficients& coefficients, const double* cos1, const double* cos2,
+                                      double* power, int numPoints) noexcept;
+
+    // largest |pole| of one section, >= 1 means it never decays
+    static double getPoleRadius(const BiquadCoefficients& coefficients) noexcept;
+    static double getDecaySamples(const BiquadCoefficients& coefficients, double threshold) noexcept;
+
+    void parameterChanged(const juce::String& parameterID, float newValue) override;
+
+private:
+    // One per stage, in the order of the Stage bits
+    static constexpr size_t lowCutIndex = 0, peakIndex = 1, highCutIndex = 2, firstBandIndex = 3;
+    static constexpr size_t numStages = firstBandIndex + ChainSettings::maxBands;
+
+    struct SharedStage
+    {
+        CoefficientCache::Key key;      // what the current design was made from, if exact
+        bool exact { false };           // designed rather than looked up in the cut table, so it may be shared
+        CoefficientCache::SharedDesign design;
+    };
+
+    /* Points stage at the cache's design for its key if there is one, otherwise runs designFn into result and shares
+        that. Without shareDesigns stage lets go of whatever it held and result is designed locally, share() can
+        still hand it to the cache later
+     */
+    template <typename DesignFn>
+    void designShared(SharedStage& stage, CutCoefficients& result, int kind, int variant,
+                      float freq, float gain, float quality, bool shareDesigns, DesignFn&& designFn) noexcept;
+
+    double sampleRate { 44100.0 };
+
+    CutCoefficients lowCut, highCut;
+    BiquadCoefficients peak;
+
+    std::array<BiquadCoefficients, ChainSettings::maxBands> bands;
+    std::array<bool, ChainSettings::maxBands> bandEnabled {};
+
+    // a stage holding a design uses the cache's coefficients, the local ones above are stale then
+    std::array<SharedStage, numStages> sharedStages;
+
+    /* Two slots, so a table for a new rate can be fetched on a background thread while the audio thread keeps reading
+        the other. The tables themselves are CutFilterTable::getShared()'s, one per rate and resolution for the whole
+        process. The new one is handed over with a single atomic store of its index. Builds only ever go into the
+        slot that isn't published, and prepare() waits for the last build before starting the next
+     */
+    struct CutTableSlot
+    {
+        std::shared_ptr<const CutFilterTable> table;
+        double sampleRate { 0.0 };
+        int entriesPerOctave { 0 };
+    };
+
+    std::array<CutTableSlot, 2> cutTables;
+    std::atomic<int> publishedCutTable { -1 };
+    std::atomic<int> cutTableEntriesPerOctave { 0 };
+
+    // the published table if it was built for rate, otherwise nullptr. Audio thread
+    const CutFilterTable* getCutTable(double rate) const noexcept;
+
+    std::atomic<int> dirtyStages { AllStages };
+
+    CoefficientCache& sharedDesigns;
+
+    // last, so it's destroyed first: waits for a build that's still running
+    std::future<void> cutTableBuild;
+};
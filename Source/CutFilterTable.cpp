@@ -0,0 +1,118 @@
+/*
+  ==============================================================================
+
+    CutFilterTable.cpp
+    Precomputed Butterworth designs for the LowCut / HighCut stages.
+
+  ==============================================================================
+*/
+
+#include "CutFilterTable.h"
+
+int CutFilterTable::firstSectionForOrder(int order) noexcept
+{
+    // order 2 -> 0, 4 -> 1, 6 -> 3, 8 -> 6
+    auto slope = order / 2 - 1;
+    return slope * (slope + 1) / 2;
+}
+
+void CutFilterTable::clear()
+{
+    table.clear();
+    table.shrink_to_fit();
+    numEntries = 0;
+}
+
+void CutFilterTable::build(double sampleRate, int newEntriesPerOctave)
+{
+    if (newEntriesPerOctave <= 0 || sampleRate <= 0.0)
+    {
+        clear();
+        return;
+    }
+
+    entriesPerOctave = newEntriesPerOctave;
+    numEntries = (int) std::ceil(std::log2(maxFrequency / minFrequency) * entriesPerOctave) + 1;
+    table.assign((size_t) numTypes * (size_t) numEntries * sectionsPerEntry, BiquadCoefficients());
+
+    // the designs blow up at Nyquist, low sample rates just hold the last usable design for the top entries
+    auto highestFrequency = sampleRate * 0.499;
+
+    CutCoefficients design;
+
+    for (int index = 0; index < numEntries; ++index)
+    {
+        auto frequency = juce::jmin(highestFrequency, minFrequency * std::pow(2.0, index / entriesPerOctave));
+
+        for (int order = 2; order <= 8; order += 2)
+        {
+            auto first = firstSectionForOrder(order);
+
+            CoefficientEngine::designLowPassButterworth(design, sampleRate, frequency, order);
+            std::copy(design.sections.begin(), design.sections.begin() + design.numSections, entry(LowPass, index) + first);
+
+            CoefficientEngine::designHighPassButterworth(design, sampleRate, frequency, order);
+            std::copy(design.sections.begin(), design.sections.begin() + design.numSections, entry(HighPass, index) + first);
+        }
+    }
+}
+
+std::shared_ptr<const CutFilterTable> CutFilterTable::getShared(double sampleRate, int entriesPerOctave)
+{
+    struct SharedTable
+    {
+        double sampleRate;
+        int entriesPerOctave;
+        std::weak_ptr<const CutFilterTable> table;
+    };
+
+    static juce::CriticalSection lock;
+    static std::vector<SharedTable> tables;
+
+    const juce::ScopedLock sl (lock);
+
+    // tables nobody holds any more are already freed, forget them
+    tables.erase(std::remove_if(tables.begin(), tables.end(), [](const SharedTable& shared) { return shared.table.expired(); }),
+                 tables.end());
+
+    for (auto& shared : tables)
+        if (shared.sampleRate == sampleRate && shared.entriesPerOctave == entriesPerOctave)
+            if (auto table = shared.table.lock())
+                return table;
+
+    auto table = std::make_shared<CutFilterTable>();
+    table->build(sampleRate, entriesPerOctave);
+    tables.push_back({ sampleRate, entriesPerOctave, table });
+
+    return table;
+}
+
+void CutFilterTable::lookup(CutCoefficients& result, Type type, double frequency, int order) const noexcept
+{
+    jassert(! isEmpty());
+    jassert(order > 0 && order % 2 == 0 && order / 2 <= CutCoefficients::maxSections);
+
+    auto position = juce::jlimit(0.0, (double) (numEntries - 1),
+                                 std::log2(juce::jmax(frequency, minFrequency) / minFrequency) * entriesPerOctave);
+    auto index = juce::jmin((int) position, numEntries - 2);
+    auto fraction = position - index;
+
+    auto first = firstSectionForOrder(order);
+    auto* lower = entry(type, index) + first;
+    auto* upper = entry(type, index + 1) + first;
+
+    result.numSections = order / 2;
+
+    for (int i = 0; i < result.numSections; ++i)
+    {
+        auto& a = lower[i];
+        auto& b = upper[i];
+        auto& s = result.sections[(size_t) i];
+
+        s.b0 = a.b0 + (b.b0 - a.b0) * fraction;
+        s.b1 = a.b1 + (b.b1 - a.b1) * fraction;
+        s.b2 = a.b2 + (b.b2 - a.b2) * fraction;
+        s.a1 = a.a1 + (b.a1 - a.a1) * fraction;
+        s.a2 = a.a2 + (b.a2 - a.a2) * fraction;
+    }
+}
@@ -0,0 +1,79 @@
+/*
+  ==============================================================================
+
+    CutFilterTable.h
+    Precomputed Butterworth designs for the LowCut / HighCut stages.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "CoefficientEngine.h"
+#include <memory>
+#include <vector>
+
+/* Cut frequency only ever lives in 20 Hz - 20 kHz and there are just four slopes, so for a given sample rate
+    every design we could need fits in a table. Automation sweeps of the cut frequencies then cost a couple of
+    lerps per section instead of a tan() and a handful of divides.
+
+    Entries are spaced evenly in octaves (same spacing the ear uses). Between entries each coefficient is
+    linearly interpolated, which can't make a section unstable: the (a1, a2) stability triangle is convex.
+    Resolution is the memory knob, see getMemoryBytes().
+
+    A table only depends on its rate and resolution, so the engines don't build their own: getShared() hands every
+    path of every instance in the process the same one, and it goes away once the last of them lets go.
+ */
+class CutFilterTable
+{
+public:
+    static constexpr double minFrequency = 20.0;
+    static constexpr double maxFrequency = 20000.0;
+
+    // Not real-time safe, allocates. entriesPerOctave <= 0 leaves the table empty
+    void build(double sampleRate, int entriesPerOctave);
+
+    /* Not real-time safe: the process-wide table for this rate and resolution, built on the calling thread if nobody
+        holds one yet. Blocks while another thread builds one, so two instances asking at once only build it once
+     */
+    static std::shared_ptr<const CutFilterTable> getShared(double sampleRate, int entriesPerOctave);
+
+    void clear();
+
+    bool isEmpty() const noexcept { return numEntries == 0; }
+
+    size_t getMemoryBytes() const noexcept { return table.size() * sizeof(BiquadCoefficients); }
+
+    // Real-time safe. order must be 2, 4, 6 or 8 (the Slope choices)
+    void lookupLowPass(CutCoefficients& result, double frequency, int order) const noexcept  { lookup(result, LowPass, frequency, order); }
+    void lookupHighPass(CutCoefficients& result, double frequency, int order) const noexcept { lookup(result, HighPass, frequency, order); }
+
+private:
+    enum Type
+    {
+        LowPass,
+        HighPass,
+        numTypes
+    };
+
+    // sections for slopes 12, 24, 36, 48 db/Oct packed one after another: 1 + 2 + 3 + 4
+    static constexpr int sectionsPerEntry = 10;
+    static int firstSectionForOrder(int order) noexcept;
+
+    void lookup(CutCoefficients& result, Type type, double frequency, int order) const noexcept;
+
+    const BiquadCoefficients* entry(Type type, int index) const noexcept
+    {
+        return table.data() + ((size_t) type * (size_t) numEntries + (size_t) index) * sectionsPerEntry;
+    }
+
+    BiquadCoefficients* entry(Type type, int index) noexcept
+    {
+        return table.data() + ((size_t) type * (size_t) numEntries + (size_t) index) * sectionsPerEntry;
+    }
+
+    std::vector<BiquadCoefficients> table;
+    int numEntries { 0 };
+    double entriesPerOctave { 0.0 };
+};
@@ -0,0 +1,191 @@
+/*
+  ==============================================================================
+
+    DynamicEQ.cpp
+    Level dependent gain for the Peak stage and the bands: a band limited
+    envelope follower per stage, fed by the input or the sidechain bus.
+
+  ==============================================================================
+*/
+
+#include "DynamicEQ.h"
+
+const std::array<const char*, 3> DynamicEQ::slotParameterFields
+{
+    "Dynamic", "Threshold", "Ratio"
+};
+
+juce::String DynamicEQ::getSlotParameterID(int slot, const juce::String& field)
+{
+    return slot == 0 ? "Peak " + field : CoefficientEngine::getBandParameterID(slot - 1, field);
+}
+
+juce::StringArray DynamicEQ::getSwitchParameterIDs()
+{
+    juce::StringArray ids;
+
+    for (int slot = 0; slot < numSlots; ++slot)
+        ids.add(getSlotParameterID(slot, "Dynamic"));
+
+    return ids;
+}
+
+DynamicEQ::DynamicEQ(juce::AudioProcessorValueTreeState& apvts)
+    : attackParameter(apvts.getRawParameterValue("Dynamic Attack")),
+      releaseParameter(apvts.getRawParameterValue("Dynamic Release")),
+      sidechainParameter(apvts.getRawParameterValue("Sidechain"))
+{
+    jassert(attackParameter != nullptr && releaseParameter != nullptr && sidechainParameter != nullptr);
+
+    for (int i = 0; i < numSlots; ++i)
+    {
+        auto& slot = slots[(size_t) i];
+
+        slot.enabled = apvts.getRawParameterValue(getSlotParameterID(i, "Dynamic"));
+        slot.threshold = apvts.getRawParameterValue(getSlotParameterID(i, "Threshold"));
+        slot.ratio = apvts.getRawParameterValue(getSlotParameterID(i, "Ratio"));
+
+        jassert(slot.enabled != nullptr && slot.threshold != nullptr && slot.ratio != nullptr);
+    }
+}
+
+void DynamicEQ::prepare(double newSampleRate, int newMaxBlockSize)
+{
+    sampleRate = newSampleRate;
+    maxBlockSize = juce::jmax(1, newMaxBlockSize);
+
+    detectorSignal.assign((size_t) maxBlockSize, 0.0f);
+    envelopes.assign((size_t) numSlots * (size_t) maxBlockSize, 0.0f);
+
+    for (auto& slot : slots)
+    {
+        // detectors are designed for the host rate, gain designs for whatever rate the chain runs at
+        slot.detectorType = BandType::Notch;
+        slot.gainDesignRate = 0.0;
+    }
+
+    reset();
+}
+
+void DynamicEQ::reset() noexcept
+{
+    for (auto& slot : slots)
+    {
+        slot.z1 = slot.z2 = 0.0;
+        slot.envelope = 0.0;
+        slot.lastGain = std::numeric_limits<double>::quiet_NaN();
+        slot.reductionForDisplay.store(0.0f, std::memory_order_relaxed);
+    }
+
+    numActiveSlots = 0;
+    numAnalysedSamples = 0;
+}
+
+void DynamicEQ::markStale(int stages) noexcept
+{
+    for (int i = 0; i < numSlots; ++i)
+        if (stages & stageForSlot(i))
+            slots[(size_t) i].lastGain = std::numeric_limits<double>::quiet_NaN();
+}
+
+void DynamicEQ::updateDetector(Slot& slot, BandType type, float freq, float quality) noexcept
+{
+    if (type == slot.detectorType && freq == slot.detectorFreq && quality == slot.detectorQuality)
+        return;
+
+    slot.detectorType = type;
+    slot.detectorFreq = freq;
+    slot.detectorQuality = quality;
+
+    // the band has to stay under Nyquist, at 32 kHz the top of the parameter range doesn't
+    auto frequency = juce::jmin((double) freq, sampleRate * 0.45);
+
+    switch (type)
+    {
+        case BandType::LowShelf:  slot.detector = CoefficientEngine::makeLowPass(sampleRate, frequency, 0.7071); break;
+        case BandType::HighShelf: slot.detector = CoefficientEngine::makeHighPass(sampleRate, frequency, 0.7071); break;
+        case BandType::Tilt:      slot.detector = {}; break;  // tilts the whole spectrum, so listens to all of it
+        case BandType::Bell:
+        case BandType::Notch:     slot.detector = CoefficientEngine::makeBandPass(sampleRate, frequency, quality); break;
+    }
+}
+
+void DynamicEQ::runDetector(Slot& slot, float* envelope, int numSamples) noexcept
+{
+    auto& c = slot.detector;
+    auto z1 = slot.z1, z2 = slot.z2;
+    auto level = slot.envelope;
+    auto attack = attackCoefficient, release = releaseCoefficient;
+
+    for (int n = 0; n < numSamples; ++n)
+    {
+        auto x = (double) detectorSignal[(size_t) n];
+        auto y = c.b0 * x + z1;
+        z1 = c.b1 * x - c.a1 * y + z2;
+        z2 = c.b2 * x - c.a2 * y;
+
+        // peak follower: rises with the attack time constant, falls with the release one
+        auto rectified = std::abs(y);
+        level = rectified + (rectified > level ? attack : release) * (level - rectified);
+
+        envelope[n] = (float) level;
+    }
+
+    slot.z1 = z1;
+    slot.z2 = z2;
+    slot.envelope = level;
+}
+
+bool DynamicEQ::getCoefficients(int index, int position, const ChainSettings& settings, double designRate,
+                                BiquadCoefficients& result) noexcept
+{
+    auto& slot = slots[(size_t) index];
+
+    auto type = BandType::Bell;
+    auto freq = settings.peakFreq, quality = settings.peakQuality;
+    auto staticGain = (double) settings.peakGainInDecibels;
+
+    if (index > 0)
+    {
+        auto& band = settings.bands[(size_t) index - 1];
+        type = band.type;
+        freq = band.freq;
+        quality = band.quality;
+        staticGain = band.gainInDecibels;
+    }
+
+    // the trig only happens when the stage's frequency, Q, type or rate moved (a ramp, an oversampling switch)
+    auto designChanged = designRate != slot.gainDesignRate || type != slot.gainDesign.type
+                      || freq != slot.gainDesignFreq || quality != slot.gainDesignQuality;
+
+    if (designChanged)
+    {
+        slot.gainDesign = CoefficientEngine::makeGainDesign(designRate, type, freq, quality);
+        slot.gainDesignRate = designRate;
+        slot.gainDesignFreq = freq;
+        slot.gainDesignQuality = quality;
+    }
+
+    auto reduction = 0.0;
+
+    if (numAnalysedSamples > 0)
+    {
+        auto level = (double) envelopes[(size_t) index * (size_t) maxBlockSize + (size_t) juce::jlimit(0, numAnalysedSamples - 1, position)];
+        auto over = juce::Decibels::gainToDecibels(level, -200.0) - slot.thresholdDecibels;
+
+        if (over > 0.0)
+            reduction = juce::jmin(maxReductionDecibels, over * slot.slope);
+    }
+
+    slot.reductionForDisplay.store((float) reduction, std::memory_order_relaxed);
+
+    // 0.01 dB steps aren't worth reloading a section for
+    auto gain = staticGain - reduction;
+
+    if (! designChanged && std::abs(gain - slot.lastGain) < 0.01)
+        return false;
+
+    slot.lastGain = gain;
+    result = slot.gainDesign.withGain(gain);
+    return true;
+}
@@ -0,0 +1,225 @@
+/*
+  ==============================================================================
+
+    DynamicEQ.h
+    Level dependent gain for the Peak stage and the bands: a band limited
+    envelope follower per stage, fed by the input or the sidechain bus.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ChainSettings.h"
+#include "CoefficientEngine.h"
+#include <array>
+#include <vector>
+
+/*
+ Turns any bell, shelf or tilt stage into a compressor for its own part of the spectrum, instead of chaining a
+ separate plugin for it. A stage with "<Stage> Dynamic" on gets a detector: a band pass at the bell's frequency
+ and Q (low pass / high pass for the shelves, nothing for tilt), an attack / release envelope on its output, and
+ a gain computer - above "<Stage> Threshold" the stage's gain is pulled down by (level - threshold)(1 - 1 / ratio).
+ So a boost backs off when its band gets loud, and a cut digs deeper.
+
+ analyse() runs once per block at the host rate, ahead of the chain, and keeps every sample's envelope.
+ The processor then asks for coefficients every sub-block. Frequency and Q hardly ever move while the gain does,
+ so those come from a CoefficientEngine::GainDesign (the trig done once) rather than a full makePeakFilter, and a
+ stage whose gain hasn't moved isn't touched at all.
+
+ In dual mono and mid / side each filter path has a DynamicEQ of its own, listening to its own channel (see Input)
+ and working on that path's stages. The Dynamic / Threshold / Ratio switches are shared between the paths.
+
+ Notch has no gain and never goes dynamic. Linear phase mode ignores all of this, its kernel can't follow
+ a gain that moves every few milliseconds.
+ */
+class DynamicEQ
+{
+public:
+    // slot 0 is the Peak stage, slot 1 + n is Band n (0 based)
+    static constexpr int numSlots = 1 + ChainSettings::maxBands;
+
+    // however far over the threshold a band gets, its gain comes down by no more than this
+    static constexpr double maxReductionDecibels = 30.0;
+
+    // "Peak <Field>" / "Band<n> <Field>" for every slot
+    static const std::array<const char*, 3> slotParameterFields;
+    static juce::String getSlotParameterID(int slot, const juce::String& field);
+
+    // the "Dynamic" switch of every slot: flipping it off has to bring the stage's static design back
+    static juce::StringArray getSwitchParameterIDs();
+
+    static constexpr int stageForSlot(int slot) noexcept
+    {
+        return slot == 0 ? CoefficientEngine::PeakStage : CoefficientEngine::bandStage(slot - 1);
+    }
+
+    // Resolves the parameter handles, same as ParameterHandles: the audio thread only ever does atomic loads
+    explicit DynamicEQ(juce::AudioProcessorValueTreeState& apvts);
+
+    // Not real-time safe: room for every slot's envelope over maxBlockSize host rate samples
+    void prepare(double sampleRate, int maxBlockSize);
+    void reset() noexcept;
+
+    // "Sidechain" parameter: the detectors listen to the sidechain bus (when the host connects one) instead of the input
+    bool usesSidechain() const noexcept { return sidechainParameter->load() > 0.5f; }
+
+    /* What the detectors hear of their block: the mean of every channel, or for a path of its own in the split stereo
+        modes the left / right channel (dual mono) or the side signal (L - R) / 2 (the mid is the mean).
+        Blocks with fewer than two channels always give the mean
+     */
+    enum class Input
+    {
+        Mean,
+        FirstChannel,
+        SecondChannel,
+        Side
+    };
+
+    /* Audio thread, once a block before the chain runs: works out which slots are dynamic for these settings and runs
+        their detectors over input of the block. Allocation free
+     */
+    template <typename SampleType>
+    void analyse(const juce::dsp::AudioBlock<SampleType>& detector, const ChainSettings& settings,
+                 Input input = Input::Mean) noexcept;
+
+    bool isActive() const noexcept { return numActiveSlots > 0; }
+    int getNumActiveSlots() const noexcept { return numActiveSlots; }
+    int getActiveSlot(int index) const noexcept { return activeSlots[(size_t) index]; }
+
+    /* Audio thread: the coefficients for slot from the envelope at host rate sample position of the last analyse(),
+        with the static gain, frequency and Q taken from settings and designed at designRate.
+        False if they'd be the same as last time, nothing to load then
+     */
+    bool getCoefficients(int slot, int position, const ChainSettings& settings, double designRate,
+                         BiquadCoefficients& result) noexcept;
+
+    // Audio thread: these stages just got their static design loaded, the next getCoefficients() has to overwrite it
+    void markStale(int stages) noexcept;
+
+    // Any thread: how far each slot's gain is pulled down right now (0 when it isn't dynamic), for meters
+    float getGainReduction(int slot) const noexcept { return slots[(size_t) slot].reductionForDisplay.load(std::memory_order_relaxed); }
+
+private:
+    struct Slot
+    {
+        std::atomic<float>* enabled { nullptr };
+        std::atomic<float>* threshold { nullptr };
+        std::atomic<float>* ratio { nullptr };
+
+        // detector, host rate. Redesigned only when the stage's type / frequency / Q move
+        BiquadCoefficients detector;
+        BandType detectorType { BandType::Notch };
+        float detectorFreq { 0.0f }, detectorQuality { 0.0f };
+        double z1 { 0.0 }, z2 { 0.0 };
+        double envelope { 0.0 };
+
+        // gain-only designs at the chain's rate
+        CoefficientEngine::GainDesign gainDesign;
+        double gainDesignRate { 0.0 };
+        float gainDesignFreq { 0.0f }, gainDesignQuality { 0.0f };
+
+        double lastGain { std::numeric_limits<double>::quiet_NaN() };
+        double thresholdDecibels { 0.0 }, slope { 0.0 };
+
+        std::atomic<float> reductionForDisplay { 0.0f };
+    };
+
+    void updateDetector(Slot& slot, BandType type, float freq, float quality) noexcept;
+    void runDetector(Slot& slot, float* envelopes, int numSamples) noexcept;
+
+    std::array<Slot, numSlots> slots;
+    std::array<int, numSlots> activeSlots {};
+    int numActiveSlots { 0 };
+
+    std::atomic<float>* attackParameter { nullptr };
+    std::atomic<float>* releaseParameter { nullptr };
+    std::atomic<float>* sidechainParameter { nullptr };
+
+    double sampleRate { 44100.0 };
+    double attackCoefficient { 0.0 }, releaseCoefficient { 0.0 };
+    int maxBlockSize { 0 }, numAnalysedSamples { 0 };
+
+    std::vector<float> detectorSignal;
+    std::vector<float> envelopes;   // numSlots x maxBlockSize, slot after slot
+
+    JUCE_DECLARE_NON_COPYABLE (DynamicEQ)
+};
+
+//==============================================================================
+template <typename SampleType>
+void DynamicEQ::analyse(const juce::dsp::AudioBlock<SampleType>& detector, const ChainSettings& settings, Input input) noexcept
+{
+    numActiveSlots = 0;
+
+    for (int i = 0; i < numSlots; ++i)
+    {
+        auto& slot = slots[(size_t) i];
+        auto type = i == 0 ? BandType::Bell : settings.bands[(size_t) i - 1].type;
+        auto stageOn = i == 0 || settings.bands[(size_t) i - 1].enabled;
+
+        if (slot.enabled->load(std::memory_order_relaxed) > 0.5f && stageOn && type != BandType::Notch)
+            activeSlots[(size_t) numActiveSlots++] = i;
+        else
+            slot.reductionForDisplay.store(0.0f, std::memory_order_relaxed);
+    }
+
+    if (numActiveSlots == 0)
+        return;
+
+    // hosts may go over the announced block size, the envelope stops at what prepare() made room for
+    auto numSamples = juce::jmin((int) detector.getNumSamples(), maxBlockSize);
+    auto numChannels = (int) detector.getNumChannels();
+    numAnalysedSamples = numSamples;
+
+    // one pole time constants, the envelope covers 1 - 1/e of a step in that time
+    attackCoefficient = std::exp(-1.0 / (juce::jmax(0.01, (double) attackParameter->load(std::memory_order_relaxed)) * 0.001 * sampleRate));
+    releaseCoefficient = std::exp(-1.0 / (juce::jmax(0.01, (double) releaseParameter->load(std::memory_order_relaxed)) * 0.001 * sampleRate));
+
+    if (numChannels == 0)
+    {
+        std::fill(detectorSignal.begin(), detectorSignal.begin() + numSamples, 0.0f);
+    }
+    else if (input != Input::Mean && numChannels >= 2)
+    {
+        auto* first = detector.getChannelPointer(0);
+        auto* second = detector.getChannelPointer(1);
+
+        for (int n = 0; n < numSamples; ++n)
+            detectorSignal[(size_t) n] = (float) (input == Input::FirstChannel  ? first[n]
+                                                : input == Input::SecondChannel ? second[n]
+                                                                                : (first[n] - second[n]) * (SampleType) 0.5);
+    }
+    else
+    {
+        auto scale = (SampleType) 1 / (SampleType) numChannels;
+
+        for (int n = 0; n < numSamples; ++n)
+        {
+            SampleType sum = 0;
+
+            for (int channel = 0; channel < numChannels; ++channel)
+                sum += detector.getChannelPointer((size_t) channel)[n];
+
+            detectorSignal[(size_t) n] = (float) (sum * scale);
+        }
+    }
+
+    for (int i = 0; i < numActiveSlots; ++i)
+    {
+        auto index = activeSlots[(size_t) i];
+        auto& slot = slots[(size_t) index];
+
+        if (index == 0)
+            updateDetector(slot, BandType::Bell, settings.peakFreq, settings.peakQuality);
+        else
+            updateDetector(slot, settings.bands[(size_t) index - 1].type, settings.bands[(size_t) index - 1].freq,
+                           settings.bands[(size_t) index - 1].quality);
+
+        slot.thresholdDecibels = slot.threshold->load(std::memory_order_relaxed);
+        slot.slope = 1.0 - 1.0 / juce::jmax(1.0, (double) slot.ratio->load(std::memory_order_relaxed));
+
+        runDetector(slot, envelopes.data() + (size_t) index * (size_t) maxBlockSize, numSamples);
+    }
+}
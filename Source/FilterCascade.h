@@ -0,0 +1,795 @@
+/*
+  ==============================================================================
+
+    FilterCascade.h
+    Biquad cascade that runs several channels at once in SIMD lanes.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "CoefficientEngine.h"
+#include "PerformanceCounters.h"
+#include <vector>
+
+/* Every channel goes through the same LowCut -> Peak -> HighCut (+ bands) sections with identical coefficients,
+    so instead of one scalar IIR::Filter chain per channel we pack channels into the lanes of a SIMDRegister
+    (4 floats with SSE/NEON, 8 with AVX) and push them all through one coefficient set.
+
+    SampleType is what the coefficients and state are held in. The audio itself can be float or double either way,
+    it gets converted on the way in and out of the interleave buffer - so a double cascade on a float buffer is
+    the mixed precision mode (float I/O, double state) for free.
+
+    Falls back to one channel per "lane group" when JUCE is built without SIMD support.
+
+    Coefficients are stored struct-of-arrays (all b0s together, all b1s...), and the sections that aren't bypassed
+    are kept in a compacted index list. The process loop walks that list, so a cascade with room for 30+ sections
+    and 3 switched on costs 3 sections - there's no per-section or per-sample bypass check. Neighbouring sections
+    of a stage are run together, a whole cut slope in one pass over the samples (see processRun).
+
+    The coefficients are per lane underneath, so the first two channels can also run different designs (see StereoMode):
+    each lane belongs to one of maxPaths coefficient paths, and linked stereo just has every lane on path 0.
+ */
+#if JUCE_USE_SIMD
+template <typename SampleType>
+struct SIMDLanes
+{
+    using Type = juce::dsp::SIMDRegister<SampleType>;
+    static constexpr size_t size = Type::SIMDNumElements;
+    static Type expand(SampleType value) noexcept { return Type::expand(value); }
+    static void setLane(Type& vector, size_t lane, SampleType value) noexcept { vector.set(lane, value); }
+
+    // zero in every lane that's within threshold of zero, the rest untouched
+    static Type flushTiny(Type vector, SampleType threshold) noexcept
+    {
+        auto keep = Type::greaterThan(vector, Type::expand(threshold)) | Type::lessThan(vector, Type::expand(-threshold));
+        return vector & keep;
+    }
+};
+#else
+template <typename SampleType>
+struct SIMDLanes
+{
+    using Type = SampleType;
+    static constexpr size_t size = 1;
+    static Type expand(SampleType value) noexcept { return value; }
+    static void setLane(Type& vector, size_t, SampleType value) noexcept { vector = value; }
+    static Type flushTiny(Type vector, SampleType threshold) noexcept { return std::abs(vector) > threshold ? vector : SampleType(0); }
+};
+#endif
+
+//==============================================================================
+/* How each biquad section is realised. Both run the same designs and have the same response with fixed coefficients,
+    they differ in what the state holds, and so in how they behave when the coefficients move:
+
+    TransposedDirectFormII   2 multiply-adds per coefficient, what juce::dsp::IIR::Filter runs. The state is a mix of
+                             past inputs and outputs scaled by the old coefficients, so fast modulation of low, high Q
+                             sections can kick it
+    StateVariable            Cytomic's trapezoidal SVF. The state is the two integrators' charge, which stays meaningful
+                             when the coefficients change under it - smoother under modulation, and less float noise
+                             for poles near z = 1 (low cuts at high sample rates). A few more operations per sample
+ */
+enum class FilterTopology
+{
+    TransposedDirectFormII,
+    StateVariable
+};
+
+/* What the first two channels run. Same order as the "Stereo Mode" choices
+
+    Linked      every channel on path 0, one set of coefficients for all of them
+    DualMono    channel 0 (left) on path 0, channel 1 (right) on path 1
+    MidSide     channels 0 / 1 go in as mid = (L + R) / 2 and side = (L - R) / 2, on paths 0 and 1, and come back out as
+                L = M + S, R = M - S. The encode and decode happen while the samples are (de)interleaved into the SIMD lanes,
+                not as passes of their own
+
+    Any channels after the first two stay on path 0
+ */
+enum class StereoMode
+{
+    Linked,
+    DualMono,
+    MidSide
+};
+
+/* The SVF form of a biquad: g = tan(pi fc / fs), damping k, and output mix m0 (input), m1 (band), m2 (low).
+    Derived from the digital coefficients by undoing the bilinear transform, so any design the engine makes
+    (cuts, peaks, shelves, notches) maps over without the SVF needing its own design code
+ */
+struct StateVariableCoefficients
+{
+    double a1 { 0.0 }, a2 { 0.0 }, a3 { 0.0 };
+    double m0 { 1.0 }, m1 { 0.0 }, m2 { 0.0 };
+
+    static StateVariableCoefficients fromBiquad(const BiquadCoefficients& c) noexcept
+    {
+        /* The SVF's digital denominator is (1 + gk + g^2) + 2 (g^2 - 1) z^-1 + (1 - gk + g^2) z^-2,
+            so at z = 1 and z = -1 (where the analog prototype is at DC and infinity):
+                1 + a1 + a2 = 4 g^2 / d0        1 - a1 + a2 = 4 / d0        with d0 = 1 + gk + g^2
+            and the numerator splits up the same way into the prototype's s^2, s and 1 terms
+         */
+        auto dcSum = 1.0 + c.a1 + c.a2;
+        auto nyquistSum = 1.0 - c.a1 + c.a2;
+
+        // any stable design has both positive
+        jassert(dcSum > 0.0 && nyquistSum > 0.0);
+
+        auto g = std::sqrt(juce::jmax(1.0e-30, dcSum) / juce::jmax(1.0e-30, nyquistSum));
+        auto d0 = 4.0 / juce::jmax(1.0e-30, nyquistSum);
+        auto k = (1.0 - c.a2) * d0 / (2.0 * g);
+
+        auto highGain = (c.b0 - c.b1 + c.b2) * d0 * 0.25;             // s^2
+        auto bandGain = (c.b0 - c.b2) * d0 / (2.0 * g);               // s
+        auto lowGain = (c.b0 + c.b1 + c.b2) * d0 / (4.0 * g * g);     // 1
+
+        StateVariableCoefficients result;
+        result.a1 = 1.0 / (1.0 + g * (g + k));
+        result.a2 = g * result.a1;
+        result.a3 = g * result.a2;
+        result.m0 = highGain;
+        result.m1 = bandGain - k * highGain;
+        result.m2 = lowGain - highGain;
+
+        return result;
+    }
+};
+
+//==============================================================================
+template <typename SampleType, int NumSections>
+class FilterCascade
+{
+public:
+    using Lanes = SIMDLanes<SampleType>;
+    using Vec = typename Lanes::Type;
+
+    static constexpr int numSections = NumSections;
+    static constexpr int maxPaths = 2;
+
+    FilterCascade()
+    {
+        for (int i = 0; i < NumSections; ++i)
+            setCoefficients(i, {});
+
+        rebuildActiveList();
+    }
+
+    /* Allocates state for spec.numChannels and an interleave buffer for spec.maximumBlockSize.
+        Not real-time safe, call from prepareToPlay
+     */
+    void prepare(const juce::dsp::ProcessSpec& spec)
+    {
+        numChannels = (size_t) spec.numChannels;
+        numGroups = (numChannels + Lanes::size - 1) / Lanes::size;
+        maxBlockSize = juce::jmax((size_t) 1, (size_t) spec.maximumBlockSize);
+
+        state.assign(numGroups * NumSections * 2, Vec {});
+        interleaved.assign(maxBlockSize, Vec {});
+
+        // every group has its own lanes' worth of coefficients, filled in from the designs we already have
+        coefficients.assign(numGroups, Coefficients {});
+        stateVariable.assign(numGroups, StateVariableSet {});
+        reloadCoefficients();
+
+        reset();
+    }
+
+    /* Real-time safe and cheap: the state is one contiguous array, so this is a single fill of
+        numGroups * NumSections * 2 registers, nothing gets reallocated or redesigned. What seeks and loop restarts want
+     */
+    void reset() noexcept
+    {
+        std::fill(state.begin(), state.end(), Lanes::expand(0));
+    }
+
+    /* On by default, see antiDenormalOffset. Off gives the plain recurrences, for the benchmarks to compare against.
+        Takes effect at the next process()
+     */
+    void setDenormalProtection(bool shouldProtect) noexcept
+    {
+        antiDenormal = shouldProtect ? antiDenormalOffset : SampleType(0);
+    }
+
+    /* Loads one biquad design into every lane on path, real-time safe. The same call for every topology,
+        the design is converted for the one that's running. In Linked mode nothing runs path 1, its designs are
+        only kept for when the mode changes
+     */
+    void setCoefficients(int section, const BiquadCoefficients& c, int path = 0) noexcept
+    {
+        jassert(juce::isPositiveAndBelow(section, NumSections) && juce::isPositiveAndBelow(path, maxPaths));
+
+        designs[(size_t) path][(size_t) section] = c;
+        writeLanes(section, path);
+    }
+
+    /* Real-time safe, but call it from the audio thread. The state of one topology means nothing to the other, so a
+        switch clears it - expect a click if there's signal going through
+     */
+    void setTopology(FilterTopology newTopology) noexcept
+    {
+        if (newTopology == topology)
+            return;
+
+        topology = newTopology;
+        reloadCoefficients();
+
+        // the runs' kernels are per topology
+        activeListChanged = true;
+        reset();
+    }
+
+    FilterTopology getTopology() const noexcept { return topology; }
+
+    /* Real-time safe, audio thread. Mid / side state means nothing as left / right and the other way round,
+        so a switch clears the state as well
+     */
+    void setStereoMode(StereoMode newMode) noexcept
+    {
+        if (newMode == stereoMode)
+            return;
+
+        stereoMode = newMode;
+        reloadCoefficients();
+
+        activeListChanged = true;
+        reset();
+    }
+
+    StereoMode getStereoMode() const noexcept { return stereoMode; }
+
+    /* Most sections one pass over the samples runs, see processRun(). 1 processes every section on its own,
+        which is only there for the benchmarks to compare against. Takes effect at the next process()
+     */
+    static constexpr int maxRunLength = 4;
+    void setMaxFusedSections(int numSections) noexcept
+    {
+        maxFusedSections = juce::jlimit(1, maxRunLength, numSections);
+        activeListChanged = true;
+    }
+
+    /* A bypassed section drops out of the active list, so the processing loop never looks at a bypass flag.
+        The list is rebuilt at the start of the next process(), which means bypassing and un-bypassing a section
+        in the same update (what a slope change does) leaves it running untouched. A section that really was out
+        of the chain comes back with cleared state, rather than ringing out whatever it held when it left.
+
+        With two paths running a section only drops out once both have it bypassed. Until then the bypassed path's
+        lanes just pass their input through (b0 = 1)
+     */
+    void setBypassed(int section, bool shouldBeBypassed, int path = 0) noexcept
+    {
+        jassert(juce::isPositiveAndBelow(section, NumSections) && juce::isPositiveAndBelow(path, maxPaths));
+
+        auto& flag = bypassed[(size_t) path][(size_t) section];
+
+        if (flag == shouldBeBypassed)
+            return;
+
+        flag = shouldBeBypassed;
+        activeListChanged = true;
+
+        if (stereoMode != StereoMode::Linked)
+            writeLanes(section, path);
+    }
+
+    bool isBypassed(int section) const noexcept
+    {
+        return bypassed[0][(size_t) section] && (stereoMode == StereoMode::Linked || bypassed[1][(size_t) section]);
+    }
+
+    /* Instrumentation: which PerformanceCounters counter a section's cycles are charged to. Sections of one stage
+        sit next to each other in the active list, so the clock is only read where it crosses from one stage to
+        the next - a handful of reads per block, not two per section
+     */
+    void setSectionCounter(int section, int counter) noexcept
+    {
+        sectionCounters[(size_t) section] = counter;
+        activeListChanged = true;
+    }
+
+    // Audio thread: hands the cycles counted since the last call over to counters
+    void addCyclesTo(PerformanceCounters& counters) noexcept
+    {
+        for (size_t i = 0; i < counterCycles.size(); ++i)
+        {
+            if (counterCycles[i] != 0)
+                counters.add((int) i, counterCycles[i]);
+
+            counterCycles[i] = 0;
+        }
+    }
+
+    //==============================================================================
+    template <typename IOType>
+    void process(const juce::dsp::ProcessContextReplacing<IOType>& context) noexcept
+    {
+        if (context.isBypassed)
+            return;
+
+        if (activeListChanged)
+            rebuildActiveList();
+
+        auto& block = context.getOutputBlock();
+        auto channels = juce::jmin(numChannels, block.getNumChannels());
+        auto numSamples = block.getNumSamples();
+
+        jassert(block.getNumChannels() <= numChannels);
+
+        auto midSide = stereoMode == StereoMode::MidSide && channels >= 2;
+
+        // Without SIMD left and right end up in different groups, so there the encode and decode get passes of their own
+        if constexpr (Lanes::size < 2)
+            if (midSide)
+                encodeMidSide(block, numSamples);
+
+        // The interleave buffer is sized for the announced block size, anything bigger gets chunked
+        for (size_t start = 0; start < numSamples; start += maxBlockSize)
+        {
+            auto chunk = juce::jmin(maxBlockSize, numSamples - start);
+
+            for (size_t group = 0; group < numGroups; ++group)
+            {
+                auto firstChannel = group * Lanes::size;
+
+                if (firstChannel >= channels)
+                    break;
+
+                auto channelsInGroup = juce::jmin(Lanes::size, channels - firstChannel);
+                auto fuseMidSide = Lanes::size >= 2 && midSide && group == 0;
+
+                interleave(block, firstChannel, channelsInGroup, start, chunk, fuseMidSide);
+
+                auto* groupState = state.data() + group * NumSections * 2;
+
+                if constexpr (PerformanceCounters::enabled)
+                    processActiveSectionsTimed(groupState, group, chunk);
+                else
+                    processActiveSections(groupState, group, chunk);
+
+                deinterleave(block, firstChannel, channelsInGroup, start, chunk, fuseMidSide);
+            }
+        }
+
+        if constexpr (Lanes::size < 2)
+            if (midSide)
+                decodeMidSide(block, numSamples);
+    }
+
+    // Sections processed per block, for the benchmarks
+    int getNumActiveSections() noexcept
+    {
+        if (activeListChanged)
+            rebuildActiveList();
+
+        return numActive;
+    }
+
+private:
+    struct Coefficients
+    {
+        std::array<Vec, NumSections> b0, b1, b2, a1, a2;
+    };
+
+    struct StateVariableSet
+    {
+        std::array<Vec, NumSections> a1, a2, a3, m0, m1, m2;
+    };
+
+    /* Consecutive active sections are processed in runs of up to maxFusedSections: one pass over the interleave
+        buffer per run instead of one per section, with the run's coefficients and state held in registers between
+        samples. Each run length has its own kernel, unrolled at compile time (1 - 4 sections covers every cut slope),
+        and the member function pointer is picked when the active list is rebuilt - so at a block boundary, never in
+        the sample loop
+     */
+    using RunKernel = void (FilterCascade::*)(const int* sections, Vec* groupState, size_t group, size_t numSamples) noexcept;
+
+    struct Run
+    {
+        int firstActive { 0 };      // index into activeSections
+        int counter { 0 };          // every section in a run charges the same counter
+        RunKernel kernel { nullptr };
+    };
+
+    void processActiveSections(Vec* groupState, size_t group, size_t numSamples) noexcept
+    {
+        for (int i = 0; i < numRuns; ++i)
+        {
+            auto& run = runs[(size_t) i];
+            (this->*run.kernel)(activeSections.data() + run.firstActive, groupState, group, numSamples);
+        }
+    }
+
+    void processActiveSectionsTimed(Vec* groupState, size_t group, size_t numSamples) noexcept
+    {
+        if (numRuns == 0)
+            return;
+
+        auto counter = runs[0].counter;
+        auto start = PerformanceCounters::readCycleCounter();
+
+        for (int i = 0; i < numRuns; ++i)
+        {
+            auto& run = runs[(size_t) i];
+
+            if (run.counter != counter)
+            {
+                auto now = PerformanceCounters::readCycleCounter();
+                counterCycles[(size_t) counter] += now - start;
+                counter = run.counter;
+                start = now;
+            }
+
+            (this->*run.kernel)(activeSections.data() + run.firstActive, groupState, group, numSamples);
+        }
+
+        counterCycles[(size_t) counter] += PerformanceCounters::readCycleCounter() - start;
+    }
+
+    template <FilterTopology Topology>
+    static RunKernel getKernel(int length) noexcept
+    {
+        switch (length)
+        {
+            case 1:  return &FilterCascade::processRun<Topology, 1>;
+            case 2:  return &FilterCascade::processRun<Topology, 2>;
+            case 3:  return &FilterCascade::processRun<Topology, 3>;
+            default: break;
+        }
+
+        return &FilterCascade::processRun<Topology, 4>;
+    }
+
+    /* Every sample goes through all N sections before the next one is read. N is a constant, so the section loops
+        unroll and the sample loop has no branches left in it
+     */
+    template <FilterTopology Topology, int N>
+    void processRun(const int* sections, Vec* groupState, size_t group, size_t numSamples) noexcept
+    {
+        if constexpr (Topology == FilterTopology::StateVariable)
+        {
+            // Trapezoidal SVF (Simper, "Linear Trapezoidal Integrated SVF"), the state is the integrators' ic1eq / ic2eq
+            Vec a1[N], a2[N], a3[N], m0[N], m1[N], m2[N], ic1eq[N], ic2eq[N];
+            auto& c = stateVariable[group];
+            auto offset = Lanes::expand(antiDenormal);
+
+            for (int k = 0; k < N; ++k)
+            {
+                auto section = (size_t) sections[k];
+                a1[k] = c.a1[section];
+                a2[k] = c.a2[section];
+                a3[k] = c.a3[section];
+                m0[k] = c.m0[section];
+                m1[k] = c.m1[section];
+                m2[k] = c.m2[section];
+                ic1eq[k] = groupState[section * 2];
+                ic2eq[k] = groupState[section * 2 + 1];
+            }
+
+            for (size_t i = 0; i < numSamples; ++i)
+            {
+                auto x = interleaved[i];
+
+                for (int k = 0; k < N; ++k)
+                {
+                    x = x + offset;
+                    auto v3 = x - ic2eq[k];
+                    auto v1 = (a1[k] * ic1eq[k]) + (a2[k] * v3);
+                    auto v2 = ic2eq[k] + (a2[k] * ic1eq[k]) + (a3[k] * v3);
+                    ic1eq[k] = v1 + v1 - ic1eq[k];
+                    ic2eq[k] = v2 + v2 - ic2eq[k];
+                    x = (m0[k] * x) + (m1[k] * v1) + (m2[k] * v2);
+                }
+
+                interleaved[i] = x;
+            }
+
+            storeState(sections, groupState, ic1eq, ic2eq);
+        }
+        else
+        {
+            // Transposed Direct Form II, same recurrence juce::dsp::IIR::Filter runs for a 2nd order section
+            Vec b0[N], b1[N], b2[N], a1[N], a2[N], z1[N], z2[N];
+            auto& c = coefficients[group];
+            auto offset = Lanes::expand(antiDenormal);
+
+            for (int k = 0; k < N; ++k)
+            {
+                auto section = (size_t) sections[k];
+                b0[k] = c.b0[section];
+                b1[k] = c.b1[section];
+                b2[k] = c.b2[section];
+                a1[k] = c.a1[section];
+                a2[k] = c.a2[section];
+                z1[k] = groupState[section * 2];
+                z2[k] = groupState[section * 2 + 1];
+            }
+
+            for (size_t i = 0; i < numSamples; ++i)
+            {
+                auto x = interleaved[i];
+
+                for (int k = 0; k < N; ++k)
+                {
+                    x = x + offset;
+                    auto out = (x * b0[k]) + z1[k];
+                    z1[k] = (x * b1[k]) - (out * a1[k]) + z2[k];
+                    z2[k] = (x * b2[k]) - (out * a2[k]);
+                    x = out;
+                }
+
+                interleaved[i] = x;
+            }
+
+            storeState(sections, groupState, z1, z2);
+        }
+    }
+
+    /* End of a run: the state goes back where it came from. With the protection on, anything that's drifted down to
+        flushThreshold (the offset keeps that from happening in the kernels, but not for state left over from before it
+        was switched on) is stored as a clean zero. Once per section per block, not per sample
+     */
+    template <int N>
+    void storeState(const int* sections, Vec* groupState, const Vec (&first)[N], const Vec (&second)[N]) noexcept
+    {
+        auto flush = antiDenormal != SampleType(0);
+
+        for (int k = 0; k < N; ++k)
+        {
+            auto* z = groupState + (size_t) sections[k] * 2;
+            z[0] = flush ? Lanes::flushTiny(first[k], flushThreshold) : first[k];
+            z[1] = flush ? Lanes::flushTiny(second[k], flushThreshold) : second[k];
+        }
+    }
+
+    void rebuildActiveList() noexcept
+    {
+        numActive = 0;
+
+        for (int i = 0; i < NumSections; ++i)
+        {
+            auto active = ! isBypassed(i);
+
+            if (active && ! running[(size_t) i])
+                clearState(i);
+
+            running[(size_t) i] = active;
+
+            if (active)
+                activeSections[(size_t) numActive++] = i;
+        }
+
+        // cut into runs, a new one whenever the current one is full or the stage (counter) changes
+        numRuns = 0;
+
+        for (int first = 0; first < numActive;)
+        {
+            auto counter = sectionCounters[(size_t) activeSections[(size_t) first]];
+            auto length = 1;
+
+            while (length < maxFusedSections && first + length < numActive
+                    && sectionCounters[(size_t) activeSections[(size_t) (first + length)]] == counter)
+                ++length;
+
+            auto& run = runs[(size_t) numRuns++];
+            run.firstActive = first;
+            run.counter = counter;
+            run.kernel = topology == FilterTopology::StateVariable ? getKernel<FilterTopology::StateVariable>(length)
+                                                                   : getKernel<FilterTopology::TransposedDirectFormII>(length);
+            first += length;
+        }
+
+        activeListChanged = false;
+    }
+
+    void clearState(int section) noexcept
+    {
+        for (size_t group = 0; group < numGroups; ++group)
+        {
+            auto* z = state.data() + (group * NumSections + (size_t) section) * 2;
+            z[0] = z[1] = Lanes::expand(0);
+        }
+    }
+
+    // which path a channel's lane runs, see StereoMode
+    int getPath(size_t channel) const noexcept
+    {
+        return stereoMode != StereoMode::Linked && channel == 1 ? 1 : 0;
+    }
+
+    /* Writes section's design for path into the lanes of every group that run it. Only split modes pass bypassed
+        sections through, a bypassed section in Linked mode isn't run at all and keeps its design for when it comes back
+     */
+    void writeLanes(int section, int path) noexcept
+    {
+        auto i = (size_t) section;
+        auto passThrough = stereoMode != StereoMode::Linked && bypassed[(size_t) path][i];
+        auto design = passThrough ? BiquadCoefficients {} : designs[(size_t) path][i];
+
+        auto svf = topology == FilterTopology::StateVariable ? StateVariableCoefficients::fromBiquad(design)
+                                                             : StateVariableCoefficients {};
+
+        for (size_t group = 0; group < numGroups; ++group)
+        {
+            for (size_t lane = 0; lane < Lanes::size; ++lane)
+            {
+                if (getPath(group * Lanes::size + lane) != path)
+                    continue;
+
+                if (topology == FilterTopology::StateVariable)
+                {
+                    auto& c = stateVariable[group];
+                    Lanes::setLane(c.a1[i], lane, static_cast<SampleType>(svf.a1));
+                    Lanes::setLane(c.a2[i], lane, static_cast<SampleType>(svf.a2));
+                    Lanes::setLane(c.a3[i], lane, static_cast<SampleType>(svf.a3));
+                    Lanes::setLane(c.m0[i], lane, static_cast<SampleType>(svf.m0));
+                    Lanes::setLane(c.m1[i], lane, static_cast<SampleType>(svf.m1));
+                    Lanes::setLane(c.m2[i], lane, static_cast<SampleType>(svf.m2));
+                }
+                else
+                {
+                    auto& c = coefficients[group];
+                    Lanes::setLane(c.b0[i], lane, static_cast<SampleType>(design.b0));
+                    Lanes::setLane(c.b1[i], lane, static_cast<SampleType>(design.b1));
+                    Lanes::setLane(c.b2[i], lane, static_cast<SampleType>(design.b2));
+                    Lanes::setLane(c.a1[i], lane, static_cast<SampleType>(design.a1));
+                    Lanes::setLane(c.a2[i], lane, static_cast<SampleType>(design.a2));
+                }
+            }
+        }
+    }
+
+    // topology, stereo mode or channel count changed: every lane of every section gets written again
+    void reloadCoefficients() noexcept
+    {
+        for (int path = 0; path < maxPaths; ++path)
+            for (int i = 0; i < NumSections; ++i)
+                writeLanes(i, path);
+    }
+
+    SampleType* interleavedSamples() noexcept { return reinterpret_cast<SampleType*>(interleaved.data()); }
+
+    /* midSide: this is the group holding channels 0 and 1, and they go into lanes 0 / 1 as mid and side.
+        Costs nothing extra, the samples are being moved anyway
+     */
+    template <typename IOType>
+    void interleave(const juce::dsp::AudioBlock<IOType>& block, size_t firstChannel, size_t channelsInGroup,
+                    size_t start, size_t numSamples, bool midSide) noexcept
+    {
+        auto* dest = interleavedSamples();
+        size_t firstLane = 0;
+
+        if (midSide)
+        {
+            auto* left = block.getChannelPointer(0) + start;
+            auto* right = block.getChannelPointer(1) + start;
+
+            for (size_t i = 0; i < numSamples; ++i)
+            {
+                auto l = static_cast<SampleType>(left[i]), r = static_cast<SampleType>(right[i]);
+                dest[i * Lanes::size] = (l + r) * SampleType(0.5);
+                dest[i * Lanes::size + 1] = (l - r) * SampleType(0.5);
+            }
+
+            firstLane = 2;
+        }
+
+        for (size_t lane = firstLane; lane < Lanes::size; ++lane)
+        {
+            if (lane < channelsInGroup)
+            {
+                auto* src = block.getChannelPointer(firstChannel + lane) + start;
+
+                for (size_t i = 0; i < numSamples; ++i)
+                    dest[i * Lanes::size + lane] = static_cast<SampleType>(src[i]);
+            }
+            else
+            {
+                // spare lanes just carry silence
+                for (size_t i = 0; i < numSamples; ++i)
+                    dest[i * Lanes::size + lane] = SampleType(0);
+            }
+        }
+    }
+
+    template <typename IOType>
+    void deinterleave(juce::dsp::AudioBlock<IOType>& block, size_t firstChannel, size_t channelsInGroup,
+                      size_t start, size_t numSamples, bool midSide) noexcept
+    {
+        auto* src = interleavedSamples();
+        size_t firstLane = 0;
+
+        if (midSide)
+        {
+            auto* left = block.getChannelPointer(0) + start;
+            auto* right = block.getChannelPointer(1) + start;
+
+            for (size_t i = 0; i < numSamples; ++i)
+            {
+                auto m = src[i * Lanes::size], s = src[i * Lanes::size + 1];
+                left[i] = static_cast<IOType>(m + s);
+                right[i] = static_cast<IOType>(m - s);
+            }
+
+            firstLane = 2;
+        }
+
+        for (size_t lane = firstLane; lane < channelsInGroup; ++lane)
+        {
+            auto* dest = block.getChannelPointer(firstChannel + lane) + start;
+
+            for (size_t i = 0; i < numSamples; ++i)
+                dest[i] = static_cast<IOType>(src[i * Lanes::size + lane]);
+        }
+    }
+
+    // the scalar build's mid / side, in place on the block
+    template <typename IOType>
+    static void encodeMidSide(juce::dsp::AudioBlock<IOType>& block, size_t numSamples) noexcept
+    {
+        auto* left = block.getChannelPointer(0);
+        auto* right = block.getChannelPointer(1);
+
+        for (size_t i = 0; i < numSamples; ++i)
+        {
+            auto l = left[i], r = right[i];
+            left[i] = (l + r) * IOType(0.5);
+            right[i] = (l - r) * IOType(0.5);
+        }
+    }
+
+    template <typename IOType>
+    static void decodeMidSide(juce::dsp::AudioBlock<IOType>& block, size_t numSamples) noexcept
+    {
+        auto* left = block.getChannelPointer(0);
+        auto* right = block.getChannelPointer(1);
+
+        for (size_t i = 0; i < numSamples; ++i)
+        {
+            auto m = left[i], s = right[i];
+            left[i] = m + s;
+            right[i] = m - s;
+        }
+    }
+
+    /* ScopedNoDenormals sets flush-to-zero for the thread, but whether that sticks is up to the CPU and the host, so the
+        kernels don't lean on it. Every section's input gets this much DC added: -360 dB in float, far below anything
+        audible but twenty orders above the denormal range, so a decaying state settles on a normal number instead of
+        sinking into it. On signal the offset is lost to rounding - below about -215 dBFS is the only place it shows
+     */
+    static constexpr SampleType antiDenormalOffset = std::is_same_v<SampleType, float> ? SampleType(1.0e-18) : SampleType(1.0e-30);
+    static constexpr SampleType flushThreshold = std::is_same_v<SampleType, float> ? SampleType(1.0e-30) : SampleType(1.0e-290);
+
+    SampleType antiDenormal { antiDenormalOffset };
+
+    FilterTopology topology { FilterTopology::TransposedDirectFormII };
+    StereoMode stereoMode { StereoMode::Linked };
+
+    // what the last setCoefficients() got per path, so a topology or mode switch can load them again
+    std::array<std::array<BiquadCoefficients, NumSections>, maxPaths> designs;
+
+    // [group], each lane holding its own path's coefficients
+    std::vector<Coefficients> coefficients;
+    std::vector<StateVariableSet> stateVariable;
+    std::array<std::array<bool, NumSections>, maxPaths> bypassed {};
+
+    // what the active list was last built from, so sections coming back in can be told apart
+    std::array<bool, NumSections> running {};
+    std::array<int, NumSections> activeSections {};
+    int numActive { 0 };
+    bool activeListChanged { true };
+
+    std::array<Run, NumSections> runs {};
+    int numRuns { 0 };
+    int maxFusedSections { maxRunLength };
+
+    std::array<int, NumSections> sectionCounters {};
+    std::array<juce::uint64, PerformanceCounters::numCounters> counterCycles {};
+
+    size_t numChannels { 0 }, numGroups { 0 }, maxBlockSize { 1 };
+
+    // [group][section][z1, z2] - one contiguous run so reset is a single fill
+    std::vector<Vec> state;
+    std::vector<Vec> interleaved;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FilterCascade)
+};
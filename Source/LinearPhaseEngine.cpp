@@ -0,0 +1,237 @@
+/*
+  ==============================================================================
+
+    LinearPhaseEngine.cpp
+    Linear phase version of the LowCut -> Peak -> HighCut chain, run as a FIR.
+
+  ==============================================================================
+*/
+
+#include "LinearPhaseEngine.h"
+
+namespace
+{
+    // ~170 ms of kernel resolves a 48 db/Oct cut at 20 Hz reasonably: 8192 at 44.1/48k, 32768 at 192k
+    constexpr double defaultKernelSeconds = 0.17;
+    constexpr int minKernelSize = 256, maxKernelSize = 1 << 17;
+
+    // first partition of the non-uniform convolution, small enough to add no latency of its own
+    constexpr int headPartitionSize = 512;
+
+    constexpr int pollIntervalMs = 20;
+}
+
+LinearPhaseEngine::LinearPhaseEngine(SettingsSource settingsSource)
+    : juce::Thread("SimpleEQ Linear Phase"),
+      getSettings(std::move(settingsSource))
+{
+}
+
+LinearPhaseEngine::~LinearPhaseEngine()
+{
+    stopThread(2000);
+}
+
+//==============================================================================
+void LinearPhaseEngine::prepare(const juce::dsp::ProcessSpec& spec, bool shouldBeEnabled)
+{
+    preparedSpec = spec;
+    enabled = shouldBeEnabled;
+
+    if (enabled)
+        build();
+    else
+        discard();
+}
+
+void LinearPhaseEngine::setEnabled(bool shouldBeEnabled)
+{
+    if (shouldBeEnabled == enabled)
+        return;
+
+    enabled = shouldBeEnabled;
+
+    if (! enabled)
+        discard();
+    else if (preparedSpec.sampleRate > 0.0)
+        build();
+}
+
+void LinearPhaseEngine::build()
+{
+    stopThread(2000);
+
+    auto& spec = preparedSpec;
+    auto requested = requestedKernelSize.load();
+    auto size = requested > 0 ? requested : (int) (spec.sampleRate * defaultKernelSeconds);
+    size = juce::jlimit(minKernelSize, maxKernelSize, juce::nextPowerOfTwo(size));
+
+    // Nothing that shapes the convolvers has changed, so the kernel they already hold is still the right one
+    auto unchanged = ! convolvers.empty() && spec.sampleRate == sampleRate && size == kernelSize
+                  && scratch.getNumChannels() == (int) spec.numChannels && scratch.getNumSamples() == (int) spec.maximumBlockSize
+                  && getSettings() == designedSettings;
+
+    if (unchanged)
+    {
+        reset();
+        startThread();
+        ready = true;
+        return;
+    }
+
+    // only prepareToPlay rebuilds ready convolvers, and the audio thread isn't running then
+    ready = false;
+
+    sampleRate = spec.sampleRate;
+    kernelSize = size;
+
+    convolvers.clear();
+
+    if (messageQueue == nullptr)
+        messageQueue = std::make_unique<juce::dsp::ConvolutionMessageQueue>();
+
+    for (juce::uint32 channel = 0; channel < spec.numChannels; channel += 2)
+        convolvers.push_back(std::make_unique<juce::dsp::Convolution>(juce::dsp::Convolution::NonUniform { headPartitionSize }, *messageQueue));
+
+    // Loaded before prepare(), so each convolver builds its engine right there instead of on the background thread
+    designedSettings = getSettings();
+    loadKernel(designedSettings);
+
+    for (size_t i = 0; i < convolvers.size(); ++i)
+    {
+        auto numChannels = juce::jmin(2u, spec.numChannels - (juce::uint32) i * 2);
+        convolvers[i]->prepare({ sampleRate, spec.maximumBlockSize, numChannels });
+    }
+
+    scratch.setSize((int) spec.numChannels, (int) spec.maximumBlockSize);
+
+    startThread();
+    ready = true;
+}
+
+void LinearPhaseEngine::discard()
+{
+    stopThread(2000);
+
+    ready = false;
+
+    while (inUse)
+        juce::Thread::yield();
+
+    convolvers.clear();
+    messageQueue.reset();
+    scratch.setSize(0, 0);
+    kernelSize = 0;
+}
+
+void LinearPhaseEngine::release()
+{
+    stopThread(2000);
+}
+
+void LinearPhaseEngine::reset() noexcept
+{
+    for (auto& convolver : convolvers)
+        convolver->reset();
+}
+
+void LinearPhaseEngine::processFloat(juce::dsp::AudioBlock<float>& block) noexcept
+{
+    auto numChannels = block.getNumChannels();
+
+    for (size_t i = 0; i < convolvers.size() && i * 2 < numChannels; ++i)
+    {
+        auto pair = block.getSubsetChannelBlock(i * 2, juce::jmin((size_t) 2, numChannels - i * 2));
+        juce::dsp::ProcessContextReplacing<float> context(pair);
+
+        convolvers[i]->process(context);
+    }
+}
+
+//==============================================================================
+void LinearPhaseEngine::run()
+{
+    while (! threadShouldExit())
+    {
+        auto settings = getSettings();
+
+        if (settings != designedSettings)
+        {
+            designedSettings = settings;
+            loadKernel(settings);
+        }
+
+        wait(pollIntervalMs);
+    }
+}
+
+void LinearPhaseEngine::loadKernel(const ChainSettings& settings)
+{
+    juce::AudioBuffer<float> kernel;
+    designKernel(settings, sampleRate, kernelSize, kernel);
+
+    // the convolvers each take ownership of a copy, and crossfade over to it once it's ready
+    for (auto& convolver : convolvers)
+        convolver->loadImpulseResponse(juce::AudioBuffer<float>(kernel), sampleRate,
+                                       juce::dsp::Convolution::Stereo::no,
+                                       juce::dsp::Convolution::Trim::no,
+                                       juce::dsp::Convolution::Normalise::no);
+}
+
+void LinearPhaseEngine::designKernel(const ChainSettings& settings, double sampleRate, int size, juce::AudioBuffer<float>& kernel)
+{
+    jassert(juce::isPowerOfTwo(size));
+
+    auto numBins = size / 2 + 1;
+
+    // |H|^2 of the whole chain on the FFT's bins
+    std::vector<double> cos1((size_t) numBins), cos2((size_t) numBins), power((size_t) numBins, 1.0);
+
+    for (int bin = 0; bin < numBins; ++bin)
+    {
+        auto w = juce::MathConstants<double>::twoPi * bin / size;
+        cos1[(size_t) bin] = std::cos(w);
+        cos2[(size_t) bin] = std::cos(2.0 * w);
+    }
+
+    CoefficientEngine engine;
+    engine.prepare(sampleRate);
+    engine.design(settings, CoefficientEngine::AllStages);
+
+    engine.forEachSection([&](const BiquadCoefficients& section)
+    {
+        CoefficientEngine::multiplyPowerResponse(section, cos1.data(), cos2.data(), power.data(), numBins);
+    });
+
+    // Zero phase spectrum: real and symmetric, so its inverse transform is real and even around sample 0
+    juce::dsp::FFT fft(juce::roundToInt(std::log2(size)));
+    std::vector<float> data((size_t) size * 2, 0.0f);
+    auto magnitudeSum = 0.0;
+
+    for (int bin = 0; bin < size; ++bin)
+    {
+        // rounding can leave a hair below zero right at DC / Nyquist where a cut has its zeros
+        auto magnitude = std::sqrt(juce::jmax(0.0, power[(size_t) juce::jmin(bin, size - bin)]));
+        data[(size_t) bin * 2] = (float) magnitude;
+        magnitudeSum += magnitude;
+    }
+
+    fft.performRealOnlyInverseTransform(data.data());
+
+    // sample 0 of the impulse is the mean of the spectrum, scale to that rather than rely on the FFT's normalisation
+    auto expectedCentre = magnitudeSum / size;
+    auto scale = std::abs(data[0]) > 0.0f ? expectedCentre / data[0] : 0.0;
+
+    // Rotate by half the length so the impulse is centred (that's the latency) and taper the ends.
+    // A periodic Blackman window is zero at sample 0, which leaves the kernel exactly symmetric around size / 2
+    kernel.setSize(1, size);
+    auto* dest = kernel.getWritePointer(0);
+
+    for (int i = 0; i < size; ++i)
+    {
+        auto phase = juce::MathConstants<double>::twoPi * i / size;
+        auto window = 0.42 - 0.5 * std::cos(phase) + 0.08 * std::cos(2.0 * phase);
+
+        dest[i] = (float) (data[(size_t) ((i + size / 2) % size)] * scale * window);
+    }
+}
@@ -0,0 +1,171 @@
+/*
+  ==============================================================================
+
+    LinearPhaseEngine.h
+    Linear phase version of the LowCut -> Peak -> HighCut chain, run as a FIR.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ChainSettings.h"
+#include "CoefficientEngine.h"
+#include <functional>
+#include <memory>
+#include <vector>
+
+/* The kernel has the same magnitude response as the IIR cascade and zero phase, delayed by half its length
+    so it's causal. It's designed by sampling |H| on the FFT grid, inverse transforming, centring and windowing.
+
+    The convolution itself is juce::dsp::Convolution in non-uniform partitioned mode (a short head partition
+    for zero extra latency, longer tail partitions for efficiency). Loading a kernel into it builds the new
+    engine on the shared message queue's background thread and crossfades from the old one, so parameter
+    changes never glitch or block the audio thread.
+
+    Our own thread polls the settings and designs a new kernel when they change. Designing and FFTing the
+    kernel happens there too, the audio thread only ever calls process().
+
+    None of it exists while the mode is off: no convolvers, no kernel and neither thread. setEnabled() builds it
+    all when the mode is switched on and frees it again when it's switched off, so sessions with lots of instances
+    only pay for the ones that use it.
+
+    Latency is getKernelSize() / 2 samples. The IIR and FIR paths don't line up in time, so switching modes
+    while playing jumps by that amount
+ */
+class LinearPhaseEngine : private juce::Thread
+{
+public:
+    // Called from the design thread to read the current settings, must be safe off the message thread
+    using SettingsSource = std::function<ChainSettings()>;
+
+    explicit LinearPhaseEngine(SettingsSource settingsSource);
+    ~LinearPhaseEngine() override;
+
+    /* Kernel length in samples (rounded up to a power of two), 0 picks one from the sample rate.
+        Longer kernels resolve the low cuts better at the cost of latency and CPU. Takes effect on the next prepare()
+     */
+    void setKernelSize(int numSamples) noexcept { requestedKernelSize = juce::jmax(0, numSamples); }
+
+    /* Not real-time safe. Remembers spec for setEnabled(), and if shouldBeEnabled builds the convolvers and designs
+        the first kernel synchronously so process() is correct from the first block. Preparing again with the same spec
+        and settings (a transport restart) keeps the convolvers and their kernel and only clears their history
+     */
+    void prepare(const juce::dsp::ProcessSpec& spec, bool shouldBeEnabled);
+    void release();
+
+    /* Message thread, never the audio thread. Switching on builds everything for the last prepare() (if there was
+        one) and starts the design thread, switching off stops it and frees the convolvers once the audio thread is
+        done with them
+     */
+    void setEnabled(bool shouldBeEnabled);
+
+    // Whether process() has a kernel to run. Until then the processor keeps running the IIR chain
+    bool isReady() const noexcept { return ready.load(); }
+
+    // Clears the convolution history, the kernel stays. Doesn't allocate
+    void reset() noexcept;
+
+    int getKernelSize() const noexcept { return kernelSize; }
+    int getLatencySamples() const noexcept { return kernelSize / 2; }
+
+    // Audio thread. Leaves the block alone if the engine got switched off since isReady()
+    template <typename SampleType>
+    void process(juce::dsp::AudioBlock<SampleType>& block) noexcept
+    {
+        // setEnabled(false) doesn't free anything while this is set
+        inUse = true;
+
+        if (ready)
+            processReady(block);
+
+        inUse = false;
+    }
+
+    /* Not real-time safe. Builds the kernel for these settings into kernel (1 channel, size samples).
+        Public so the host can look at / time the design on its own
+     */
+    static void designKernel(const ChainSettings& settings, double sampleRate, int size, juce::AudioBuffer<float>& kernel);
+
+private:
+    // Double blocks are converted through a float buffer, juce::dsp::Convolution is float only
+    template <typename SampleType>
+    void processReady(juce::dsp::AudioBlock<SampleType>& block) noexcept
+    {
+        if constexpr (std::is_same_v<SampleType, float>)
+        {
+            processFloat(block);
+        }
+        else
+        {
+            auto numChannels = juce::jmin(block.getNumChannels(), (size_t) scratch.getNumChannels());
+            auto maxLength = (size_t) scratch.getNumSamples();
+
+            for (size_t start = 0; start < block.getNumSamples(); start += maxLength)
+            {
+                auto length = juce::jmin(block.getNumSamples() - start, maxLength);
+
+                for (size_t channel = 0; channel < numChannels; ++channel)
+                {
+                    auto* source = block.getChannelPointer(channel) + start;
+                    auto* dest = scratch.getWritePointer((int) channel);
+
+                    for (size_t i = 0; i < length; ++i)
+                        dest[i] = (float) source[i];
+                }
+
+                juce::dsp::AudioBlock<float> floatBlock(scratch.getArrayOfWritePointers(), numChannels, length);
+                processFloat(floatBlock);
+
+                for (size_t channel = 0; channel < numChannels; ++channel)
+                {
+                    auto* source = scratch.getReadPointer((int) channel);
+                    auto* dest = block.getChannelPointer(channel) + start;
+
+                    for (size_t i = 0; i < length; ++i)
+                        dest[i] = (SampleType) source[i];
+                }
+            }
+        }
+    }
+
+    void processFloat(juce::dsp::AudioBlock<float>& block) noexcept;
+
+    void run() override;
+    void loadKernel(const ChainSettings& settings);
+
+    // (re)builds the convolvers for preparedSpec unless they already fit, and starts the design thread
+    void build();
+
+    // stops the design thread and frees everything build() made
+    void discard();
+
+    SettingsSource getSettings;
+
+    std::atomic<int> requestedKernelSize { 0 };
+    int kernelSize { 0 };
+    double sampleRate { 44100.0 };
+
+    // message thread
+    juce::dsp::ProcessSpec preparedSpec {};
+    bool enabled { false };
+
+    /* The convolvers are there to use while ready is set. The audio thread sets inUse around process(), and discard()
+        clears ready and then waits for inUse to clear before it frees anything (both seq_cst, so one of the two always
+        sees the other's store)
+     */
+    std::atomic<bool> ready { false }, inUse { false };
+
+    // juce::dsp::Convolution handles one or two channels, wider buses get one per pair of channels. The queue has a
+    // thread of its own, so it only exists while the engine does
+    std::unique_ptr<juce::dsp::ConvolutionMessageQueue> messageQueue;
+    std::vector<std::unique_ptr<juce::dsp::Convolution>> convolvers;
+
+    // design thread only
+    ChainSettings designedSettings;
+
+    juce::AudioBuffer<float> scratch;
+
+    JUCE_DECLARE_NON_COPYABLE (LinearPhaseEngine)
+};
@@ -0,0 +1,111 @@
+/*
+  ==============================================================================
+
+    ParameterState.cpp
+    Compact binary snapshot of every APVTS parameter, for get/setStateInformation.
+
+  ==============================================================================
+*/
+
+#include "ParameterState.h"
+
+namespace
+{
+    constexpr int headerSize = 4 + 2 + 2;
+    constexpr int entrySize = 8 + 4;
+}
+
+ParameterState::ParameterState(juce::AudioProcessor& processor)
+{
+    for (auto* parameter : processor.getParameters())
+        if (auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(parameter))
+            entries.push_back({ hashParameterID(ranged->paramID), ranged, (int) entries.size() });
+
+    sortedEntries = entries;
+    std::sort(sortedEntries.begin(), sortedEntries.end(), [](const Entry& a, const Entry& b) { return a.hash < b.hash; });
+
+    // two IDs hashing the same would make one of them unrecallable
+    jassert(std::adjacent_find(sortedEntries.begin(), sortedEntries.end(),
+                               [](const Entry& a, const Entry& b) { return a.hash == b.hash; }) == sortedEntries.end());
+}
+
+size_t ParameterState::getSizeInBytes() const noexcept
+{
+    return (size_t) headerSize + (size_t) entrySize * entries.size();
+}
+
+void ParameterState::write(juce::MemoryBlock& destData) const
+{
+    juce::MemoryOutputStream stream(destData, true);
+    stream.preallocate(destData.getSize() + getSizeInBytes());
+
+    stream.writeInt((int) magic);
+    stream.writeShort((short) formatVersion);
+    stream.writeShort((short) entries.size());
+
+    for (auto& entry : entries)
+    {
+        stream.writeInt64(entry.hash);
+        stream.writeFloat(entry.parameter->convertFrom0to1(entry.parameter->getValue()));
+    }
+}
+
+juce::Result ParameterState::read(const void* data, int sizeInBytes) const
+{
+    if (data == nullptr || sizeInBytes < headerSize)
+        return juce::Result::fail("State is too short");
+
+    juce::MemoryInputStream stream(data, (size_t) sizeInBytes, false);
+
+    if ((juce::uint32) stream.readInt() != magic)
+        return juce::Result::fail("Not a SimpleEQ state");
+
+    auto version = (int) (juce::uint16) stream.readShort();
+    auto count = (int) (juce::uint16) stream.readShort();
+
+    if (version > formatVersion)
+        return juce::Result::fail("State is from a newer version (format " + juce::String(version) + ")");
+
+    if (version < 1)
+        return juce::Result::fail("Unknown state format " + juce::String(version));
+
+    if (sizeInBytes < headerSize + count * entrySize)
+        return juce::Result::fail("State is truncated");
+
+    // everything checks out, from here on the state gets applied. Parameters the state doesn't mention go to default
+    std::vector<bool> restored(entries.size(), false);
+
+    for (int i = 0; i < count; ++i)
+    {
+        auto hash = stream.readInt64();
+        auto value = stream.readFloat();
+
+        auto index = find(hash, i);
+
+        if (index < 0 || ! std::isfinite(value))
+            continue;
+
+        // convertTo0to1 clamps to the range, so a state from a version with wider ranges still lands somewhere valid
+        auto* parameter = entries[(size_t) index].parameter;
+        parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+        restored[(size_t) index] = true;
+    }
+
+    for (size_t i = 0; i < entries.size(); ++i)
+        if (! restored[i])
+            entries[i].parameter->setValueNotifyingHost(entries[i].parameter->getDefaultValue());
+
+    return juce::Result::ok();
+}
+
+int ParameterState::find(juce::int64 hash, int expectedIndex) const noexcept
+{
+    // our own states line up with entries, so this is the usual case
+    if (juce::isPositiveAndBelow(expectedIndex, (int) entries.size()) && entries[(size_t) expectedIndex].hash == hash)
+        return expectedIndex;
+
+    auto found = std::lower_bound(sortedEntries.begin(), sortedEntries.end(), hash,
+                                  [](const Entry& entry, juce::int64 h) { return entry.hash < h; });
+
+    return found != sortedEntries.end() && found->hash == hash ? found->index : -1;
+}
@@ -0,0 +1,70 @@
+/*
+  ==============================================================================
+
+    ParameterState.h
+    Compact binary snapshot of every APVTS parameter, for get/setStateInformation.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+
+/* Instead of apvts.copyState() -> XML -> text -> binary (and the parse back), the state is written directly:
+
+        uint32  magic      'SEQS'
+        uint16  version    formatVersion
+        uint16  count
+        count x { int64 id hash, float value }      little endian, value is the real (not normalised) value
+
+    That's 12 bytes a parameter plus the 8 byte header, ~4 kB for the ~335 parameters of both paths
+    (getSizeInBytes() has the exact figure).
+
+    Parameters are matched by a 64-bit hash of their ID rather than by position, so states survive parameters being
+    added, removed or reordered: unknown entries are skipped, parameters missing from the state go back to their
+    default. Entries are written in the same order the processor holds them, so reading the state we wrote ourselves
+    finds each one at its own index without a lookup.
+
+    Restoring writes values with setValueNotifyingHost(), on whatever thread the host calls from - the same call the
+    APVTS ends up making in replaceState(). Nothing here touches the filters - the processor decides when the audio
+    thread picks the new values up
+ */
+class ParameterState
+{
+public:
+    static constexpr juce::uint32 magic = 0x53514553; // "SEQS" in the file
+    static constexpr int formatVersion = 1;
+
+    explicit ParameterState(juce::AudioProcessor& processor);
+
+    // What write() appends: the header and one entry per parameter
+    size_t getSizeInBytes() const noexcept;
+
+    // Appends the current values to destData
+    void write(juce::MemoryBlock& destData) const;
+
+    /* Applies a state written by write(). Fails without changing anything if the data isn't one of ours, has a format
+        version we never wrote (0, or newer than ours), or is truncated
+     */
+    juce::Result read(const void* data, int sizeInBytes) const;
+
+    static juce::int64 hashParameterID(const juce::String& parameterID) noexcept { return parameterID.hashCode64(); }
+
+private:
+    struct Entry
+    {
+        juce::int64 hash;
+        juce::RangedAudioParameter* parameter;
+        int index;
+    };
+
+    // index into entries, or -1 for a parameter we don't have
+    int find(juce::int64 hash, int expectedIndex) const noexcept;
+
+    // in processor order, and sorted by hash for the fallback search
+    std::vector<Entry> entries, sortedEntries;
+
+    JUCE_DECLARE_NON_COPYABLE (ParameterState)
+};
@@ -0,0 +1,236 @@
+/*
+  ==============================================================================
+
+    PerformanceCounters.cpp
+    Cycle counts for processBlock and each stage of the chain, kept in
+    lock-free histograms that any thread can read.
+
+  ==============================================================================
+*/
+
+#include "PerformanceCounters.h"
+#include "CoefficientCache.h"
+
+#if JUCE_INTEL
+ #if JUCE_MSVC
+  #include <intrin.h>
+ #else
+  #include <x86intrin.h>
+ #endif
+#endif
+
+const char* PerformanceCounters::getName(int counter) noexcept
+{
+    switch (counter)
+    {
+        case ProcessBlock:  return "ProcessBlock";
+        case UpdateFilters: return "UpdateFilters";
+        case LowCut:        return "LowCut";
+        case Peak:          return "Peak";
+        case HighCut:       return "HighCut";
+        case Bands:         return "Bands";
+        case Oversampling:  return "Oversampling";
+        case LinearPhase:   return "LinearPhase";
+        case Dynamics:      return "Dynamics";
+        default:            break;
+    }
+
+    return "";
+}
+
+juce::uint64 PerformanceCounters::readCycleCounter() noexcept
+{
+   #if JUCE_INTEL
+    return (juce::uint64) __rdtsc();
+   #else
+    // no portable cycle counter, so scale the clock by the nominal CPU speed
+    static const auto cyclesPerTick = juce::SystemStats::getCpuSpeedInMegahertz() * 1.0e6
+                                        / (double) juce::Time::getHighResolutionTicksPerSecond();
+    return (juce::uint64) ((double) juce::Time::getHighResolutionTicks() * cyclesPerTick);
+   #endif
+}
+
+//==============================================================================
+int PerformanceCounters::getBucket(juce::uint64 cycles) noexcept
+{
+    if (cycles < (1u << subBucketBits))
+        return (int) cycles;
+
+    auto msb = 0;
+
+    for (auto v = cycles; v > 1; v >>= 1)
+        ++msb;
+
+    auto sub = (int) (cycles >> (msb - subBucketBits)) & ((1 << subBucketBits) - 1);
+
+    return (msb << subBucketBits) | sub;
+}
+
+double PerformanceCounters::getBucketStart(int bucket) noexcept
+{
+    auto msb = bucket >> subBucketBits;
+
+    if (msb < subBucketBits)
+        return (double) bucket;
+
+    auto sub = bucket & ((1 << subBucketBits) - 1);
+    return std::ldexp((double) ((1 << subBucketBits) + sub), msb - subBucketBits);
+}
+
+void PerformanceCounters::commitBlock(int numSamples) noexcept
+{
+    for (size_t i = 0; i < histograms.size(); ++i)
+    {
+        if (! touched[i])
+            continue;
+
+        auto cycles = pending[i];
+        auto& histogram = histograms[i];
+
+        // single writer, so plain load + store is enough and stays off the bus lock
+        auto& bucket = histogram.buckets[(size_t) getBucket(cycles)];
+        bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+        histogram.numBlocks.store(histogram.numBlocks.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        histogram.totalCycles.store(histogram.totalCycles.load(std::memory_order_relaxed) + cycles, std::memory_order_relaxed);
+        histogram.totalSamples.store(histogram.totalSamples.load(std::memory_order_relaxed) + (juce::uint64) numSamples, std::memory_order_relaxed);
+
+        if (cycles > histogram.maxCycles.load(std::memory_order_relaxed))
+            histogram.maxCycles.store(cycles, std::memory_order_relaxed);
+
+        pending[i] = 0;
+        touched[i] = false;
+    }
+}
+
+void PerformanceCounters::reset() noexcept
+{
+    for (auto& histogram : histograms)
+    {
+        for (auto& bucket : histogram.buckets)
+            bucket.store(0, std::memory_order_relaxed);
+
+        histogram.numBlocks.store(0, std::memory_order_relaxed);
+        histogram.totalCycles.store(0, std::memory_order_relaxed);
+        histogram.totalSamples.store(0, std::memory_order_relaxed);
+        histogram.maxCycles.store(0, std::memory_order_relaxed);
+    }
+}
+
+//==============================================================================
+PerformanceCounters::Summary PerformanceCounters::getSummary(int counter) const noexcept
+{
+    auto& histogram = histograms[(size_t) counter];
+    Summary summary;
+
+    std::array<juce::uint32, numBuckets> counts;
+    juce::int64 total = 0;
+
+    for (size_t i = 0; i < counts.size(); ++i)
+        total += (counts[i] = histogram.buckets[i].load(std::memory_order_relaxed));
+
+    if (total == 0)
+        return summary;
+
+    auto totalCycles = (double) histogram.totalCycles.load(std::memory_order_relaxed);
+    auto totalSamples = (double) histogram.totalSamples.load(std::memory_order_relaxed);
+
+    summary.numBlocks = total;
+    summary.meanCycles = totalCycles / (double) total;
+    summary.cyclesPerSample = totalSamples > 0.0 ? totalCycles / totalSamples : 0.0;
+    summary.maxCycles = (double) histogram.maxCycles.load(std::memory_order_relaxed);
+
+    // percentile = middle of the first bucket whose running count reaches it
+    auto percentile = [&](double fraction)
+    {
+        auto target = (juce::int64) std::ceil(fraction * (double) total);
+        juce::int64 running = 0;
+
+        for (int bucket = 0; bucket < numBuckets; ++bucket)
+        {
+            running += counts[(size_t) bucket];
+
+            if (running >= target)
+                return 0.5 * (getBucketStart(bucket) + getBucketStart(bucket + 1));
+        }
+
+        return summary.maxCycles;
+    };
+
+    summary.p50Cycles = percentile(0.50);
+    summary.p90Cycles = percentile(0.90);
+    summary.p99Cycles = juce::jmin(percentile(0.99), summary.maxCycles);
+
+    return summary;
+}
+
+juce::var PerformanceCounters::toVar() const
+{
+    auto* object = new juce::DynamicObject();
+
+    for (int counter = 0; counter < numCounters; ++counter)
+    {
+        auto summary = getSummary(counter);
+
+        if (summary.numBlocks == 0)
+            continue;
+
+        auto* entry = new juce::DynamicObject();
+        entry->setProperty("blocks", summary.numBlocks);
+        entry->setProperty("cyclesPerSample", summary.cyclesPerSample);
+        entry->setProperty("meanCycles", summary.meanCycles);
+        entry->setProperty("p50Cycles", summary.p50Cycles);
+        entry->setProperty("p90Cycles", summary.p90Cycles);
+        entry->setProperty("p99Cycles", summary.p99Cycles);
+        entry->setProperty("maxCycles", summary.maxCycles);
+
+        object->setProperty(getName(counter), juce::var(entry));
+    }
+
+    // the shared design cache is process-wide, every instance reports the same numbers
+    auto cache = CoefficientCache::getInstance().getStats();
+
+    if (cache.hits + cache.misses > 0)
+    {
+        auto* entry = new juce::DynamicObject();
+        entry->setProperty("hits", cache.hits);
+        entry->setProperty("misses", cache.misses);
+        entry->setProperty("hitRate", cache.getHitRate());
+        entry->setProperty("entries", cache.entries);
+        entry->setProperty("inUse", cache.inUse);
+        entry->setProperty("evictions", cache.evictions);
+        entry->setProperty("unshared", cache.unshared);
+        entry->setProperty("memoryBytes", (juce::int64) cache.memoryBytes);
+
+        object->setProperty("CoefficientCache", juce::var(entry));
+    }
+
+    return juce::var(object);
+}
+
+juce::String PerformanceCounters::toString() const
+{
+    juce::String s;
+
+    for (int counter = 0; counter < numCounters; ++counter)
+    {
+        auto summary = getSummary(counter);
+
+        if (summary.numBlocks == 0)
+            continue;
+
+        s << juce::String(getName(counter)).paddedRight(' ', 15)
+          << juce::String(summary.cyclesPerSample, 2) << " cycles/sample, p50 " << juce::String(summary.p50Cycles, 0)
+          << "  p99 " << juce::String(summary.p99Cycles, 0) << "  max " << juce::String(summary.maxCycles, 0) << juce::newLine;
+    }
+
+    auto cache = CoefficientCache::getInstance().getStats();
+
+    if (cache.hits + cache.misses > 0)
+        s << juce::String("Shared designs").paddedRight(' ', 15)
+          << juce::String(cache.getHitRate() * 100.0, 1) << "% hits (" << juce::String(cache.hits) << " / "
+          << juce::String(cache.hits + cache.misses) << "), " << juce::String(cache.entries) << " entries ("
+          << juce::String(cache.inUse) << " in use), " << juce::String(cache.evictions) << " evicted" << juce::newLine;
+
+    return s;
+}
@@ -0,0 +1,138 @@
+/*
+  ==============================================================================
+
+    PerformanceCounters.h
+    Cycle counts for processBlock and each stage of the chain, kept in
+    lock-free histograms that any thread can read.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+
+/* Build with SIMPLEEQ_INSTRUMENTATION=1 to compile the counters in. Without it every measurement sits behind
+    `if constexpr (PerformanceCounters::enabled)` and compiles to nothing, not even the cycle counter reads.
+
+    Audio thread side: the processor adds up cycles per counter over a block with add(), then commitBlock() drops
+    each total into that counter's histogram. Each histogram has exactly one writer (the audio thread), so the updates
+    are relaxed loads and stores, no locked read-modify-writes and nothing a reader can block.
+
+    Reader side (message thread, host): getSummary() / toVar() copy the buckets out. A summary taken while the audio
+    thread is writing can be a block out between its fields, which doesn't matter for statistics
+ */
+#ifndef SIMPLEEQ_INSTRUMENTATION
+ #define SIMPLEEQ_INSTRUMENTATION 0
+#endif
+
+class PerformanceCounters
+{
+public:
+    static constexpr bool enabled = SIMPLEEQ_INSTRUMENTATION != 0;
+
+    enum Counter
+    {
+        ProcessBlock,   // the whole of processBlock
+        UpdateFilters,  // dirty flag pickup, coefficient design and smoothing redesigns
+        LowCut,
+        Peak,
+        HighCut,
+        Bands,
+        Oversampling,   // up + down sampling, not the chain in between
+        LinearPhase,    // the FIR convolution
+        Dynamics,       // the dynamic bands' detectors and their gain-only coefficient updates
+        numCounters
+    };
+
+    static const char* getName(int counter) noexcept;
+
+    // Serial cycle counter where the CPU has one, otherwise derived from the high resolution clock
+    static juce::uint64 readCycleCounter() noexcept;
+
+    //==============================================================================
+    // Audio thread: adds to this block's total for a counter
+    void add(int counter, juce::uint64 cycles) noexcept
+    {
+        pending[(size_t) counter] += cycles;
+        touched[(size_t) counter] = true;
+    }
+
+    // Audio thread: records every counter that was used this block, numSamples is the host block length
+    void commitBlock(int numSamples) noexcept;
+
+    // Any thread. Counts can straddle a reset that races with the audio thread, nothing worse
+    void reset() noexcept;
+
+    //==============================================================================
+    struct Summary
+    {
+        juce::int64 numBlocks { 0 };
+        double cyclesPerSample { 0.0 };     // total cycles / total samples
+        double meanCycles { 0.0 };          // per block
+        double p50Cycles { 0.0 }, p90Cycles { 0.0 }, p99Cycles { 0.0 };
+        double maxCycles { 0.0 };
+    };
+
+    // Any thread. Percentiles come from the histogram so they're good to a quarter octave
+    Summary getSummary(int counter) const noexcept;
+
+    /* { "ProcessBlock": { "blocks": ..., "cyclesPerSample": ..., "p50": ... }, ... } for every counter that was used,
+        plus "CoefficientCache": { "hits", "misses", "hitRate", ... } for the process-wide shared designs
+     */
+    juce::var toVar() const;
+
+    // one line per counter, for the editor and the host's text output
+    juce::String toString() const;
+
+private:
+    /* Log2 histogram with four sub-buckets per octave: bucket = 4 * msb + the next two bits down.
+        64-bit cycle counts fit in 256 buckets
+     */
+    static constexpr int subBucketBits = 2;
+    static constexpr int numBuckets = 64 << subBucketBits;
+
+    static int getBucket(juce::uint64 cycles) noexcept;
+    static double getBucketStart(int bucket) noexcept;
+
+    struct Histogram
+    {
+        std::array<std::atomic<juce::uint32>, numBuckets> buckets {};
+        std::atomic<juce::int64> numBlocks { 0 };
+        std::atomic<juce::uint64> totalCycles { 0 }, totalSamples { 0 }, maxCycles { 0 };
+    };
+
+    std::array<Histogram, numCounters> histograms;
+
+    // audio thread only
+    std::array<juce::uint64, numCounters> pending {};
+    std::array<bool, numCounters> touched {};
+};
+
+//==============================================================================
+// Adds the cycles from construction to destruction to a counter. Nothing at all when instrumentation is off
+class ScopedCycleCount
+{
+public:
+    ScopedCycleCount(PerformanceCounters& countersToUse, int counterToUse) noexcept
+        : counters(countersToUse), counter(counterToUse)
+    {
+        if constexpr (PerformanceCounters::enabled)
+            start = PerformanceCounters::readCycleCounter();
+    }
+
+    ~ScopedCycleCount() noexcept
+    {
+        if constexpr (PerformanceCounters::enabled)
+            counters.add(counter, PerformanceCounters::readCycleCounter() - start);
+    }
+
+private:
+    PerformanceCounters& counters;
+    int counter;
+    juce::uint64 start { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE (ScopedCycleCount)
+};
@@ -13,13 +13,101 @@
 SimpleEQAudioProcessorEditor::SimpleEQAudioProcessorEditor (SimpleEQAudioProcessor& p)
     : AudioProcessorEditor (&p), audioProcessor (p)
 {
+    for (size_t i = 0; i < controls.size(); ++i)
+    {
+        auto& control = controls[i];
+
+        control.label.setText (CoefficientEngine::parameterIDs[i], juce::dontSendNotification);
+        control.label.setJustificationType (juce::Justification::centred);
+        control.label.attachToComponent (&control.slider, false);
+
+        addAndMakeVisible (control.slider);
+    }
+
+    addAndMakeVisible (linearPhaseButton);
+
+    if (auto* oversampling = dynamic_cast<juce::AudioParameterChoice*> (audioProcessor.apvts.getParameter ("Oversampling")))
+        oversamplingBox.addItemList (oversampling->choices, 1);
+
+    oversamplingBox.setTooltip ("Oversampling");
+    oversamplingAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment> (audioProcessor.apvts, "Oversampling", oversamplingBox);
+    addAndMakeVisible (oversamplingBox);
+
+    if (auto* stereoMode = dynamic_cast<juce::AudioParameterChoice*> (audioProcessor.apvts.getParameter ("Stereo Mode")))
+        stereoModeBox.addItemList (stereoMode->choices, 1);
+
+    stereoModeBox.setTooltip ("Stereo Mode");
+    stereoModeAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment> (audioProcessor.apvts, "Stereo Mode", stereoModeBox);
+    addAndMakeVisible (stereoModeBox);
+
+    pathSelector.addItemList (juce::StringArray { "Left / Mid", "Right / Side" }, 1);
+    pathSelector.setTooltip ("Which channel's filters the controls edit");
+    pathSelector.onChange = [this] { selectPath (pathSelector.getSelectedItemIndex()); };
+    addAndMakeVisible (pathSelector);
+
+    for (int band = 0; band < ChainSettings::maxBands; ++band)
+        bandSelector.addItem ("Band " + juce::String (band + 1), band + 1);
+
+    if (auto* bandType = dynamic_cast<juce::AudioParameterChoice*> (audioProcessor.apvts.getParameter (CoefficientEngine::getBandParameterID (0, "Type"))))
+        bandTypeBox.addItemList (bandType->choices, 1);
+
+    bandSelector.onChange = [this] { selectBand (bandSelector.getSelectedItemIndex()); };
+
+    for (auto& slider : bandSliders)
+    {
+        slider.setSliderStyle (juce::Slider::LinearHorizontal);
+        slider.setTextBoxStyle (juce::Slider::TextBoxLeft, false, 70, 20);
+        addAndMakeVisible (slider);
+    }
+
+    addAndMakeVisible (bandSelector);
+    addAndMakeVisible (bandOnButton);
+    addAndMakeVisible (bandTypeBox);
+
+    bandSelector.setSelectedItemIndex (0, juce::dontSendNotification);
+    pathSelector.setSelectedItemIndex (0, juce::sendNotificationSync);
+
+    dynamicSelector.addItem ("Peak", 1);
+
+    for (int band = 0; band < ChainSettings::maxBands; ++band)
+        dynamicSelector.addItem ("Band " + juce::String (band + 1), band + 2);
+
+    dynamicSelector.onChange = [this] { selectDynamicStage (dynamicSelector.getSelectedItemIndex()); };
+
+    const char* timeParameterIDs[] { "Dynamic Attack", "Dynamic Release" };
+
+    for (size_t i = 0; i < dynamicSliders.size(); ++i)
+    {
+        for (auto* slider : { &dynamicSliders[i], &dynamicTimeSliders[i] })
+        {
+            slider->setSliderStyle (juce::Slider::LinearHorizontal);
+            slider->setTextBoxStyle (juce::Slider::TextBoxLeft, false, 56, 20);
+            addAndMakeVisible (*slider);
+        }
+
+        dynamicTimeSliders[i].setTooltip (timeParameterIDs[i]);
+        dynamicTimeAttachments[i] = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment> (audioProcessor.apvts, timeParameterIDs[i], dynamicTimeSliders[i]);
+    }
+
+    addAndMakeVisible (dynamicSelector);
+    addAndMakeVisible (dynamicButton);
+    addAndMakeVisible (sidechainButton);
+
+    dynamicSelector.setSelectedItemIndex (0, juce::sendNotificationSync);
+
+    // The analyzer thread only runs (and the audio thread only feeds it) while an editor is open
+    audioProcessor.getAnalyzer().setActive (true);
+    startTimerHz (frameRateHz);
+
     // Make sure that before the constructor has finished, you've set the
     // editor's size to whatever you need it to be.
-    setSize (400, 300);
+    setSize (700, 548);
 }
 
 SimpleEQAudioProcessorEditor::~SimpleEQAudioProcessorEditor()
 {
+    stopTimer();
+    audioProcessor.getAnalyzer().setActive (false);
 }
 
 //==============================================================================
@@ -28,13 +116,295 @@ void SimpleEQAudioProcessorEditor::paint (juce::Graphics& g)
     // (Our component is opaque, so we must completely fill the background with a solid colour)
     g.fillAll (getLookAndFeel().findColour (juce::ResizableWindow::backgroundColourId));
 
+    g.setColour (juce::Colours::black);
+    g.fillRect (spectrumArea);
+
+    drawGrid (g);
+
+    // paths are already in spectrumArea's coordinates, just clip and shift
+    juce::Graphics::ScopedSaveState state (g);
+    g.reduceClipRegion (spectrumArea);
+    g.addTransform (juce::AffineTransform::translation (spectrumArea.toFloat().getTopLeft()));
+
+    g.setColour (juce::Colours::grey.withAlpha (0.6f));
+    g.strokePath (traces[SpectrumAnalyzer::PreEQ].path, juce::PathStrokeType (1.0f));
+
+    g.setColour (juce::Colours::skyblue);
+    g.strokePath (traces[SpectrumAnalyzer::PostEQ].path, juce::PathStrokeType (1.5f));
+
     g.setColour (juce::Colours::white);
-    g.setFont (15.0f);
-    g.drawFittedText ("Hello World!", getLocalBounds(), juce::Justification::centred, 1);
+    g.strokePath (responsePath, juce::PathStrokeType (2.0f));
+
+    if (performanceText.isNotEmpty())
+    {
+        g.setColour (juce::Colours::white.withAlpha (0.7f));
+        g.setFont (juce::Font (juce::Font::getDefaultMonospacedFontName(), 11.0f, juce::Font::plain));
+        g.drawMultiLineText (performanceText, 6, 14, spectrumArea.getWidth() - 12);
+    }
 }
 
 void SimpleEQAudioProcessorEditor::resized()
 {
     // This is generally where you'll want to lay out the positions of any
     // subcomponents in your editor..
+    auto bounds = getLocalBounds().reduced (8);
+
+    spectrumArea = bounds.removeFromTop (bounds.getHeight() * 3 / 5);
+    auto optionsRow = bounds.removeFromBottom (24);
+    linearPhaseButton.setBounds (optionsRow.removeFromRight (140));
+    oversamplingBox.setBounds (optionsRow.removeFromRight (80));
+    stereoModeBox.setBounds (optionsRow.removeFromLeft (100));
+    pathSelector.setBounds (optionsRow.removeFromLeft (110));
+
+    auto bandRow = bounds.removeFromBottom (28).reduced (0, 2);
+    bandSelector.setBounds (bandRow.removeFromLeft (90));
+    bandOnButton.setBounds (bandRow.removeFromLeft (50));
+    bandTypeBox.setBounds (bandRow.removeFromLeft (100));
+
+    auto bandSliderWidth = bandRow.getWidth() / (int) bandSliders.size();
+
+    for (auto& slider : bandSliders)
+        slider.setBounds (bandRow.removeFromLeft (bandSliderWidth));
+
+    auto dynamicRow = bounds.removeFromBottom (28).reduced (0, 2);
+    dynamicSelector.setBounds (dynamicRow.removeFromLeft (90));
+    dynamicButton.setBounds (dynamicRow.removeFromLeft (80));
+    sidechainButton.setBounds (dynamicRow.removeFromRight (90));
+
+    auto dynamicSliderWidth = dynamicRow.getWidth() / (int) (dynamicSliders.size() + dynamicTimeSliders.size());
+
+    for (auto& slider : dynamicSliders)
+        slider.setBounds (dynamicRow.removeFromLeft (dynamicSliderWidth));
+
+    for (auto& slider : dynamicTimeSliders)
+        slider.setBounds (dynamicRow.removeFromLeft (dynamicSliderWidth));
+
+    bounds.removeFromTop (24); // room for the labels sitting above the sliders
+
+    auto width = bounds.getWidth() / (int) controls.size();
+
+    for (auto& control : controls)
+        control.slider.setBounds (bounds.removeFromLeft (width));
+
+    for (int tap = 0; tap < SpectrumAnalyzer::numTaps; ++tap)
+        rebuildSpectrumPath (tap);
+
+    rebuildResponsePath();
+}
+
+//==============================================================================
+void SimpleEQAudioProcessorEditor::timerCallback()
+{
+    auto& analyzer = audioProcessor.getAnalyzer();
+    auto changed = updateResponseCurve();
+
+    for (int tap = 0; tap < SpectrumAnalyzer::numTaps; ++tap)
+    {
+        auto& trace = traces[(size_t) tap];
+
+        if (analyzer.getSpectrum ((SpectrumAnalyzer::Tap) tap, trace.magnitudes, trace.version))
+        {
+            rebuildSpectrumPath (tap);
+            changed = true;
+        }
+    }
+
+    if constexpr (PerformanceCounters::enabled)
+    {
+        if (++framesSincePerformanceUpdate >= frameRateHz)
+        {
+            framesSincePerformanceUpdate = 0;
+            performanceText = audioProcessor.getPerformanceCounters().toString();
+            changed = true;
+        }
+    }
+
+    // nothing new from the analyzer (playback stopped, or it's between hops) - nothing to repaint
+    if (changed)
+        repaint (spectrumArea);
+}
+
+void SimpleEQAudioProcessorEditor::rebuildSpectrumPath (int tap)
+{
+    auto& trace = traces[(size_t) tap];
+    trace.path.clear();
+
+    auto sampleRate = audioProcessor.getAnalyzer().getSampleRate();
+
+    if (trace.magnitudes.empty() || sampleRate <= 0.0 || spectrumArea.isEmpty())
+        return;
+
+    auto binWidth = (float) (sampleRate / SpectrumAnalyzer::fftSize);
+    auto bottom = (float) spectrumArea.getHeight();
+    auto started = false;
+
+    for (size_t bin = 1; bin < trace.magnitudes.size(); ++bin)
+    {
+        auto frequency = (float) bin * binWidth;
+
+        if (frequency < minFrequency)
+            continue;
+
+        if (frequency > maxFrequency)
+            break;
+
+        auto x = frequencyToX (frequency);
+        auto y = juce::jmin (bottom, decibelsToY (trace.magnitudes[bin]));
+
+        if (started)
+        {
+            trace.path.lineTo (x, y);
+        }
+        else
+        {
+            trace.path.startNewSubPath (x, y);
+            started = true;
+        }
+    }
+}
+
+bool SimpleEQAudioProcessorEditor::updateResponseCurve()
+{
+    auto& responseCurve = audioProcessor.getResponseCurve();
+
+    // a handful of atomic loads through the processor's cached handles and a compare,
+    // the curve itself is only recomputed when something moved
+    // oversampled designs are drawn at the rate they run at, that's where their top end differs
+    auto sampleRate = audioProcessor.getSampleRate() > 0.0 ? audioProcessor.getDesignSampleRate() : 44100.0;
+    responseCurve.update (getChainSettings (audioProcessor.getParameterHandles (editedPath)), sampleRate);
+
+    auto snapshot = responseCurve.getMagnitudes();
+
+    if (snapshot == responseSnapshot)
+        return false;
+
+    responseSnapshot = std::move (snapshot);
+    rebuildResponsePath();
+    return true;
+}
+
+void SimpleEQAudioProcessorEditor::rebuildResponsePath()
+{
+    responsePath.clear();
+
+    if (responseSnapshot == nullptr || spectrumArea.isEmpty())
+        return;
+
+    auto height = (float) spectrumArea.getHeight();
+
+    for (int i = 0; i < ResponseCurve::numPoints; ++i)
+    {
+        auto x = frequencyToX ((float) ResponseCurve::getFrequency (i));
+        auto y = juce::jmap (juce::jlimit (-responseRangeDecibels, responseRangeDecibels, responseSnapshot->decibels[(size_t) i]),
+                             -responseRangeDecibels, responseRangeDecibels, height, 0.0f);
+
+        if (i == 0)
+            responsePath.startNewSubPath (x, y);
+        else
+            responsePath.lineTo (x, y);
+    }
+}
+
+void SimpleEQAudioProcessorEditor::drawGrid (juce::Graphics& g) const
+{
+    auto area = spectrumArea.toFloat();
+
+    g.setColour (juce::Colours::dimgrey.withAlpha (0.5f));
+
+    for (auto frequency : { 50.0f, 100.0f, 200.0f, 500.0f, 1000.0f, 2000.0f, 5000.0f, 10000.0f })
+        g.drawVerticalLine ((int) (area.getX() + frequencyToX (frequency)), area.getY(), area.getBottom());
+
+    for (auto decibels = 0.0f; decibels > minDecibels; decibels -= 24.0f)
+        g.drawHorizontalLine ((int) (area.getY() + decibelsToY (decibels)), area.getX(), area.getRight());
+}
+
+void SimpleEQAudioProcessorEditor::selectBand (int band)
+{
+    if (! juce::isPositiveAndBelow (band, ChainSettings::maxBands))
+        return;
+
+    using APVTS = juce::AudioProcessorValueTreeState;
+    auto& apvts = audioProcessor.apvts;
+
+    // the old attachments have to let go of the controls before new ones take them over
+    bandOnAttachment.reset();
+    bandTypeAttachment.reset();
+
+    for (auto& attachment : bandSliderAttachments)
+        attachment.reset();
+
+    auto id = [this, band] (const char* field) { return CoefficientEngine::getPathParameterID (editedPath, CoefficientEngine::getBandParameterID (band, field)); };
+
+    bandOnAttachment = std::make_unique<APVTS::ButtonAttachment> (apvts, id ("On"), bandOnButton);
+    bandTypeAttachment = std::make_unique<APVTS::ComboBoxAttachment> (apvts, id ("Type"), bandTypeBox);
+
+    const char* sliderFields[] { "Freq", "Gain", "Quality" };
+
+    for (size_t i = 0; i < bandSliders.size(); ++i)
+    {
+        auto parameterID = id (sliderFields[i]);
+
+        bandSliders[i].setTooltip (parameterID);
+        bandSliderAttachments[i] = std::make_unique<APVTS::SliderAttachment> (apvts, parameterID, bandSliders[i]);
+    }
+}
+
+void SimpleEQAudioProcessorEditor::selectPath (int path)
+{
+    if (! juce::isPositiveAndBelow (path, CoefficientEngine::numPaths))
+        return;
+
+    editedPath = path;
+
+    for (size_t i = 0; i < controls.size(); ++i)
+    {
+        auto& control = controls[i];
+        auto parameterID = CoefficientEngine::getPathParameterID (path, CoefficientEngine::parameterIDs[i]);
+
+        control.attachment.reset();
+        control.slider.setTooltip (parameterID);
+        control.attachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment> (audioProcessor.apvts, parameterID, control.slider);
+    }
+
+    selectBand (bandSelector.getSelectedItemIndex());
+
+    // the curve follows the path being edited
+    updateResponseCurve();
+    repaint (spectrumArea);
+}
+
+void SimpleEQAudioProcessorEditor::selectDynamicStage (int slot)
+{
+    if (! juce::isPositiveAndBelow (slot, DynamicEQ::numSlots))
+        return;
+
+    using APVTS = juce::AudioProcessorValueTreeState;
+    auto& apvts = audioProcessor.apvts;
+
+    dynamicAttachment.reset();
+
+    for (auto& attachment : dynamicSliderAttachments)
+        attachment.reset();
+
+    dynamicAttachment = std::make_unique<APVTS::ButtonAttachment> (apvts, DynamicEQ::getSlotParameterID (slot, "Dynamic"), dynamicButton);
+
+    const char* sliderFields[] { "Threshold", "Ratio" };
+
+    for (size_t i = 0; i < dynamicSliders.size(); ++i)
+    {
+        auto parameterID = DynamicEQ::getSlotParameterID (slot, sliderFields[i]);
+
+        dynamicSliders[i].setTooltip (parameterID);
+        dynamicSliderAttachments[i] = std::make_unique<APVTS::SliderAttachment> (apvts, parameterID, dynamicSliders[i]);
+    }
+}
+
+float SimpleEQAudioProcessorEditor::frequencyToX (float frequency) const noexcept
+{
+    return juce::mapFromLog10 (frequency, minFrequency, maxFrequency) * (float) spectrumArea.getWidth();
+}
+
+float SimpleEQAudioProcessorEditor::decibelsToY (float decibels) const noexcept
+{
+    return juce::jmap (decibels, minDecibels, maxDecibels, (float) spectrumArea.getHeight(), 0.0f);
 }
@@ -12,9 +12,17 @@
 #include "PluginProcessor.h"
 
 //==============================================================================
-/**
+/* Spectrum display on top (pre EQ dimmed, post EQ bright) with the EQ's response curve over it,
+    one rotary per parameter underneath, a strip for whichever of the extra bands is picked in the band selector
+    and one for the dynamic mode of the stage picked in the dynamics selector. In dual mono / mid-side the path
+    selector points the rotaries, the band strip and the curve at the left / mid or the right / side filters.
+
+    The spectrum paths are only rebuilt when the analyzer has published something new, and the timer
+    that checks for that runs at frameRateHz - so an open editor costs the message thread at most
+    30 path rebuilds a second, and nothing at all on the audio thread beyond SpectrumAnalyzer::push()
 */
-class SimpleEQAudioProcessorEditor  : public juce::AudioProcessorEditor
+class SimpleEQAudioProcessorEditor  : public juce::AudioProcessorEditor,
+                                      private juce::Timer
 {
 public:
     SimpleEQAudioProcessorEditor (SimpleEQAudioProcessor&);
@@ -25,9 +33,108 @@ public:
     void resized() override;
 
 private:
+    static constexpr int frameRateHz = 30;
+
+    // what the spectrum area shows
+    static constexpr float minFrequency = 20.0f, maxFrequency = 20000.0f;
+    static constexpr float minDecibels = -96.0f, maxDecibels = 6.0f;
+
+    // the response curve gets its own scale, +-24 dB covers the peak gain range
+    static constexpr float responseRangeDecibels = 24.0f;
+
+    void timerCallback() override;
+
+    // Turns the last spectrum we copied out of the analyzer into a path in spectrumArea's coordinates
+    void rebuildSpectrumPath (int tap);
+
+    // Pulls the latest ResponseCurve snapshot and rebuilds the path if it changed
+    bool updateResponseCurve();
+    void rebuildResponsePath();
+
+    void drawGrid (juce::Graphics& g) const;
+
+    // Points the band strip's attachments at this band's parameters (0 based)
+    void selectBand (int band);
+
+    // Same for the dynamics strip, slot 0 is the Peak stage and 1 + n is Band n (see DynamicEQ)
+    void selectDynamicStage (int slot);
+
+    // Re-attaches the rotaries and the band strip to path's parameters (see CoefficientEngine::getPathParameterID)
+    void selectPath (int path);
+
+    float frequencyToX (float frequency) const noexcept;
+    float decibelsToY (float decibels) const noexcept;
+
     // This reference is provided as a quick way for your editor to
     // access the processor object that created it.
     SimpleEQAudioProcessor& audioProcessor;
 
+    struct SpectrumTrace
+    {
+        std::vector<float> magnitudes;
+        juce::uint32 version { 0 };
+        juce::Path path;
+    };
+
+    std::array<SpectrumTrace, SpectrumAnalyzer::numTaps> traces;
+    juce::Rectangle<int> spectrumArea;
+
+    ResponseCurve::Snapshot responseSnapshot;
+    juce::Path responsePath;
+
+    // instrumentation builds only: the counters' summary, refreshed once a second in the corner of the spectrum
+    juce::String performanceText;
+    int framesSincePerformanceUpdate { 0 };
+
+    // Same order as CoefficientEngine::parameterIDs
+    struct ParameterControl
+    {
+        juce::Slider slider { juce::Slider::RotaryHorizontalVerticalDrag, juce::Slider::TextBoxBelow };
+        juce::Label label;
+        std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> attachment;
+    };
+
+    std::array<ParameterControl, 7> controls;
+
+    juce::ToggleButton linearPhaseButton { "Linear Phase" };
+    juce::AudioProcessorValueTreeState::ButtonAttachment linearPhaseAttachment { audioProcessor.apvts, "Linear Phase", linearPhaseButton };
+
+    // items have to be in the box before the attachment is made, so this one's built in the constructor
+    juce::ComboBox oversamplingBox;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> oversamplingAttachment;
+
+    juce::ComboBox stereoModeBox;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> stereoModeAttachment;
+
+    // not a parameter, just which path the controls are showing
+    juce::ComboBox pathSelector;
+    int editedPath { 0 };
+
+    // One set of controls for all the bands, re-attached when another band is selected
+    juce::ComboBox bandSelector, bandTypeBox;
+    juce::ToggleButton bandOnButton { "On" };
+
+    // Freq, Gain, Quality
+    std::array<juce::Slider, 3> bandSliders;
+
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> bandOnAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> bandTypeAttachment;
+    std::array<std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment>, 3> bandSliderAttachments;
+
+    // Dynamic mode: a stage picker with its switch, threshold and ratio, then the attack / release and sidechain all stages share
+    juce::ComboBox dynamicSelector;
+    juce::ToggleButton dynamicButton { "Dynamic" };
+    std::array<juce::Slider, 2> dynamicSliders;
+
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> dynamicAttachment;
+    std::array<std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment>, 2> dynamicSliderAttachments;
+
+    // Attack, Release
+    std::array<juce::Slider, 2> dynamicTimeSliders;
+    std::array<std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment>, 2> dynamicTimeAttachments;
+
+    juce::ToggleButton sidechainButton { "Sidechain" };
+    juce::AudioProcessorValueTreeState::ButtonAttachment sidechainAttachment { audioProcessor.apvts, "Sidechain", sidechainButton };
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SimpleEQAudioProcessorEditor)
 };
@@ -16,16 +16,59 @@ SimpleEQAudioProcessor::SimpleEQAudioProcessor()
                      #if ! JucePlugin_IsMidiEffect
                       #if ! JucePlugin_IsSynth
                        .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
+                       .withInput  ("Sidechain", juce::AudioChannelSet::stereo(), false)
                       #endif
                        .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
                      #endif
                        )
 #endif
 {
+    // Every filter parameter raises a dirty flag on the engine, so processBlock only redesigns what actually changed
+    for (auto* parameterID : CoefficientEngine::parameterIDs)
+        apvts.addParameterListener(parameterID, &coefficientEngine);
+    
+    for (auto& parameterID : CoefficientEngine::getBandParameterIDs())
+        apvts.addParameterListener(parameterID, &coefficientEngine);
+    
+    // A stage leaving dynamic mode needs its static design back, the ids route to their stage like the others.
+    // The switches are shared, so both paths hear them
+    for (auto& parameterID : DynamicEQ::getSwitchParameterIDs())
+    {
+        apvts.addParameterListener(parameterID, &coefficientEngine);
+        apvts.addParameterListener(parameterID, &secondPathEngine);
+    }
+    
+    // otherwise the second path's engine only hears the "Path2 ..." ids
+    for (auto& parameterID : CoefficientEngine::getPathParameterIDs(1))
+        apvts.addParameterListener(parameterID, &secondPathEngine);
+    
+    apvts.addParameterListener("Linear Phase", this);
+    apvts.addParameterListener("Oversampling", this);
+    
+    assignSectionCounters();
 }
 
 SimpleEQAudioProcessor::~SimpleEQAudioProcessor()
 {
+    for (auto* parameterID : CoefficientEngine::parameterIDs)
+        apvts.removeParameterListener(parameterID, &coefficientEngine);
+    
+    for (auto& parameterID : CoefficientEngine::getBandParameterIDs())
+        apvts.removeParameterListener(parameterID, &coefficientEngine);
+    
+    for (auto& parameterID : DynamicEQ::getSwitchParameterIDs())
+    {
+        apvts.removeParameterListener(parameterID, &coefficientEngine);
+        apvts.removeParameterListener(parameterID, &secondPathEngine);
+    }
+    
+    for (auto& parameterID : CoefficientEngine::getPathParameterIDs(1))
+        apvts.removeParameterListener(parameterID, &secondPathEngine);
+    
+    apvts.removeParameterListener("Linear Phase", this);
+    apvts.removeParameterListener("Oversampling", this);
+    
+    cancelPendingUpdate();
 }
 
 //==============================================================================
@@ -63,7 +106,46 @@ bool SimpleEQAudioProcessor::isMidiEffect() const
 
 double SimpleEQAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    auto sampleRate = getSampleRate();
+    
+    if (sampleRate <= 0.0)
+        return 0.0;
+    
+    // the FIR keeps ringing out for its whole length after the input stops
+    if (runsLinearPhase())
+        return linearPhase.getKernelSize() / sampleRate;
+    
+    /* The IIR chain rings for as long as its slowest poles take to decay, which the audio thread works out from the
+        designs it's running (see updateFilters). A pole on the unit circle gives infinity, which JUCE passes on to the
+        host as an infinite tail
+     */
+    return iirTailSamples.load() / sampleRate;
+}
+
+double SimpleEQAudioProcessor::getTailSamples(const CoefficientEngine& engine, int order) const noexcept
+{
+    auto samples = engine.getDecaySamples(tailThreshold) / (1 << order);
+    
+    if (order > 0 && oversamplers[(size_t) order - 1] != nullptr)
+        samples += oversamplers[(size_t) order - 1]->getLatencyInSamples();
+    
+    return samples;
+}
+
+double SimpleEQAudioProcessor::getFilterSettleSeconds(double threshold) const
+{
+    // decay is counted at the rate the chain runs at, which is the oversampled one when oversampling
+    auto sampleRate = coefficientEngine.getSampleRate();
+    
+    if (sampleRate <= 0.0)
+        return 0.0;
+    
+    auto samples = coefficientEngine.getDecaySamples(threshold);
+    
+    if (getStereoMode() != StereoMode::Linked)
+        samples = juce::jmax(samples, secondPathEngine.getDecaySamples(threshold));
+    
+    return samples / sampleRate;
 }
 
 int SimpleEQAudioProcessor::getNumPrograms()
@@ -102,45 +184,129 @@ void SimpleEQAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlo
     // Needs to know the max number of samples it'll process at one time:
     spec.maximumBlockSize = samplesPerBlock;
     
-    spec.numChannels = 1;
-    
     spec.sampleRate = sampleRate;
     
-    leftChain.prepare(spec);
-    rightChain.prepare(spec);
+    // One cascade for every channel on the main bus, the channels get packed into SIMD lanes (the sidechain only feeds
+    // the dynamic bands' detectors). Hosts call prepareToPlay again after changing the bus layout, so this always
+    // matches the current channel count
+    spec.numChannels = (juce::uint32) juce::jmax(getMainBusNumInputChannels(), getMainBusNumOutputChannels());
     
-    /* Producing coeffecients using static helper functions that are part of the IIR class
-        Note the gainFactor arg expects unit in gain value so need to convert decibel units to gain
-        (use Juce's helper method juce::Decibels::decibelsToGain() )
+    /* Same layout and resamplers as last time, and no bigger blocks - a transport restart, a host that re-prepares on
+        every seek, or a sample rate change. None of the buffers depend on the rate (the half-band filters work at a
+        fraction of it, the cascades take whatever coefficients they're given), so everything is already the right size
+        and the state is cleared in place rather than rebuilt. The rate only reaches the coefficients, further down
      */
-
-    updateFilters();
+    auto useFIR = oversamplingUsesFIR.load();
+    auto fits = oversamplers[0] != nullptr && spec.maximumBlockSize <= preparedSpec.maximumBlockSize
+             && spec.numChannels == preparedSpec.numChannels && useFIR == preparedOversamplingFIR;
     
-    // coefficients for the peak filter. we can set the filter's coefficients accordingly
-//    auto peakCoefficients = juce::dsp::IIR::Coefficients<float>::makePeakFilter(
-//                                                                                sampleRate,
-//                                                                                chainSettings.peakFreq,
-//                                                                                chainSettings.peakQuality,
-//                                                                                juce::Decibels::decibelsToGain(chainSettings.peakGainInDecibels)
-//                                                                                );
+    if (fits)
+    {
+        reset();
+        
+        // what we can take in one go stays what it was, processBlock chunks anything longer
+        spec.maximumBlockSize = preparedSpec.maximumBlockSize;
+    }
+    else
+    {
+        // Every oversampling factor gets its own prepared Oversampling, the chains get room for the biggest upsampled block
+        auto filterType = useFIR ? juce::dsp::Oversampling<float>::filterHalfBandFIREquiripple
+                                 : juce::dsp::Oversampling<float>::filterHalfBandPolyphaseIIR;
+        
+        for (int order = 1; order <= maxOversamplingOrder; ++order)
+        {
+            auto index = (size_t) order - 1;
+            
+            oversamplers[index] = std::make_unique<juce::dsp::Oversampling<float>>(spec.numChannels, order, filterType, true, true);
+            oversamplers[index]->initProcessing((size_t) spec.maximumBlockSize);
+            
+            doubleOversamplers[index] = std::make_unique<juce::dsp::Oversampling<double>>(spec.numChannels, order, filterType, true, true);
+            doubleOversamplers[index]->initProcessing((size_t) spec.maximumBlockSize);
+        }
+        
+        auto chainSpec = spec;
+        chainSpec.maximumBlockSize = spec.maximumBlockSize << maxOversamplingOrder;
+        
+        filterChain.prepare(chainSpec);
+        doubleFilterChain.prepare(chainSpec);
+        
+        preparedOversamplingFIR = useFIR;
+    }
+    
+    preparedSpec = spec;
+    
+    // the detectors are designed for the rate, their buffers keep their size unless the blocks grew
+    dynamicEQ.prepare(sampleRate, (int) spec.maximumBlockSize);
+    secondPathDynamicEQ.prepare(sampleRate, (int) spec.maximumBlockSize);
+    
+    activeOversampling = getOversamplingOrder();
+    auto designRate = sampleRate * (1 << activeOversampling);
+    
+    // Start from where the parameters are now, nothing should ramp in from the last session's values
+    subBlockSize = (size_t) juce::jmax(1, smoothingSubBlockSize.load());
+    
+    /* New sample rate means every stage needs redesigning, which updateFilters() below does before we return.
+        The cut table for the host rate is built in the background and swapped in when it's done, cut stages are
+        designed directly until then. Offline renders wait for it, so what they write doesn't depend on timing
+     */
+    for (int path = 0; path < CoefficientEngine::numPaths; ++path)
+    {
+        getSmoother(path).prepare(designRate, smoothingRampSeconds.load());
+        getSmoother(path).setCurrentAndTargetValues(getChainSettings(getHandles(path)));
+        
+        getEngine(path).prepare(sampleRate);
+        getEngine(path).setSampleRate(designRate);
+    }
+    
+    if (isNonRealtime())
+        for (int path = 0; path < CoefficientEngine::numPaths; ++path)
+            getEngine(path).waitForCutTable();
+    
+    // the chains were just reset anyway, so no need to go through setActiveStereoMode()
+    activeStereoMode = getStereoMode();
+    filterChain.setStereoMode(activeStereoMode);
+    doubleFilterChain.setStereoMode(activeStereoMode);
+    
+    analyzer.prepare(sampleRate);
+    
+    // With the mode on, designs the first kernel for the current settings before returning (unless it already has it),
+    // then keeps it up to date in the background. With it off, nothing gets built
+    linearPhase.prepare(spec, isLinearPhase());
+    updateLatency();
     
-    /* You can access links in the processor chin via getters i.e. leftChain.get<int Index>()
-        In the header file, PluginProcessor.h, we can declare an enumeration to define each link's position in the chain
+    ringOutRemaining = -1.0;
+    bypassingSilence = false;
 
-        Access peak filter link with leftChain.get<ChainPositions::Peak>() and assign coefficients
-        Our peakCoefficients declared object above is a reference counted wrapper around an array allocated on the heap
-        IIR::Coefficients are Reference-counted objects that own a juce::Array<float>
-        These helper functions return instances allocated on the heap
-        You must dereference them to copy the underlying coefficients array
-        Note Juce's design of the coefficients object: allocating on the heap in an audio callback is not considered good design.
-    */
-  
+    updateFilters();
 }
 
 void SimpleEQAudioProcessor::releaseResources()
 {
     // When playback stops, you can use this as an opportunity to free up any
     // spare memory, etc.
+    linearPhase.release();
+}
+
+void SimpleEQAudioProcessor::reset()
+{
+    // all of these clear in place: one fill per cascade, no allocation and no redesign
+    filterChain.reset();
+    doubleFilterChain.reset();
+    
+    for (auto& oversampler : oversamplers)
+        if (oversampler != nullptr)
+            oversampler->reset();
+    
+    for (auto& oversampler : doubleOversamplers)
+        if (oversampler != nullptr)
+            oversampler->reset();
+    
+    dynamicEQ.reset();
+    secondPathDynamicEQ.reset();
+    linearPhase.reset();
+    
+    ringOutRemaining = -1.0;
+    bypassingSilence = false;
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -151,11 +317,10 @@ bool SimpleEQAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts)
     return true;
   #else
     // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    // Some plugin hosts, such as certain GarageBand versions, will only
-    // load plugins that support stereo bus layouts.
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+    // Any channel count works - mono, stereo, 5.1, 7.1.4, ambisonics... Every channel runs through the same
+    // cascade, packed a SIMD register's worth of channels at a time, so cost just grows with the number of lane groups.
+    // Dual mono and mid / side only split the first two channels, the rest stay on the first path.
+    if (layouts.getMainOutputChannelSet().isDisabled())
         return false;
 
     // This checks if the input layout matches the output layout
@@ -164,22 +329,56 @@ bool SimpleEQAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts)
         return false;
    #endif
 
+    // The sidechain can be anything or nothing at all, the detectors listen to a mono sum of whatever it carries
+
     return true;
   #endif
 }
 #endif
 
+/* Hosts are allowed to hand over more samples than they said at prepareToPlay (some do after a buffer size change,
+    before they get round to preparing again), and everything downstream is sized for at most that many. Longer
+    buffers go through in slices of the prepared size. Each slice is a buffer referring to the host's channels, which
+    doesn't allocate for fewer than 32 channels
+ */
+template <typename SampleType, typename ChainType>
+void SimpleEQAudioProcessor::processInChunks (juce::AudioBuffer<SampleType>& buffer, ChainType& chain)
+{
+    auto numSamples = buffer.getNumSamples();
+    auto chunkSize = (int) preparedSpec.maximumBlockSize;
+    
+    if (numSamples <= chunkSize || chunkSize <= 0)
+    {
+        processChain(buffer, chain);
+        return;
+    }
+    
+    for (int start = 0; start < numSamples; start += chunkSize)
+    {
+        juce::AudioBuffer<SampleType> chunk(buffer.getArrayOfWritePointers(), buffer.getNumChannels(),
+                                            start, juce::jmin(chunkSize, numSamples - start));
+        processChain(chunk, chain);
+    }
+}
+
 /* A processor chain requires a processing context to be passed to it
     dsp::ProcessorChains process dsp::ProcessContextReplacing<> instances in order to run the audio through links in the chain
     In order to make a ProcessingContext, we need to supply an AudioBlock:
     dsp::ProcessingContextReplacing<> instances are constructed with dsp::AudioBlock<>'s
     Process block function is called by the host and given a buffer with any number of channels
  */
-void SimpleEQAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+template <typename SampleType, typename ChainType>
+void SimpleEQAudioProcessor::processChain (juce::AudioBuffer<SampleType>& buffer, ChainType& chain)
 {
-    juce::ScopedNoDenormals noDenormals;
+    // with instrumentation compiled out every count below is an empty scope
+    juce::uint64 blockStart = 0;
+    
+    if constexpr (PerformanceCounters::enabled)
+        blockStart = PerformanceCounters::readCycleCounter();
+    
     auto totalNumInputChannels  = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
+    auto mainBusNumInputChannels = getMainBusNumInputChannels();
 
     // In case we have more outputs than inputs, this code clears any output
     // channels that didn't contain input data, (because these aren't
@@ -190,38 +389,217 @@ void SimpleEQAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juc
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, buffer.getNumSamples());
 
-    updateFilters();
+    {
+        ScopedCycleCount count(performanceCounters, PerformanceCounters::UpdateFilters);
+        
+        // before the dirty stages get picked up, so a path coming into use isn't designed twice
+        if (auto mode = getStereoMode(); mode != activeStereoMode)
+            setActiveStereoMode(mode);
+        
+        updateFilters();
+    }
+    
+    // a topology switch converts every section and clears the state, so it only ever happens between blocks
+    if (auto topology = filterTopology.load(); topology != chain.getTopology())
+    {
+        filterChain.setTopology(topology);
+        doubleFilterChain.setTopology(topology);
+    }
     
-    // Extract left and right (typically 0 and 1) from buffer supplied from host
     // create an audio block to wrap buffer
-    juce::dsp::AudioBlock<float> block(buffer);
+    // Only the channels on the main bus go through the cascade (the buffer can be wider, e.g. extra output channels
+    // or the sidechain, which comes after the main input)
+    juce::dsp::AudioBlock<SampleType> block(buffer);
+    block = block.getSubsetChannelBlock(0, (size_t) juce::jmin(mainBusNumInputChannels, buffer.getNumChannels()));
+    
+    // does nothing unless the editor is showing the spectrum
+    analyzer.push(SpectrumAnalyzer::PreEQ, block);
+    
+    if (skipSilentBlock(block))
+    {
+        // nothing to run, the block is already cleared
+    }
+    else if (runsLinearPhase())
+    {
+        // Kernel changes crossfade inside the convolution, the ramps only need to keep the IIR chain current
+        // so switching back lands on the right coefficients
+        for (int path = 0; path < getNumActivePaths(); ++path)
+        {
+            if (auto stages = getSmoother(path).getSmoothingStages())
+            {
+                ScopedCycleCount count(performanceCounters, PerformanceCounters::UpdateFilters);
+                applyCoefficients(getSmoother(path).advance((int) block.getNumSamples() << activeOversampling), stages, false, path);
+            }
+        }
+        
+        ScopedCycleCount count(performanceCounters, PerformanceCounters::LinearPhase);
+        linearPhase.process(block);
+    }
+    else
+    {
+        auto order = getOversamplingOrder();
+        
+        if (order != activeOversampling)
+            setActiveOversampling(order);
+        
+        // The detectors listen at the host rate, before the block is touched (or upsampled)
+        {
+            ScopedCycleCount count(performanceCounters, PerformanceCounters::Dynamics);
+            auto* sidechain = dynamicEQ.usesSidechain() ? getBus(true, 1) : nullptr;
+            auto detector = block;
+            
+            if (sidechain != nullptr && sidechain->isEnabled() && sidechain->getNumberOfChannels() > 0)
+                detector = juce::dsp::AudioBlock<SampleType>(buffer)
+                               .getSubsetChannelBlock((size_t) sidechain->getChannelIndexInProcessBlockBuffer(0),
+                                                      (size_t) sidechain->getNumberOfChannels());
+            
+            // each path listens to its own channel in the split modes, a stereo sidechain splits the same way
+            for (int path = 0; path < getNumActivePaths(); ++path)
+                getDynamics(path).analyse(detector, getSmoother(path).getCurrentSettings(), getDetectorInput(path));
+        }
+        
+        if (order == 0)
+        {
+            processIIR(block, chain);
+        }
+        else
+        {
+            auto* oversampler = getOversampler<SampleType>(order);
+            juce::dsp::AudioBlock<SampleType> upsampled;
+            
+            {
+                ScopedCycleCount count(performanceCounters, PerformanceCounters::Oversampling);
+                upsampled = oversampler->processSamplesUp(block);
+            }
+            
+            processIIR(upsampled, chain);
+            
+            ScopedCycleCount count(performanceCounters, PerformanceCounters::Oversampling);
+            oversampler->processSamplesDown(block);
+        }
+    }
+    
+    trackRingOut(block);
+    analyzer.push(SpectrumAnalyzer::PostEQ, block);
+    
+    if constexpr (PerformanceCounters::enabled)
+    {
+        chain.addCyclesTo(performanceCounters);
+        performanceCounters.add(PerformanceCounters::ProcessBlock, PerformanceCounters::readCycleCounter() - blockStart);
+        performanceCounters.commitBlock(buffer.getNumSamples());
+    }
+}
+
+template <typename SampleType>
+bool SimpleEQAudioProcessor::skipSilentBlock(juce::dsp::AudioBlock<SampleType>& block)
+{
+    auto range = block.findMinAndMax();
+    auto peak = juce::jmax(-range.getStart(), range.getEnd());
+    
+    if (! silenceBypassEnabled.load() || peak > (SampleType) silenceThreshold.load())
+    {
+        ringOutRemaining = -1.0;
+        bypassingSilence = false;
+        return false;
+    }
     
-    auto leftBlock = block.getSingleChannelBlock(0);
-    auto rightBlock = block.getSingleChannelBlock(1);
+    if (! bypassingSilence.load())
+    {
+        /* Silent input from here on, but the chain still holds the tail of what came before. Run it for as long as the
+            current design takes to decay (starting over whenever the coefficients move), and until the output has
+            followed it down as well - that also covers the resamplers' own ringing
+         */
+        if (ringOutRemaining < 0.0 || ringOutStale)
+        {
+            ringOutRemaining = runsLinearPhase() ? (double) linearPhase.getKernelSize()
+                                               : getTailSamples(coefficientEngine, activeOversampling);
+            
+            if (! runsLinearPhase() && getNumActivePaths() > 1)
+                ringOutRemaining = juce::jmax(ringOutRemaining, getTailSamples(secondPathEngine, activeOversampling));
+            
+            ringOutStale = false;
+            ringOutOutputSilent = false;
+        }
+        
+        if (ringOutRemaining > 0.0 || ! ringOutOutputSilent)
+        {
+            ringOutRemaining -= (double) block.getNumSamples();
+            return false;
+        }
+        
+        // rung out. Whatever's left in the state is below the tail threshold, so wake up from a clean slate
+        filterChain.reset();
+        doubleFilterChain.reset();
+        ringOutRemaining = -1.0;
+        bypassingSilence = true;
+    }
+    
+    // Nobody hears a ramp while we're bypassed, so land it. Waking up then starts from the right coefficients
+    for (int path = 0; path < getNumActivePaths(); ++path)
+    {
+        auto& smoother = getSmoother(path);
+        
+        if (smoother.isSmoothing())
+        {
+            smoother.setCurrentAndTargetValues(getChainSettings(getHandles(path)));
+            applyCoefficients(smoother.getCurrentSettings(), CoefficientEngine::AllStages, true, path);
+        }
+    }
     
-    // Now we write processing contexts that wrap each individual audio block for each channel that the chain(s) can use:
-    juce::dsp::ProcessContextReplacing<float> leftContext(leftBlock);
-    juce::dsp::ProcessContextReplacing<float> rightContext(rightBlock);
+    block.clear();
+    return true;
+}
 
-    // Pass contexts to the mono filter chain:
-    leftChain.process(leftContext);
-    rightChain.process(rightContext);
+template <typename SampleType>
+void SimpleEQAudioProcessor::trackRingOut(const juce::dsp::AudioBlock<SampleType>& block)
+{
+    if (ringOutRemaining < 0.0)
+        return;
     
+    // the output has to get under the tail threshold even when the input threshold is digital zero
+    auto range = block.findMinAndMax();
+    auto peak = juce::jmax(-range.getStart(), range.getEnd());
     
+    ringOutOutputSilent = peak <= (SampleType) juce::jmax((double) silenceThreshold.load(), tailThreshold);
+}
+
+template <typename SampleType, typename ChainType>
+void SimpleEQAudioProcessor::processIIR (juce::dsp::AudioBlock<SampleType>& block, ChainType& chain)
+{
+    // While a parameter is ramping or a stage is dynamic the block gets split up so its coefficients can follow
+    if (isSmoothing() || hasActiveDynamics())
+    {
+        processSmoothed(block, chain);
+        return;
+    }
+    
+    // One processing context for the whole block - the cascade runs all channels together, a SIMD register's worth at a time
+    juce::dsp::ProcessContextReplacing<SampleType> context(block);
+
+    chain.process(context);
+}
+
+void SimpleEQAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+    juce::ScopedNoDenormals noDenormals;
     
+    // float I/O either way, mixed precision just runs the double cascade on it
+    if (useDoubleState)
+        processInChunks(buffer, doubleFilterChain);
+    else
+        processInChunks(buffer, filterChain);
+}
+
+void SimpleEQAudioProcessor::processBlock (juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages)
+{
+    juce::ScopedNoDenormals noDenormals;
     
-    // This is the place where you'd normally do the guts of your plugin's
-    // audio processing...
-    // Make sure to reset the state if your inner loop is processing
-    // the samples and the outer loop is handling the channels.
-    // Alternatively, you can process the samples with the channels
-    // interleaved by keeping the same state.
-//    for (int channel = 0; channel < totalNumInputChannels; ++channel)
-//    {
-//        auto* channelData = buffer.getWritePointer (channel);
-//
-//        // ..do something to the data...
-//    }
+    processInChunks(buffer, doubleFilterChain);
+}
+
+bool SimpleEQAudioProcessor::supportsDoublePrecisionProcessing() const
+{
+    return true;
 }
 
 //==============================================================================
@@ -232,22 +610,25 @@ bool SimpleEQAudioProcessor::hasEditor() const
 
 juce::AudioProcessorEditor* SimpleEQAudioProcessor::createEditor()
 {
-   // return new SimpleEQAudioProcessorEditor (*this);
-    return new juce::GenericAudioProcessorEditor(*this);
+    return new SimpleEQAudioProcessorEditor (*this);
 }
 
 //==============================================================================
 void SimpleEQAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
-    // You should use this method to store your parameters in the memory block.
-    // You could do that either as raw data, or use the XML or ValueTree classes
-    // as intermediaries to make it easy to save and load complex data.
+    // Binary rather than apvts.copyState() -> XML: no tree copy, no text formatting, ~4 kB. See ParameterState
+    parameterState.write(destData);
 }
 
 void SimpleEQAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
-    // You should use this method to restore your parameters from this memory block,
-    // whose contents will have been created by the getStateInformation() call.
+    // Parameters are atomics, so this never waits on the audio thread - it just asks it to hold off designing until we're done
+    ++stateRestoresInProgress;
+    
+    if (parameterState.read(data, sizeInBytes).wasOk())
+        restoredStatePending = true;
+    
+    --stateRestoresInProgress;
 }
 
 /*
@@ -255,113 +636,393 @@ void SimpleEQAudioProcessor::setStateInformation (const void* data, int sizeInBy
     1. getParameter(String value) - but this returns a normalised value
     2. getRawParameterValue() returns atomic (indivisible, see atomicity and thread safety) values handy for interacting with the GUI
  */
-ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts)
+ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts, int path)
+{
+    return getChainSettings(ParameterHandles(apvts, path));
+}
+
+ParameterHandles::ParameterHandles(juce::AudioProcessorValueTreeState& apvts, int path)
+    : lowCutFreq(apvts.getRawParameterValue(CoefficientEngine::getPathParameterID(path, "LowCut Freq"))),
+      highCutFreq(apvts.getRawParameterValue(CoefficientEngine::getPathParameterID(path, "HighCut Freq"))),
+      peakFreq(apvts.getRawParameterValue(CoefficientEngine::getPathParameterID(path, "Peak Freq"))),
+      peakGain(apvts.getRawParameterValue(CoefficientEngine::getPathParameterID(path, "Peak Gain"))),
+      peakQuality(apvts.getRawParameterValue(CoefficientEngine::getPathParameterID(path, "Peak Quality"))),
+      lowCutSlope(apvts.getRawParameterValue(CoefficientEngine::getPathParameterID(path, "LowCut Slope"))),
+      highCutSlope(apvts.getRawParameterValue(CoefficientEngine::getPathParameterID(path, "HighCut Slope")))
+{
+    jassert(lowCutFreq != nullptr && highCutFreq != nullptr && peakFreq != nullptr && peakGain != nullptr
+            && peakQuality != nullptr && lowCutSlope != nullptr && highCutSlope != nullptr);
+    
+    for (int i = 0; i < ChainSettings::maxBands; ++i)
+    {
+        auto& band = bands[(size_t) i];
+        auto id = [i, path](const char* field) { return CoefficientEngine::getPathParameterID(path, CoefficientEngine::getBandParameterID(i, field)); };
+        
+        band.enabled = apvts.getRawParameterValue(id("On"));
+        band.type = apvts.getRawParameterValue(id("Type"));
+        band.freq = apvts.getRawParameterValue(id("Freq"));
+        band.gain = apvts.getRawParameterValue(id("Gain"));
+        band.quality = apvts.getRawParameterValue(id("Quality"));
+        
+        jassert(band.enabled != nullptr && band.type != nullptr && band.freq != nullptr && band.gain != nullptr && band.quality != nullptr);
+    }
+}
+
+/*
+ Each field is an independent relaxed load - there's nothing to synchronise with, we just want the latest value
+ of every parameter without taking a lock on the audio thread
+ */
+ChainSettings getChainSettings(const ParameterHandles& parameters)
 {
     ChainSettings settings;
     
-    settings.lowCutFreq = apvts.getRawParameterValue("LowCut Freq")->load();
-    settings.highCutFreq = apvts.getRawParameterValue("HighCut Freq")->load();
-    settings.peakFreq = apvts.getRawParameterValue("Peak Freq")->load();
-    settings.peakGainInDecibels = apvts.getRawParameterValue("Peak Gain")->load();
-    settings.peakQuality = apvts.getRawParameterValue("Peak Quality")->load();
-    settings.lowCutSlope = static_cast<Slope>(apvts.getRawParameterValue("LowCut Slope")->load());
-    settings.highCutSlope = static_cast<Slope>(apvts.getRawParameterValue("HighCut Slope")->load());
+    settings.lowCutFreq = parameters.lowCutFreq->load(std::memory_order_relaxed);
+    settings.highCutFreq = parameters.highCutFreq->load(std::memory_order_relaxed);
+    settings.peakFreq = parameters.peakFreq->load(std::memory_order_relaxed);
+    settings.peakGainInDecibels = parameters.peakGain->load(std::memory_order_relaxed);
+    settings.peakQuality = parameters.peakQuality->load(std::memory_order_relaxed);
+    settings.lowCutSlope = static_cast<Slope>(parameters.lowCutSlope->load(std::memory_order_relaxed));
+    settings.highCutSlope = static_cast<Slope>(parameters.highCutSlope->load(std::memory_order_relaxed));
+    
+    for (size_t i = 0; i < parameters.bands.size(); ++i)
+    {
+        auto& handles = parameters.bands[i];
+        auto& band = settings.bands[i];
+        
+        band.enabled = handles.enabled->load(std::memory_order_relaxed) > 0.5f;
+        band.type = static_cast<BandType>(handles.type->load(std::memory_order_relaxed));
+        band.freq = handles.freq->load(std::memory_order_relaxed);
+        band.gainInDecibels = handles.gain->load(std::memory_order_relaxed);
+        band.quality = handles.quality->load(std::memory_order_relaxed);
+    }
     
     return settings;
 }
 
-void SimpleEQAudioProcessor::updatePeakFilter(const ChainSettings &chainSettings)
+void SimpleEQAudioProcessor::updatePeakFilter(int path)
+{
+    setSection(ChainPositions::Peak, getEngine(path).getPeak(), path);
+}
+
+void SimpleEQAudioProcessor::updateLowCutFilters(const ChainSettings &chainSettings, int path)
 {
-    auto peakCoefficients = juce::dsp::IIR::Coefficients<float>::makePeakFilter(
-                                                                                getSampleRate(),
-                                                                                chainSettings.peakFreq,
-                                                                                chainSettings.peakQuality,
-                                                                                juce::Decibels::decibelsToGain(chainSettings.peakGainInDecibels)
-                                                                                );
- 
+    // Getting the coefficients and updating the chain...
     
-    *leftChain.get<ChainPositions::Peak>().coefficients = *peakCoefficients;
-    *rightChain.get<ChainPositions::Peak>().coefficients = *peakCoefficients;
-    updateCoefficients(leftChain.get<ChainPositions::Peak>().coefficients, peakCoefficients);
-    updateCoefficients(rightChain.get<ChainPositions::Peak>().coefficients, peakCoefficients);
+    updateCutFilter(ChainPositions::LowCut, getEngine(path).getLowCut(), chainSettings.lowCutSlope, path);
+}
 
+void SimpleEQAudioProcessor::updateHighCutFilters(const ChainSettings &chainSettings, int path)
+{
+    updateCutFilter(ChainPositions::HighCut, getEngine(path).getHighCut(), chainSettings.highCutSlope, path);
 }
 
-void SimpleEQAudioProcessor::updateCoefficients(Coefficients &old, const Coefficients &replacements)
+void SimpleEQAudioProcessor::updateBandFilters(const ChainSettings& chainSettings, int stages, int path)
 {
-    *old = *replacements;
+    for (int i = 0; i < ChainSettings::maxBands; ++i)
+    {
+        if ((stages & CoefficientEngine::bandStage(i)) == 0)
+            continue;
+        
+        auto enabled = chainSettings.bands[(size_t) i].enabled;
+        
+        if (enabled)
+            setSection(ChainPositions::Bands + i, getEngine(path).getBand(i), path);
+        
+        setSectionBypassed(ChainPositions::Bands + i, ! enabled, path);
+    }
+}
+
+void SimpleEQAudioProcessor::assignSectionCounters()
+{
+    for (int section = 0; section < numChainSections; ++section)
+    {
+        auto counter = section >= ChainPositions::Bands   ? PerformanceCounters::Bands
+                     : section >= ChainPositions::HighCut ? PerformanceCounters::HighCut
+                     : section >= ChainPositions::Peak    ? PerformanceCounters::Peak
+                                                          : PerformanceCounters::LowCut;
+        
+        filterChain.setSectionCounter(section, counter);
+        doubleFilterChain.setSectionCounter(section, counter);
+    }
 }
 
-void SimpleEQAudioProcessor::updateLowCutFilters(const ChainSettings &chainSettings)
+void SimpleEQAudioProcessor::updateFilters()
 {
-    // Getting the coefficients and updating both chains...
+    // half way through a state restore, whatever's dirty stays dirty until it's finished
+    if (stateRestoresInProgress.load() > 0)
+        return;
     
-    auto cutCoefficients = juce::dsp::FilterDesign<float>::designIIRHighpassHighOrderButterworthMethod(chainSettings.lowCutFreq,
-                                                                                getSampleRate(),
-                                                                                2 * (chainSettings.lowCutSlope + 1));
+    auto restoredState = restoredStatePending.exchange(false);
     
-    auto& leftLowCut = leftChain.get<ChainPositions::LowCut>();
-    auto& rightLowCut = rightChain.get<ChainPositions::LowCut>();
+    for (int path = 0; path < getNumActivePaths(); ++path)
+        updatePathFilters(path, restoredState);
     
-    updateCutFilter(leftLowCut, cutCoefficients, chainSettings.lowCutSlope);
-    updateCutFilter(rightLowCut, cutCoefficients, chainSettings.lowCutSlope);
+    // Picks up ramp steps from the last block too. With two paths the channel that rings longest sets the tail
+    if (tailStale)
+    {
+        auto samples = 0.0;
+        
+        for (int path = 0; path < getNumActivePaths(); ++path)
+            samples = juce::jmax(samples, getTailSamples(getEngine(path), activeOversampling));
+        
+        iirTailSamples = samples;
+        tailStale = false;
+    }
 }
 
-void SimpleEQAudioProcessor::updateHighCutFilters(const ChainSettings &chainSettings)
+void SimpleEQAudioProcessor::updatePathFilters(int path, bool restoredState)
 {
-    auto highCutCoefficients = juce::dsp::FilterDesign<float>::designIIRLowpassHighOrderButterworthMethod(
-                                                                                                chainSettings.highCutFreq,
-                                                                                                getSampleRate(),
-                                                                                                2 * (chainSettings.lowCutSlope + 1)
-                                                                                            );
+    auto& engine = getEngine(path);
+    auto& smoother = getSmoother(path);
+    
+    if (restoredState)
+    {
+        engine.takeDirtyStages();
+        smoother.setCurrentAndTargetValues(getChainSettings(getHandles(path)));
+        applyCoefficients(smoother.getCurrentSettings(), CoefficientEngine::AllStages, true, path);
+        return;
+    }
+    
+    // Take the dirty flags before reading the params, anything that moves while we're designing gets picked up next block
+    auto dirtyStages = engine.takeDirtyStages();
     
-    auto& leftHighCut = leftChain.get<ChainPositions::HighCut>();
-    auto& rightHighCut = rightChain.get<ChainPositions::HighCut>();
+    // designed without the cache and nothing's moved them since: they've settled, hand them to it now
+    if (auto settled = unsharedStages[(size_t) path] & ~dirtyStages & ~smoother.getSmoothingStages())
+    {
+        engine.share(settled);
+        unsharedStages[(size_t) path] &= ~settled;
+    }
     
-    updateCutFilter(leftHighCut, highCutCoefficients, chainSettings.highCutSlope);
-    updateCutFilter(rightHighCut, highCutCoefficients, chainSettings.highCutSlope);
+    if (dirtyStages == 0)
+        return;
+    
+    smoother.setTargetValues(getChainSettings(getHandles(path)));
+    
+    // Stages that started ramping get designed sub-block by sub-block in processSmoothed(),
+    // everything else (slope changes, smoothing switched off, first block after prepare) is designed once here.
+    // Not shared yet: with smoothing off automation lands here every block, and its steps would only fill the cache
+    auto immediateStages = dirtyStages & ~smoother.getSmoothingStages();
+    
+    if (immediateStages != 0)
+        applyCoefficients(smoother.getCurrentSettings(), immediateStages, false, path);
 }
 
-void SimpleEQAudioProcessor::updateFilters()
+void SimpleEQAudioProcessor::applyCoefficients(const ChainSettings& chainSettings, int stages, bool shareDesigns, int path)
+{
+    getEngine(path).design(chainSettings, stages, shareDesigns);
+    ringOutStale = true;
+    tailStale = true;
+    
+    auto& unshared = unsharedStages[(size_t) path];
+    unshared = shareDesigns ? (unshared & ~stages) : (unshared | stages);
+    
+    getDynamics(path).markStale(stages);
+    
+    if (stages & CoefficientEngine::LowCutStage)
+        updateLowCutFilters(chainSettings, path);
+    
+    if (stages & CoefficientEngine::PeakStage)
+        updatePeakFilter(path);
+    
+    if (stages & CoefficientEngine::HighCutStage)
+        updateHighCutFilters(chainSettings, path);
+    
+    if (stages & CoefficientEngine::AllBandStages)
+        updateBandFilters(chainSettings, stages, path);
+}
+
+void SimpleEQAudioProcessor::setActiveStereoMode(StereoMode mode)
 {
-    auto chainSettings = getChainSettings(apvts);
+    auto wasSplit = activeStereoMode != StereoMode::Linked;
+    activeStereoMode = mode;
+    tailStale = true;
+    
+    // clears the state as well, left / right history means nothing as mid / side
+    filterChain.setStereoMode(mode);
+    doubleFilterChain.setStereoMode(mode);
+    
+    // the detectors listen to different channels now, so they start over too (and reload their stages)
+    dynamicEQ.reset();
+    secondPathDynamicEQ.reset();
+    
+    if (wasSplit || mode == StereoMode::Linked)
+        return;
     
-    updateLowCutFilters(chainSettings);
-    updatePeakFilter(chainSettings);
-    updateHighCutFilters(chainSettings);
+    secondPathEngine.takeDirtyStages();
+    secondPathSmoother.setCurrentAndTargetValues(getChainSettings(secondPathHandles));
+    applyCoefficients(secondPathSmoother.getCurrentSettings(), CoefficientEngine::AllStages, true, 1);
+}
+
+bool SimpleEQAudioProcessor::isSmoothing() const noexcept
+{
+    return chainSmoother.isSmoothing() || (getNumActivePaths() > 1 && secondPathSmoother.isSmoothing());
+}
+
+bool SimpleEQAudioProcessor::hasActiveDynamics() const noexcept
+{
+    return dynamicEQ.isActive() || (getNumActivePaths() > 1 && secondPathDynamicEQ.isActive());
+}
+
+DynamicEQ::Input SimpleEQAudioProcessor::getDetectorInput(int path) const noexcept
+{
+    switch (activeStereoMode)
+    {
+        case StereoMode::DualMono: return path == 0 ? DynamicEQ::Input::FirstChannel : DynamicEQ::Input::SecondChannel;
+        case StereoMode::MidSide:  return path == 0 ? DynamicEQ::Input::Mean : DynamicEQ::Input::Side;
+        case StereoMode::Linked:
+        default:                   return DynamicEQ::Input::Mean;
+    }
+}
+
+template <typename SampleType, typename ChainType>
+void SimpleEQAudioProcessor::processSmoothed(juce::dsp::AudioBlock<SampleType>& block, ChainType& chain)
+{
+    auto numSamples = block.getNumSamples();
+    
+    for (size_t start = 0; start < numSamples; start += subBlockSize)
+    {
+        auto length = juce::jmin(subBlockSize, numSamples - start);
+        
+        // only the stages that are still moving pay for a redesign, once a ramp lands its stage stops being touched
+        for (int path = 0; path < getNumActivePaths(); ++path)
+        {
+            if (auto stages = getSmoother(path).getSmoothingStages())
+            {
+                ScopedCycleCount count(performanceCounters, PerformanceCounters::UpdateFilters);
+                applyCoefficients(getSmoother(path).advance((int) length), stages, false, path);
+            }
+        }
+        
+        if (hasActiveDynamics())
+        {
+            ScopedCycleCount count(performanceCounters, PerformanceCounters::Dynamics);
+            applyDynamics((int) (start >> activeOversampling));
+        }
+        
+        auto subBlock = block.getSubBlock(start, length);
+        juce::dsp::ProcessContextReplacing<SampleType> context(subBlock);
+        
+        chain.process(context);
+    }
+}
+
+void SimpleEQAudioProcessor::applyDynamics(int position)
+{
+    BiquadCoefficients coefficients;
+    
+    for (int path = 0; path < getNumActivePaths(); ++path)
+    {
+        auto& dynamics = getDynamics(path);
+        auto settings = getSmoother(path).getCurrentSettings();
+        auto designRate = getEngine(path).getSampleRate();
+        
+        for (int i = 0; i < dynamics.getNumActiveSlots(); ++i)
+        {
+            auto slot = dynamics.getActiveSlot(i);
+            
+            if (dynamics.getCoefficients(slot, position, settings, designRate, coefficients))
+                setSection(slot == 0 ? ChainPositions::Peak : ChainPositions::Bands + slot - 1, coefficients, path);
+        }
+    }
+}
+
+void SimpleEQAudioProcessor::setActiveOversampling(int order)
+{
+    activeOversampling = order;
+    
+    auto designRate = getSampleRate() * (1 << order);
+    
+    // ramps restart at the new rate, from where the parameters are now (no allocation in any of this).
+    // A path that isn't running still gets the rate, it's designed in full whenever it comes into use
+    for (int path = 0; path < CoefficientEngine::numPaths; ++path)
+    {
+        auto& engine = getEngine(path);
+        auto& smoother = getSmoother(path);
+        
+        engine.setSampleRate(designRate);
+        smoother.prepare(designRate, smoothingRampSeconds.load());
+        smoother.setCurrentAndTargetValues(getChainSettings(getHandles(path)));
+        
+        if (path < getNumActivePaths())
+        {
+            engine.takeDirtyStages();
+            applyCoefficients(smoother.getCurrentSettings(), CoefficientEngine::AllStages, true, path);
+        }
+    }
+    
+    // filter state from the old rate means nothing at the new one
+    filterChain.reset();
+    doubleFilterChain.reset();
+    
+    for (size_t i = 0; i < oversamplers.size(); ++i)
+    {
+        oversamplers[i]->reset();
+        doubleOversamplers[i]->reset();
+    }
+}
+
+void SimpleEQAudioProcessor::updateLatency()
+{
+    auto latency = 0;
+    
+    if (runsLinearPhase())
+        latency = linearPhase.getLatencySamples();
+    else if (auto order = getOversamplingOrder(); order > 0 && oversamplers[(size_t) order - 1] != nullptr)
+        latency = juce::roundToInt(oversamplers[(size_t) order - 1]->getLatencyInSamples());
+    
+    setLatencySamples(latency);
+}
+
+void SimpleEQAudioProcessor::parameterChanged(const juce::String& parameterID, float newValue)
+{
+    /* setLatencySamples() tells the host, which isn't allowed from the audio thread. The editor and a session load
+        switch Linear Phase and Oversampling on the message thread (neither is automatable) and get it done right away,
+        a host that sets them from anywhere else anyway gets it done asynchronously
+     */
+    if (parameterID == "Linear Phase" || parameterID == "Oversampling")
+    {
+        if (juce::MessageManager::existsAndIsCurrentThread())
+            handleAsyncUpdate();
+        else
+            triggerAsyncUpdate();
+    }
+}
+
+void SimpleEQAudioProcessor::handleAsyncUpdate()
+{
+    // builds the linear phase engine when the mode comes on, frees it again when it goes off
+    linearPhase.setEnabled(isLinearPhase());
+    updateLatency();
+}
+
+void SimpleEQAudioProcessor::setParameterSmoothing(double rampSeconds, int newSubBlockSize)
+{
+    smoothingRampSeconds = juce::jmax(0.0, rampSeconds);
+    smoothingSubBlockSize = juce::jmax(1, newSubBlockSize);
+}
+
+void SimpleEQAudioProcessor::setSilenceBypass(bool shouldBypass, float thresholdDecibels)
+{
+    silenceThreshold = juce::Decibels::decibelsToGain(thresholdDecibels, -1000.0f);
+    silenceBypassEnabled = shouldBypass;
+}
+
+namespace
+{
+    // For the parameters that change the latency we report: hosts leave them out of automation
+    template <typename ParameterType>
+    struct NonAutomatableParameter : public ParameterType
+    {
+        using ParameterType::ParameterType;
+        
+        bool isAutomatable() const override { return false; }
+    };
 }
 
 juce::AudioProcessorValueTreeState::ParameterLayout SimpleEQAudioProcessor::createParameterLayout()
 {
     juce::AudioProcessorValueTreeState::ParameterLayout layout;
     
-    layout.add(std::make_unique<juce::AudioParameterFloat>("LowCut Freq",
-                                                          "LowCut Freq",
-                                                          juce::NormalisableRange<float>(20.f, 20000.f, 1.f, 0.25f),
-                                                          20.f));
-    
-    layout.add(std::make_unique<juce::AudioParameterFloat>("HighCut Freq",
-                                                          "HighCut Freq",
-                                                          juce::NormalisableRange<float>(20.f, 20000.f, 1.f, 0.25f),
-                                                          750.f));
-    
-    layout.add(std::make_unique<juce::AudioParameterFloat>("Peak Freq",
-                                                          "Peak Freq",
-                                                          juce::NormalisableRange<float>(20.f, 20000.f, 1.f, 0.25f),
-                                                          750.f));
-    
-    // Express gain in decibels. Slider intervals in half decibels. skew of 1 keeps a linear fashion, default gain should be 0
-    layout.add(std::make_unique<juce::AudioParameterFloat>("Peak Gain",
-                                                          "Peak Gain",
-                                                          juce::NormalisableRange<float>(-24.f, 24.f, 0.5f, 1.f),
-                                                          0.0f));
-    
-    // Bandwidth / Q / Quality).
-    layout.add(std::make_unique<juce::AudioParameterFloat>("Peak Quality",
-                                                          "Peak Quality",
-                                                          juce::NormalisableRange<float>(0.1f, 10.f, 0.05f, 1.f),
-                                                          1.f));
-    
     // For slope, use AudioParameterChoice as should use choice of 12, 24, 36, 48 (not linear slider)
     juce::StringArray stringArray;
     for( int i = 0; i < 4; ++i )
@@ -372,10 +1033,133 @@ juce::AudioProcessorValueTreeState::ParameterLayout SimpleEQAudioProcessor::crea
         stringArray.add(str);
     }
     
-    layout.add(std::make_unique<juce::AudioParameterChoice>("LowCut Slope", "LowCut Slope", stringArray, 0));
-    layout.add(std::make_unique<juce::AudioParameterChoice>("HighCut Slope", "HighCut Slope", stringArray, 0));
-
+    /* The cut / peak parameters of one filter path. Path 0's go straight into the layout, path 1's into the "Path2" group
+        further down. add is layout.add or a group's addChild, same as addDynamicParameters
+     */
+    auto addMainParameters = [&stringArray](int path, auto&& add)
+    {
+        auto id = [path](const char* parameterID) { return CoefficientEngine::getPathParameterID(path, parameterID); };
+        
+        add(std::make_unique<juce::AudioParameterFloat>(id("LowCut Freq"),
+                                                        id("LowCut Freq"),
+                                                        juce::NormalisableRange<float>(20.f, 20000.f, 1.f, 0.25f),
+                                                        20.f));
+        
+        add(std::make_unique<juce::AudioParameterFloat>(id("HighCut Freq"),
+                                                        id("HighCut Freq"),
+                                                        juce::NormalisableRange<float>(20.f, 20000.f, 1.f, 0.25f),
+                                                        750.f));
+        
+        add(std::make_unique<juce::AudioParameterFloat>(id("Peak Freq"),
+                                                        id("Peak Freq"),
+                                                        juce::NormalisableRange<float>(20.f, 20000.f, 1.f, 0.25f),
+                                                        750.f));
+        
+        // Express gain in decibels. Slider intervals in half decibels. skew of 1 keeps a linear fashion, default gain should be 0
+        add(std::make_unique<juce::AudioParameterFloat>(id("Peak Gain"),
+                                                        id("Peak Gain"),
+                                                        juce::NormalisableRange<float>(-24.f, 24.f, 0.5f, 1.f),
+                                                        0.0f));
+        
+        // Bandwidth / Q / Quality).
+        add(std::make_unique<juce::AudioParameterFloat>(id("Peak Quality"),
+                                                        id("Peak Quality"),
+                                                        juce::NormalisableRange<float>(0.1f, 10.f, 0.05f, 1.f),
+                                                        1.f));
+        
+        add(std::make_unique<juce::AudioParameterChoice>(id("LowCut Slope"), id("LowCut Slope"), stringArray, 0));
+        add(std::make_unique<juce::AudioParameterChoice>(id("HighCut Slope"), id("HighCut Slope"), stringArray, 0));
+    };
+    
+    addMainParameters(0, [&layout](auto parameter) { layout.add(std::move(parameter)); });
+    
+    // Same curve, no phase shift, at the cost of latency. Switching it changes the latency we report, so it's one for the UI rather than automation
+    layout.add(std::make_unique<NonAutomatableParameter<juce::AudioParameterBool>>("Linear Phase", "Linear Phase", false));
+    
+    // Runs the IIR chain at 2x / 4x / 8x the host rate. Also changes the latency, same as Linear Phase
+    layout.add(std::make_unique<NonAutomatableParameter<juce::AudioParameterChoice>>("Oversampling", "Oversampling",
+                                                                                       juce::StringArray { "Off", "2x", "4x", "8x" }, 0));
+    
+    // Dynamic mode, see DynamicEQ. Each stage has its own switch, threshold and ratio, the time constants and the
+    // detector source are shared
+    // add is layout.add or a group's addChild, whichever the stage's parameters go into
+    auto addDynamicParameters = [](const juce::String& stage, auto&& add)
+    {
+        add(std::make_unique<juce::AudioParameterBool>(stage + " Dynamic", stage + " Dynamic", false));
+        add(std::make_unique<juce::AudioParameterFloat>(stage + " Threshold",
+                                                        stage + " Threshold",
+                                                        juce::NormalisableRange<float>(-60.f, 0.f, 0.5f, 1.f),
+                                                        -24.f));
+        add(std::make_unique<juce::AudioParameterFloat>(stage + " Ratio",
+                                                        stage + " Ratio",
+                                                        juce::NormalisableRange<float>(1.f, 20.f, 0.1f, 0.5f),
+                                                        2.f));
+    };
+    
+    addDynamicParameters("Peak", [&layout](auto parameter) { layout.add(std::move(parameter)); });
+    
+    layout.add(std::make_unique<juce::AudioParameterFloat>("Dynamic Attack",
+                                                          "Dynamic Attack",
+                                                          juce::NormalisableRange<float>(0.1f, 200.f, 0.1f, 0.4f),
+                                                          10.f));
+    
+    layout.add(std::make_unique<juce::AudioParameterFloat>("Dynamic Release",
+                                                          "Dynamic Release",
+                                                          juce::NormalisableRange<float>(5.f, 2000.f, 1.f, 0.4f),
+                                                          150.f));
+    
+    // detectors listen to the sidechain bus instead of the input, when the host has one connected
+    layout.add(std::make_unique<juce::AudioParameterBool>("Sidechain", "Sidechain", false));
+    
+    // Extra parametric bands, one parameter group each so hosts can fold them away. All off to start with,
+    // default frequencies spread evenly in octaves over the range so switching a few on gives something sensible
+    juce::StringArray bandTypes { "Bell", "Low Shelf", "High Shelf", "Notch", "Tilt" };
+    
+    auto makeBandGroup = [&bandTypes](int path, int i)
+    {
+        auto id = [path, i](const char* field) { return CoefficientEngine::getPathParameterID(path, CoefficientEngine::getBandParameterID(i, field)); };
+        auto defaultFreq = 20.f * std::pow(1000.f, (i + 0.5f) / ChainSettings::maxBands);
+        
+        auto group = std::make_unique<juce::AudioProcessorParameterGroup>(CoefficientEngine::getPathParameterID(path, "Band" + juce::String(i + 1)),
+                                                                       "Band " + juce::String(i + 1), "|");
+        
+        group->addChild(std::make_unique<juce::AudioParameterBool>(id("On"), id("On"), false));
+        group->addChild(std::make_unique<juce::AudioParameterChoice>(id("Type"), id("Type"), bandTypes, 0));
+        group->addChild(std::make_unique<juce::AudioParameterFloat>(id("Freq"),
+                                                                    id("Freq"),
+                                                                    juce::NormalisableRange<float>(20.f, 20000.f, 1.f, 0.25f),
+                                                                    std::round(defaultFreq)));
+        group->addChild(std::make_unique<juce::AudioParameterFloat>(id("Gain"),
+                                                                    id("Gain"),
+                                                                    juce::NormalisableRange<float>(-24.f, 24.f, 0.5f, 1.f),
+                                                                    0.0f));
+        group->addChild(std::make_unique<juce::AudioParameterFloat>(id("Quality"),
+                                                                    id("Quality"),
+                                                                    juce::NormalisableRange<float>(0.1f, 10.f, 0.05f, 1.f),
+                                                                    1.f));
+        
+        return group;
+    };
+    
+    for (int i = 0; i < ChainSettings::maxBands; ++i)
+    {
+        auto group = makeBandGroup(0, i);
+        addDynamicParameters("Band" + juce::String(i + 1), [&group](auto parameter) { group->addChild(std::move(parameter)); });
+        
+        layout.add(std::move(group));
+    }
+    
+    // What the first two channels run, see StereoMode
+    layout.add(std::make_unique<juce::AudioParameterChoice>("Stereo Mode", "Stereo Mode", juce::StringArray { "Stereo", "Dual Mono", "Mid/Side" }, 0));
+    
+    // Right / side channel filters for the split modes: everything path 0 has bar the dynamics, ids prefixed "Path2 "
+    auto secondPath = std::make_unique<juce::AudioProcessorParameterGroup>("Path2", "Right / Side", "|");
+    addMainParameters(1, [&secondPath](auto parameter) { secondPath->addChild(std::move(parameter)); });
+    
+    for (int i = 0; i < ChainSettings::maxBands; ++i)
+        secondPath->addChild(makeBandGroup(1, i));
     
+    layout.add(std::move(secondPath));
     
     return layout;
 }
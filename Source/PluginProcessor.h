@@ -9,30 +9,57 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "ChainSettings.h"
+#include "CoefficientEngine.h"
+#include "FilterCascade.h"
+#include "ChainSmoother.h"
+#include "SpectrumAnalyzer.h"
+#include "ResponseCurve.h"
+#include "LinearPhaseEngine.h"
+#include "PerformanceCounters.h"
+#include "ParameterState.h"
+#include "DynamicEQ.h"
 
-//enum for slope to give us specific settings to switch from in a switch statement in PluginProcessor.cpp prepareToPlay()
-enum Slope
+/* Raw atomic handles for every parameter in createParameterLayout().
+    getRawParameterValue() is a string keyed lookup, so we resolve them once when the processor is built
+    and the audio thread only ever does plain atomic loads. path 1 is the second channel's set in dual mono / mid-side
+ */
+struct ParameterHandles
 {
-    Slope_12,
-    Slope_24,
-    Slope_36,
-    Slope_48
-};
-// Extracting params from apvts, use a data structure to represent all of the param values for readability
-struct ChainSettings
-{
-    float peakFreq { 0 }, peakGainInDecibels { 0 }, peakQuality {1.f};
-    float lowCutFreq { 0 }, highCutFreq { 0 };
-    Slope lowCutSlope { Slope::Slope_12 }, highCutSlope { Slope::Slope_12 };
+    explicit ParameterHandles(juce::AudioProcessorValueTreeState& apvts, int path = 0);
+    
+    std::atomic<float>* lowCutFreq { nullptr };
+    std::atomic<float>* highCutFreq { nullptr };
+    std::atomic<float>* peakFreq { nullptr };
+    std::atomic<float>* peakGain { nullptr };
+    std::atomic<float>* peakQuality { nullptr };
+    std::atomic<float>* lowCutSlope { nullptr };
+    std::atomic<float>* highCutSlope { nullptr };
+    
+    struct BandHandles
+    {
+        std::atomic<float>* enabled { nullptr };
+        std::atomic<float>* type { nullptr };
+        std::atomic<float>* freq { nullptr };
+        std::atomic<float>* gain { nullptr };
+        std::atomic<float>* quality { nullptr };
+    };
+    
+    std::array<BandHandles, ChainSettings::maxBands> bands;
 };
 
 // helper function to return the param values in the data struct
-ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts);
+ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts, int path = 0);
+
+// real-time safe version: lock-free snapshot of the cached handles, no lookups
+ChainSettings getChainSettings(const ParameterHandles& parameters);
 
 //==============================================================================
 /**
 */
-class SimpleEQAudioProcessor  : public juce::AudioProcessor
+class SimpleEQAudioProcessor  : public juce::AudioProcessor,
+                                private juce::AudioProcessorValueTreeState::Listener,
+                                private juce::AsyncUpdater
 {
 public:
     //==============================================================================
@@ -42,12 +69,21 @@ public:
     //==============================================================================
     void prepareToPlay (double sampleRate, int samplesPerBlock) override;
     void releaseResources() override;
+    
+    /* Seek or loop restart: clears the state of every filter, resampler, detector and convolver in place. Nothing is
+        reallocated or redesigned, so it costs the same however long the session has been running
+     */
+    void reset() override;
 
    #ifndef JucePlugin_PreferredChannelConfigurations
     bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
    #endif
 
     void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlock (juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+    
+    // Hosts that ask for double precision get a double filter chain (coefficients, state and I/O all double)
+    bool supportsDoublePrecisionProcessing() const override;
 
     //==============================================================================
     juce::AudioProcessorEditor* createEditor() override;
@@ -77,59 +113,190 @@ public:
      */
     static juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
     
+    /* Seconds of audio it takes for the current filter design to forget its past input (impulse response below threshold).
+        Offline renderers use this as pre-roll when they start processing part way through a file
+     */
+    double getFilterSettleSeconds(double threshold = 1.0e-9) const;
+    
+    /* Parameter smoothing: changes ramp over rampSeconds and the coefficients of whichever stages are moving get
+        redesigned every subBlockSize samples. rampSeconds of 0 turns it off (coefficients jump once per block).
+        Takes effect on the next prepareToPlay
+     */
+    void setParameterSmoothing(double rampSeconds, int subBlockSize);
+    
+    /* Precomputed LowCut / HighCut designs for fast automation sweeps, see CutFilterTable. Both paths (and every other
+        instance at the same rate) use the same table. entriesPerOctave sets the memory / accuracy trade off, 0 turns
+        it off. Takes effect on the next prepareToPlay
+     */
+    void setCutFilterTableResolution(int entriesPerOctave)
+    {
+        coefficientEngine.setCutTableResolution(entriesPerOctave);
+        secondPathEngine.setCutTableResolution(entriesPerOctave);
+    }
+    
+    /* Mixed precision for float hosts: audio stays float but the cascade's coefficients and state are double.
+        Low cuts at 20-40 Hz with 48 db/Oct at 96/192 kHz put poles right next to the unit circle, where float state
+        raises the noise floor. Costs about twice the SIMD work since half as many channels fit in a register
+     */
+    void setMixedPrecision(bool shouldUseDoubleState) { useDoubleState = shouldUseDoubleState; }
+    
+    /* Which structure the cascade's sections run in, see FilterTopology. The response is the same either way, the SVF holds
+        up better under fast modulation and with poles close to z = 1. Any thread, picked up at the start of the next block
+     */
+    void setFilterTopology(FilterTopology newTopology) noexcept { filterTopology = newTopology; }
+    
+    // Sections the float cascade runs per sample right now (cut slopes, peak and the bands that are on). Audio thread
+    int getNumActiveSections() noexcept { return filterChain.getNumActiveSections(); }
+    
+    /* Per block cycle histograms for processBlock, the coefficient updates and each stage of the chain.
+        Only filled in when built with SIMPLEEQ_INSTRUMENTATION=1 (PerformanceCounters::enabled), readable from any thread
+     */
+    PerformanceCounters& getPerformanceCounters() noexcept { return performanceCounters; }
+    
+    // Pre/post EQ spectrum feed, the editor switches it on while it's open
+    SpectrumAnalyzer& getAnalyzer() noexcept { return analyzer; }
+    
+    // Magnitude response of the current settings, shared by every open editor. Message thread only
+    ResponseCurve& getResponseCurve() noexcept { return responseCurve; }
+    
+    // path's parameters as the cached atomic handles, getChainSettings() on these skips the string lookups. Any thread
+    const ParameterHandles& getParameterHandles(int path) const noexcept { return getHandles(path); }
+    
+    /* "Linear Phase" parameter: the chain runs as a FIR with the same magnitude response, see LinearPhaseEngine.
+        The engine is only built while the mode is on. Kernel size in samples, 0 picks one from the sample rate.
+        Takes effect on the next prepareToPlay
+     */
+    bool isLinearPhase() const noexcept { return linearPhaseParameter->load() > 0.5f; }
+    void setLinearPhaseKernelSize(int numSamples) noexcept { linearPhase.setKernelSize(numSamples); }
+    
+    /* "Oversampling" parameter: Off / 2x / 4x / 8x. The IIR chain is designed for and runs at the higher rate, which moves
+        the bilinear transform's frequency warping up out of the audible range - a HighCut at 18k or a 12k peak then
+        keeps its analog shape. Linear phase mode doesn't need it and ignores it
+     */
+    int getOversamplingFactor() const noexcept { return 1 << getOversamplingOrder(); }
+    
+    // Half-band FIR stages (linear phase, more latency) instead of polyphase IIR ones. Takes effect on the next prepareToPlay
+    void setOversamplingUsesFIR(bool shouldUseFIR) noexcept { oversamplingUsesFIR = shouldUseFIR; }
+    
+    /* Silence bypass for sparse material: once the input has been silent (every sample at or below thresholdDecibels,
+        -inf is digital zero only) for as long as the current design takes to ring out, the filters stop running and the
+        output is cleared until signal comes back. On by default, at digital zero
+     */
+    void setSilenceBypass(bool shouldBypass, float thresholdDecibels = -std::numeric_limits<float>::infinity());
+    
+    // Whether the last block skipped the filters. Any thread
+    bool isBypassingSilence() const noexcept { return bypassingSilence.load(); }
+    
+    /* Dynamic mode of the Peak stage and the bands ("<Stage> Dynamic", "Threshold", "Ratio", plus the shared
+        "Dynamic Attack", "Dynamic Release" and "Sidechain"), see DynamicEQ. Gain reduction per stage for meters, the
+        larger of the two paths' in the split stereo modes. Any thread
+     */
+    float getDynamicGainReduction(int slot) const noexcept
+    {
+        auto reduction = dynamicEQ.getGainReduction(slot);
+        return getStereoMode() == StereoMode::Linked ? reduction : juce::jmax(reduction, secondPathDynamicEQ.getGainReduction(slot));
+    }
+    
+    /* "Stereo Mode" parameter: Stereo runs every channel through one set of filters. Dual Mono gives the right channel
+        its own set ("Path2 ..." parameters), Mid/Side does the same for the side signal with the left set on the mid.
+        The paths share the chain, see StereoMode. Each path's dynamic stages listen to its own channel (left / right,
+        or mid / side). Linear phase stays on the first path's settings
+     */
+    StereoMode getStereoMode() const noexcept { return static_cast<StereoMode>(juce::jlimit(0, 2, (int) stereoModeParameter->load())); }
+    
+    // Rate the filters are currently designed at, what a response curve should be drawn for
+    double getDesignSampleRate() const { return getSampleRate() * (isLinearPhase() ? 1 : getOversamplingFactor()); }
+    
     /* AudioProcessorValueTreeState coordinates params on GUI with DSP variables
         Needs to be public so that the GUI can attach buttons, sliders etc to it
      */
     juce::AudioProcessorValueTreeState apvts {*this, nullptr, "Parameters", createParameterLayout()};
     
 private:
-    /* Concept of DSP namespace - define a chain and pass in a processing context that will run through each element in the chain  automatically. E.g. Four filter elements in a chain to process cut, hi cut, slope etc
-        The DSP namespace uses alot of nested namespaces and template meta programming
-        Here I'm creating a type aliases to eliminate template and namespace definitions:
+    // Must stay below apvts so the parameters exist by the time the handles get resolved
+    ParameterHandles parameterHandles { apvts };
+    ParameterHandles secondPathHandles { apvts, 1 };
+    std::atomic<float>* linearPhaseParameter { apvts.getRawParameterValue("Linear Phase") };
+    std::atomic<float>* oversamplingParameter { apvts.getRawParameterValue("Oversampling") };
+    std::atomic<float>* stereoModeParameter { apvts.getRawParameterValue("Stereo Mode") };
+    
+    // binary get/setStateInformation, also needs the parameters to exist already
+    ParameterState parameterState { *this };
+    
+    /* While setStateInformation is writing parameters the audio thread leaves the dirty bits alone, so it never designs
+        from half a state. Once it's done the audio thread jumps straight to the restored values (no ramp from the
+        old session) with one full redesign
      */
-    using Filter = juce::dsp::IIR::Filter<float>;
+    std::atomic<int> stateRestoresInProgress { 0 };
+    std::atomic<bool> restoredStatePending { false };
     
-    // Cut filters built with their own processor chain instance:
-    using CutFilter = juce::dsp::ProcessorChain<Filter, Filter, Filter, Filter>;
+    /* Previously two MonoChains (ProcessorChain<CutFilter, Filter, CutFilter>), one per channel, each running scalar IIR::Filters.
+        Both channels always had the same coefficients, so now it's one cascade of biquad sections that processes the
+        channels side by side in SIMD lanes:
+
+        sections 0-3:  LowCut (up to 48 db/Oct)
+        section 4:     Peak
+        sections 5-8:  HighCut
+        sections 9-32: Band1 - Band24, one section each
+
+        Bands that are off are bypassed, which takes them out of the cascade's active list - they cost nothing per sample
+     */
+    static constexpr int numChainSections = 9 + ChainSettings::maxBands;
     
-    using MonoChain = juce::dsp::ProcessorChain<CutFilter, Filter, CutFilter>;
+    using FilterChain = FilterCascade<float, numChainSections>;
     
-    MonoChain leftChain, rightChain;
+    // the same cascade held in double, used for double precision hosts and for mixed precision
+    using DoubleFilterChain = FilterCascade<double, numChainSections>;
+    
+    FilterChain filterChain;
+    DoubleFilterChain doubleFilterChain;
+    
+    std::atomic<bool> useDoubleState { false };
+    std::atomic<FilterTopology> filterTopology { FilterTopology::TransposedDirectFormII };
 
+    // index of the first section of each stage in the cascade
     enum ChainPositions
     {
-        LowCut,
-        Peak,
-        HighCut
+        LowCut = 0,
+        Peak = 4,
+        HighCut = 5,
+        Bands = 9
     };
     
-    void updatePeakFilter(const ChainSettings& chainSettings);
+    void updatePeakFilter(int path);
     
-    /* create our own alias for Juce's Coefficients class (we use this for easier declaration of helper function to update coefficients)
-        No member variables so we'll keep the helper functon as a static member function
-     */
-    using Coefficients = Filter::CoefficientsPtr;
-    static void updateCoefficients(Coefficients& old, const Coefficients& replacements);
+    // Both chains always carry the current design, so switching precision never has to wait for a redesign
+    void setSection(int section, const BiquadCoefficients& coefficients, int path = 0)
+    {
+        filterChain.setCoefficients(section, coefficients, path);
+        doubleFilterChain.setCoefficients(section, coefficients, path);
+    }
     
-    template<int Index, typename ChainType, typename CoefficientType>
-    void update(ChainType& chain, const CoefficientType& coefficients)
+    void setSectionBypassed(int section, bool shouldBeBypassed, int path = 0)
     {
-        updateCoefficients(chain.template get<Index>().coefficients, coefficients[Index]);
-        chain.template setBypassed<Index>(false);
+        filterChain.setBypassed(section, shouldBeBypassed, path);
+        doubleFilterChain.setBypassed(section, shouldBeBypassed, path);
     }
     
-    template<typename ChainType, typename CoefficientType>
-    void updateCutFilter(ChainType& chain,
-                         const CoefficientType& coefficients,
-                         const Slope& lowCutSlope)
+    template<int Index>
+    void update(int chainPosition, const CutCoefficients& coefficients, int path)
+    {
+        setSection(chainPosition + Index, coefficients.sections[Index], path);
+        setSectionBypassed(chainPosition + Index, false, path);
+    }
+    
+    void updateCutFilter(int chainPosition,
+                         const CutCoefficients& coefficients,
+                         const Slope& lowCutSlope,
+                         int path)
 
                         
     {
         // bypass all links in the chain:
-        chain.template setBypassed<0>(true);
-        chain.template setBypassed<1>(true);
-        chain.template setBypassed<2>(true);
-        chain.template setBypassed<3>(true);
+        setSectionBypassed(chainPosition + 0, true, path);
+        setSectionBypassed(chainPosition + 1, true, path);
+        setSectionBypassed(chainPosition + 2, true, path);
+        setSectionBypassed(chainPosition + 3, true, path);
         
         // We want to switch based on the slope setting. We've defined an enum to define slope setting in headers file
         
@@ -158,27 +325,183 @@ private:
                 
             case Slope_48:
             {
-                update<3>(chain, coefficients);
+                update<3>(chainPosition, coefficients, path);
             }
             case Slope_36:
             {
-                update<2>(chain, coefficients);
+                update<2>(chainPosition, coefficients, path);
             }
             case Slope_24:
             {
-                update<1>(chain, coefficients);
+                update<1>(chainPosition, coefficients, path);
             }
             case Slope_12:
             {
-                update<0>(chain, coefficients);
+                update<0>(chainPosition, coefficients, path);
             }
         }
     }
     
-    void updateLowCutFilters(const ChainSettings& chainSettings);
-    void updateHighCutFilters(const ChainSettings& chainSettings);
+    void updateLowCutFilters(const ChainSettings& chainSettings, int path);
+    void updateHighCutFilters(const ChainSettings& chainSettings, int path);
+    void updateBandFilters(const ChainSettings& chainSettings, int stages, int path);
+    
+    // Tells both cascades which PerformanceCounters stage each of their sections belongs to
+    void assignSectionCounters();
     
+    // Picks up the stages the APVTS listener flagged as dirty - they either start ramping or get redesigned right away
     void updateFilters();
+    void updatePathFilters(int path, bool restoredState);
+    
+    /* Designs the given stages for these settings with path's engine and loads them into path's lanes of the chain.
+        shareDesigns: the settings are the parameter values themselves (not a ramp step) and have settled, so the
+        CoefficientCache can be used. Stages designed without it are remembered in unsharedStages
+     */
+    void applyCoefficients(const ChainSettings& chainSettings, int stages, bool shareDesigns = false, int path = 0);
+    
+    /* Audio thread, between blocks: switches both chains over. A path coming into use is brought up to date in one go,
+        its engine has only been collecting dirty bits while nothing ran it
+     */
+    void setActiveStereoMode(StereoMode mode);
+    
+    // Filter paths the chain is running right now: 1 linked, 2 in dual mono and mid / side
+    int getNumActivePaths() const noexcept { return activeStereoMode == StereoMode::Linked ? 1 : 2; }
+    
+    // Whether any path in use has a ramp running
+    bool isSmoothing() const noexcept;
+    
+    // Whether any path in use has a dynamic stage, as of the last analyse()
+    bool hasActiveDynamics() const noexcept;
+    
+    // What path's detectors listen to in the running stereo mode
+    DynamicEQ::Input getDetectorInput(int path) const noexcept;
+    
+    /* Audio thread, before the chain: whether this block can skip it. True once the input has stayed silent for the whole
+        tail and the output has followed it down, the block is cleared then
+     */
+    template <typename SampleType>
+    bool skipSilentBlock(juce::dsp::AudioBlock<SampleType>& block);
+    
+    // Audio thread, after the chain: while ringing out, notes whether the output has gone quiet too
+    template <typename SampleType>
+    void trackRingOut(const juce::dsp::AudioBlock<SampleType>& block);
+    
+    /* Host rate samples until engine's design (running at 2^order times the host rate) has decayed below tailThreshold
+        after the input stops, plus the resampling latency
+     */
+    double getTailSamples(const CoefficientEngine& engine, int order) const noexcept;
+    
+    // Shared body of both processBlock overloads: hands buffer to processChain in pieces no longer than we're prepared for
+    template <typename SampleType, typename ChainType>
+    void processInChunks(juce::AudioBuffer<SampleType>& buffer, ChainType& chain);
+    
+    // One block of at most preparedSpec.maximumBlockSize samples, chain is whichever precision it should run in
+    template <typename SampleType, typename ChainType>
+    void processChain(juce::AudioBuffer<SampleType>& buffer, ChainType& chain);
+    
+    // The IIR chain on one block, at whatever rate the block is at
+    template <typename SampleType, typename ChainType>
+    void processIIR(juce::dsp::AudioBlock<SampleType>& block, ChainType& chain);
+    
+    // Runs the chain in sub-blocks, redesigning the ramping stages and updating the dynamic ones before each one
+    template <typename SampleType, typename ChainType>
+    void processSmoothed(juce::dsp::AudioBlock<SampleType>& block, ChainType& chain);
+    
+    // Loads every path's dynamic stages' gain-only coefficients for host rate sample position of this block
+    void applyDynamics(int position);
+    
+    CoefficientEngine coefficientEngine;
+    ChainSmoother chainSmoother;
+    
+    // the same again for the second channel's path. Collects dirty bits all the time, designs only while a split mode runs
+    CoefficientEngine secondPathEngine;
+    ChainSmoother secondPathSmoother;
+    
+    // audio thread: what the chains are set to
+    StereoMode activeStereoMode { StereoMode::Linked };
+    
+    CoefficientEngine& getEngine(int path) noexcept { return path == 0 ? coefficientEngine : secondPathEngine; }
+    ChainSmoother& getSmoother(int path) noexcept { return path == 0 ? chainSmoother : secondPathSmoother; }
+    const ParameterHandles& getHandles(int path) const noexcept { return path == 0 ? parameterHandles : secondPathHandles; }
+    SpectrumAnalyzer analyzer;
+    ResponseCurve responseCurve;
+    LinearPhaseEngine linearPhase { [this] { return getChainSettings(parameterHandles); } };
+    PerformanceCounters performanceCounters;
+    DynamicEQ dynamicEQ { apvts };
+    DynamicEQ secondPathDynamicEQ { apvts };    // the second path's detectors, only run in a split mode
+    
+    DynamicEQ& getDynamics(int path) noexcept { return path == 0 ? dynamicEQ : secondPathDynamicEQ; }
+    
+    //==============================================================================
+    // 2x, 4x, 8x: one of each prepared up front so switching factor never allocates
+    static constexpr int maxOversamplingOrder = 3;
+    
+    template <typename SampleType>
+    using Oversamplers = std::array<std::unique_ptr<juce::dsp::Oversampling<SampleType>>, maxOversamplingOrder>;
+    
+    Oversamplers<float> oversamplers;
+    Oversamplers<double> doubleOversamplers;
+    std::atomic<bool> oversamplingUsesFIR { false };
+    
+    /* what prepareToPlay last built everything for, so preparing again for something that fits only has to reset.
+        maximumBlockSize only ever grows, it's the chunk size for processBlock
+     */
+    juce::dsp::ProcessSpec preparedSpec {};
+    bool preparedOversamplingFIR { false };
+    
+    // audio thread: the order the chain is currently designed and running at
+    int activeOversampling { 0 };
+    
+    int getOversamplingOrder() const noexcept { return juce::jlimit(0, maxOversamplingOrder, (int) oversamplingParameter->load()); }
+    
+    template <typename SampleType>
+    juce::dsp::Oversampling<SampleType>* getOversampler(int order) noexcept
+    {
+        if constexpr (std::is_same_v<SampleType, float>)
+            return oversamplers[(size_t) order - 1].get();
+        else
+            return doubleOversamplers[(size_t) order - 1].get();
+    }
+    
+    // Audio thread: redesigns everything for the new rate and clears state that belongs to the old one
+    void setActiveOversampling(int order);
+    
+    // Linear phase mode and oversampling both delay the output, hosts need to know to compensate. Never the audio thread
+    void updateLatency();
+    void parameterChanged(const juce::String& parameterID, float newValue) override;
+    
+    // message thread: a mode switch that came in from some other thread
+    void handleAsyncUpdate() override;
+    
+    // The mode is on and its engine has been built. Until then (or without a prepareToPlay yet) the IIR chain runs
+    bool runsLinearPhase() const noexcept { return isLinearPhase() && linearPhase.isReady(); }
+    
+    std::atomic<double> smoothingRampSeconds { 0.02 };
+    std::atomic<int> smoothingSubBlockSize { 32 };
+    size_t subBlockSize { 32 };
+    
+    // audio thread: per path, the stages whose current design didn't go through the cache (a ramp step, or values that
+    // only just moved). Shared once they've sat still for a block, so automation never fills the cache with its steps
+    std::array<int, CoefficientEngine::numPaths> unsharedStages {};
+    
+    //==============================================================================
+    // -120 dB: how far below the input the filters' ring out counts as over, for the tail and the silence bypass
+    static constexpr double tailThreshold = 1.0e-6;
+    
+    std::atomic<bool> silenceBypassEnabled { true };
+    std::atomic<float> silenceThreshold { 0.0f };   // gain, a block peaking at or below this is silent
+    std::atomic<bool> bypassingSilence { false };
+    
+    // audio thread: samples of silent input still to run through the chain, -1 while there's signal
+    double ringOutRemaining { -1.0 };
+    bool ringOutStale { false };            // coefficients changed since ringOutRemaining was worked out
+    
+    /* Host rate tail of the IIR chain as it's designed right now, for getTailLengthSeconds(). The engines are only
+        ever read on the audio thread, so it's worked out there (in updateFilters) whenever tailStale says a design changed
+     */
+    std::atomic<double> iirTailSamples { 0.0 };
+    bool tailStale { true };
+    bool ringOutOutputSilent { false };     // the last block processed while ringing out came out silent
     
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SimpleEQAudioProcessor)
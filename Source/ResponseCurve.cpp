@@ -0,0 +1,74 @@
+/*
+  ==============================================================================
+
+    ResponseCurve.cpp
+    Cached magnitude response of the whole chain for the editor to draw.
+
+  ==============================================================================
+*/
+
+#include "ResponseCurve.h"
+
+namespace
+{
+    // -200 dB, anything deeper isn't going to show up on screen
+    constexpr double minPower = 1.0e-20;
+}
+
+double ResponseCurve::getFrequency(int point) noexcept
+{
+    return minFrequency * std::pow(maxFrequency / minFrequency, (double) point / (numPoints - 1));
+}
+
+void ResponseCurve::prepareGrid(double sampleRate)
+{
+    cos1.resize((size_t) numPoints);
+    cos2.resize((size_t) numPoints);
+    power.resize((size_t) numPoints);
+
+    for (int i = 0; i < numPoints; ++i)
+    {
+        // above Nyquist there's nothing to show, pin those points to Nyquist
+        auto w = juce::MathConstants<double>::twoPi * juce::jmin(getFrequency(i), sampleRate * 0.5) / sampleRate;
+
+        cos1[(size_t) i] = std::cos(w);
+        cos2[(size_t) i] = std::cos(2.0 * w);
+    }
+
+    engine.prepare(sampleRate);
+    gridSampleRate = sampleRate;
+}
+
+bool ResponseCurve::update(const ChainSettings& settings, double sampleRate)
+{
+    if (sampleRate <= 0.0)
+        return false;
+
+    const juce::ScopedLock lock(updateLock);
+
+    if (auto last = getMagnitudes())
+        if (last->sampleRate == sampleRate && last->settings == settings)
+            return false;
+
+    if (sampleRate != gridSampleRate)
+        prepareGrid(sampleRate);
+
+    engine.design(settings, CoefficientEngine::AllStages);
+
+    std::fill(power.begin(), power.end(), 1.0);
+
+    engine.forEachSection([this](const BiquadCoefficients& section)
+    {
+        CoefficientEngine::multiplyPowerResponse(section, cos1.data(), cos2.data(), power.data(), numPoints);
+    });
+
+    auto magnitudes = std::make_shared<Magnitudes>();
+    magnitudes->settings = settings;
+    magnitudes->sampleRate = sampleRate;
+
+    for (int i = 0; i < numPoints; ++i)
+        magnitudes->decibels[(size_t) i] = (float) (10.0 * std::log10(juce::jmax(minPower, power[(size_t) i])));
+
+    std::atomic_store(&current, Snapshot(std::move(magnitudes)));
+    return true;
+}
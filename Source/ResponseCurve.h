@@ -0,0 +1,68 @@
+/*
+  ==============================================================================
+
+    ResponseCurve.h
+    Cached magnitude response of the whole chain for the editor to draw.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ChainSettings.h"
+#include "CoefficientEngine.h"
+#include <array>
+#include <memory>
+#include <vector>
+
+/* Drawing the response by calling getMagnitudeForFrequency() for every section at every pixel on every repaint
+    is up to 33 sections x 1000+ pixels of cos/sin/sqrt. Instead the curve is worked out once per ChainSettings change
+    on a fixed log-frequency grid and kept until the settings move again.
+
+    The cos(w) / cos(2w) terms only depend on the grid and the sample rate, so they're cached too. What's left per
+    section is a rational function in those two arrays, one branch-free sweep of the grid the compiler vectorises.
+
+    Finished curves are immutable and published through an atomically swapped shared_ptr, so any thread can hold
+    on to one while the next is being computed
+ */
+class ResponseCurve
+{
+public:
+    static constexpr int numPoints = 1024;
+    static constexpr double minFrequency = 20.0;
+    static constexpr double maxFrequency = 20000.0;
+
+    struct Magnitudes
+    {
+        std::array<float, numPoints> decibels;
+        ChainSettings settings;
+        double sampleRate { 0.0 };
+    };
+
+    using Snapshot = std::shared_ptr<const Magnitudes>;
+
+    // Frequency of a grid point, evenly spaced in octaves from minFrequency to maxFrequency
+    static double getFrequency(int point) noexcept;
+
+    /* Not real-time safe (allocates a new snapshot). Recomputes only if the settings or sample rate differ from the
+        current snapshot, returns true if it did
+     */
+    bool update(const ChainSettings& settings, double sampleRate);
+
+    // Latest curve, or nullptr before the first update()
+    Snapshot getMagnitudes() const noexcept { return std::atomic_load(&current); }
+
+private:
+    void prepareGrid(double sampleRate);
+
+    juce::CriticalSection updateLock;
+    Snapshot current;
+
+    // guarded by updateLock
+    CoefficientEngine engine;
+    std::vector<double> cos1, cos2, power;
+    double gridSampleRate { 0.0 };
+
+    JUCE_DECLARE_NON_COPYABLE (ResponseCurve)
+};
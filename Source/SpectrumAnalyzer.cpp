@@ -0,0 +1,147 @@
+/*
+  ==============================================================================
+
+    SpectrumAnalyzer.cpp
+    Pre/post EQ spectrum for the editor, fed from the audio thread without locks.
+
+  ==============================================================================
+*/
+
+#include "SpectrumAnalyzer.h"
+
+namespace
+{
+    // about 170 ms at 192 kHz, plenty of room for an analyzer thread that wakes every 10 ms
+    constexpr int fifoSize = 1 << 15;
+    constexpr int pollIntervalMs = 10;
+
+    // how long the power average takes to forget, in seconds
+    constexpr double averagingTime = 0.15;
+
+    constexpr float minusInfinityDb = -120.0f;
+}
+
+SpectrumAnalyzer::TapState::TapState()
+    : fifo(fifoSize),
+      samples((size_t) fifoSize, 0.0f),
+      frame((size_t) fftSize, 0.0f),
+      power((size_t) numBins, 0.0f),
+      published((size_t) numBins, minusInfinityDb)
+{
+}
+
+SpectrumAnalyzer::SpectrumAnalyzer()
+    : juce::Thread("SimpleEQ Spectrum"),
+      fftData((size_t) fftSize * 2, 0.0f)
+{
+}
+
+SpectrumAnalyzer::~SpectrumAnalyzer()
+{
+    setActive(false);
+}
+
+void SpectrumAnalyzer::setActive(bool shouldBeActive)
+{
+    if (shouldBeActive == isActive())
+        return;
+
+    if (! shouldBeActive)
+    {
+        active = false;
+        stopThread(1000);
+        return;
+    }
+
+    // the thread isn't running, so this is the only consumer - throw away whatever was queued last time
+    for (auto& state : taps)
+    {
+        state.fifo.finishedRead(state.fifo.getNumReady());
+        std::fill(state.frame.begin(), state.frame.end(), 0.0f);
+        std::fill(state.power.begin(), state.power.end(), 0.0f);
+    }
+
+    active = true;
+    startThread();
+}
+
+//==============================================================================
+void SpectrumAnalyzer::run()
+{
+    while (! threadShouldExit())
+    {
+        for (auto& state : taps)
+            while (state.fifo.getNumReady() >= hopSize && ! threadShouldExit())
+                analyse(state);
+
+        wait(pollIntervalMs);
+    }
+}
+
+void SpectrumAnalyzer::analyse(TapState& state)
+{
+    // Slide the frame on by one hop (50% overlap) and append the new samples
+    std::copy(state.frame.begin() + hopSize, state.frame.end(), state.frame.begin());
+
+    {
+        auto scope = state.fifo.read(hopSize);
+        auto* dest = state.frame.data() + (fftSize - hopSize);
+
+        std::copy_n(state.samples.data() + scope.startIndex1, scope.blockSize1, dest);
+        std::copy_n(state.samples.data() + scope.startIndex2, scope.blockSize2, dest + scope.blockSize1);
+    }
+
+    std::copy(state.frame.begin(), state.frame.end(), fftData.begin());
+    window.multiplyWithWindowingTable(fftData.data(), (size_t) fftSize);
+    fft.performFrequencyOnlyForwardTransform(fftData.data(), true);
+
+    // A full scale sine peaks at fftSize / 4 through a Hann window, scale so it reads 0 dBFS
+    auto scale = 4.0f / (float) fftSize;
+
+    auto hopSeconds = hopSize / juce::jmax(1.0, currentSampleRate.load());
+    auto decay = (float) std::exp(-hopSeconds / averagingTime);
+
+    for (int bin = 0; bin < numBins; ++bin)
+    {
+        auto magnitude = fftData[(size_t) bin] * scale;
+        auto& average = state.power[(size_t) bin];
+
+        // averaging power rather than dB keeps the noise floor where it really is
+        average = average * decay + magnitude * magnitude * (1.0f - decay);
+    }
+
+    const juce::SpinLock::ScopedLockType lock(publishLock);
+
+    for (int bin = 0; bin < numBins; ++bin)
+        state.published[(size_t) bin] = juce::Decibels::gainToDecibels(std::sqrt(state.power[(size_t) bin]), minusInfinityDb);
+
+    state.version.fetch_add(1, std::memory_order_release);
+}
+
+//==============================================================================
+bool SpectrumAnalyzer::getSpectrum(Tap tap, std::vector<float>& magnitudes, juce::uint32& lastVersion) const
+{
+    auto& state = taps[(size_t) tap];
+    auto version = state.version.load(std::memory_order_acquire);
+
+    if (version == lastVersion)
+        return false;
+
+    magnitudes.resize((size_t) numBins);
+
+    const juce::SpinLock::ScopedLockType lock(publishLock);
+    std::copy(state.published.begin(), state.published.end(), magnitudes.begin());
+    lastVersion = version;
+
+    return true;
+}
+
+juce::int64 SpectrumAnalyzer::getDroppedSamples() const noexcept
+{
+    juce::int64 total = 0;
+
+    for (auto& state : taps)
+        total += state.droppedSamples.load(std::memory_order_relaxed);
+
+    return total;
+}
@@ -0,0 +1,145 @@
+/*
+  ==============================================================================
+
+    SpectrumAnalyzer.h
+    Pre/post EQ spectrum for the editor, fed from the audio thread without locks.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <vector>
+
+/* The audio thread only ever writes samples into a juce::AbstractFifo (single producer, single consumer,
+    wait-free on both ends). Windowing, the FFT and the averaging all happen on the analyzer's own thread,
+    and the editor copies the finished dB spectrum out on the message thread.
+
+    Audio thread budget per tap: a relaxed atomic load when the editor is closed, otherwise at most
+    maxPushChannels reads and one write per sample. No allocation, no locks, and no signalling the
+    analyzer thread (it polls), so nothing in push() can block. If the analyzer falls behind the
+    samples that don't fit are dropped and counted.
+ */
+class SpectrumAnalyzer : private juce::Thread
+{
+public:
+    enum Tap
+    {
+        PreEQ,
+        PostEQ,
+        numTaps
+    };
+
+    static constexpr int fftOrder = 11;
+    static constexpr int fftSize = 1 << fftOrder;
+    static constexpr int numBins = fftSize / 2 + 1;
+    static constexpr int hopSize = fftSize / 2;
+
+    // Surround and ambisonic buses only send their first two channels, so the cost doesn't grow with the layout
+    static constexpr size_t maxPushChannels = 2;
+
+    SpectrumAnalyzer();
+    ~SpectrumAnalyzer() override;
+
+    // Any thread. The bin spacing and averaging time depend on it
+    void prepare(double sampleRate) noexcept { currentSampleRate = sampleRate; }
+    double getSampleRate() const noexcept { return currentSampleRate; }
+
+    // Message thread. Starts/stops the analyzer thread, the audio thread doesn't push anything while it's off
+    void setActive(bool shouldBeActive);
+    bool isActive() const noexcept { return active.load(std::memory_order_relaxed); }
+
+    //==============================================================================
+    // Audio thread. Downmixes the block to mono and queues it for analysis
+    template <typename SampleType>
+    void push(Tap tap, const juce::dsp::AudioBlock<SampleType>& block) noexcept
+    {
+        if (! active.load(std::memory_order_relaxed))
+            return;
+
+        auto numChannels = juce::jmin(block.getNumChannels(), maxPushChannels);
+        auto numSamples = (int) block.getNumSamples();
+
+        if (numChannels == 0 || numSamples == 0)
+            return;
+
+        auto& state = taps[(size_t) tap];
+        auto scope = state.fifo.write(numSamples);
+
+        writeDownmix(block, numChannels, 0, state.samples.data() + scope.startIndex1, scope.blockSize1);
+        writeDownmix(block, numChannels, (size_t) scope.blockSize1, state.samples.data() + scope.startIndex2, scope.blockSize2);
+
+        auto written = scope.blockSize1 + scope.blockSize2;
+
+        if (written < numSamples)
+            state.droppedSamples.fetch_add(numSamples - written, std::memory_order_relaxed);
+    }
+
+    //==============================================================================
+    /* Message thread. Copies the latest averaged spectrum (dBFS per bin, bin i is at i * sampleRate / fftSize)
+        into magnitudes if it's newer than lastVersion, and returns true if it did
+     */
+    bool getSpectrum(Tap tap, std::vector<float>& magnitudes, juce::uint32& lastVersion) const;
+
+    juce::int64 getDroppedSamples() const noexcept;
+
+private:
+    struct TapState
+    {
+        TapState();
+
+        // audio thread -> analyzer thread
+        juce::AbstractFifo fifo;
+        std::vector<float> samples;
+        std::atomic<juce::int64> droppedSamples { 0 };
+
+        // analyzer thread only
+        std::vector<float> frame;
+        std::vector<float> power;
+
+        // analyzer thread -> message thread
+        std::vector<float> published;
+        std::atomic<juce::uint32> version { 0 };
+    };
+
+    template <typename SampleType>
+    static void writeDownmix(const juce::dsp::AudioBlock<SampleType>& block, size_t numChannels,
+                             size_t start, float* dest, int numSamples) noexcept
+    {
+        if (numSamples <= 0)
+            return;
+
+        auto* first = block.getChannelPointer(0) + start;
+
+        if (numChannels == 1)
+        {
+            for (int i = 0; i < numSamples; ++i)
+                dest[i] = (float) first[i];
+
+            return;
+        }
+
+        auto* second = block.getChannelPointer(1) + start;
+
+        for (int i = 0; i < numSamples; ++i)
+            dest[i] = (float) (first[i] + second[i]) * 0.5f;
+    }
+
+    void run() override;
+    void analyse(TapState& state);
+
+    std::array<TapState, numTaps> taps;
+
+    juce::dsp::FFT fft { fftOrder };
+    juce::dsp::WindowingFunction<float> window { (size_t) fftSize, juce::dsp::WindowingFunction<float>::hann, false };
+    std::vector<float> fftData;
+
+    std::atomic<double> currentSampleRate { 44100.0 };
+    std::atomic<bool> active { false };
+
+    mutable juce::SpinLock publishLock;
+
+    JUCE_DECLARE_NON_COPYABLE (SpectrumAnalyzer)
+};